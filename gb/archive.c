@@ -0,0 +1,238 @@
+#include <gb/archive.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define ZIP_LOCAL_HEADER 0x04034B50
+#define ZIP_CENTRAL_HEADER 0x02014B50
+#define ZIP_END_OF_CENTRAL_DIRECTORY 0x06054B50
+
+static uint16_t read16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+ARCHIVE_FORMAT archive_detect(const uint8_t* data, size_t size) {
+    if (size >= 2 && data[0] == 0x1F && data[1] == 0x8B) return ARCHIVE_GZIP;
+    if (size >= 4 && read32(data) == ZIP_LOCAL_HEADER) return ARCHIVE_ZIP;
+    if (size >= 4 && read32(data) == 0xFD2FB528) return ARCHIVE_ZSTD;
+    return ARCHIVE_NONE;
+}
+
+bool archive_isArchiveExtension(const char* extension) {
+    return strcasecmp(extension, ".gz") == 0 || strcasecmp(extension, ".zip") == 0 ||
+           strcasecmp(extension, ".zst") == 0;
+}
+
+static size_t getInitialCapacity(uint64_t sizeHint) {
+    /* A missing or bogus hint starts at the smallest ROM and the buffer grows */
+    if (sizeHint < 0x8000 || sizeHint > ARCHIVE_MAX_ROM_SIZE) return 0x8000;
+    return sizeHint;
+}
+
+static bool growBuffer(uint8_t** buffer, size_t* capacity) {
+    if (*capacity >= ARCHIVE_MAX_ROM_SIZE) return false;
+
+    size_t grownCapacity = *capacity * 2 > ARCHIVE_MAX_ROM_SIZE ? ARCHIVE_MAX_ROM_SIZE : *capacity * 2;
+    uint8_t* grown = (uint8_t*)realloc(*buffer, grownCapacity);
+    if (grown == NULL) return false;
+
+    *buffer = grown;
+    *capacity = grownCapacity;
+    return true;
+}
+
+static uint8_t* inflateROM(const uint8_t* data, size_t size, int windowBits, uint64_t sizeHint, size_t* romSize) {
+    /* The whole input is mapped, so everything is inflated in one call unless the hint was
+     * too small */
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (size > UINT_MAX || inflateInit2(&stream, windowBits) != Z_OK) return NULL;
+
+    size_t capacity = getInitialCapacity(sizeHint);
+    uint8_t* buffer = (uint8_t*)malloc(capacity);
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = size;
+
+    while (buffer != NULL) {
+        stream.next_out = buffer + stream.total_out;
+        stream.avail_out = capacity - stream.total_out;
+
+        int status = inflate(&stream, Z_FINISH);
+        if (status == Z_STREAM_END) break;
+
+        /* Running out of output space is the only error that can be recovered from */
+        if ((status != Z_OK && status != Z_BUF_ERROR) || stream.avail_out != 0 ||
+            !growBuffer(&buffer, &capacity)) {
+            free(buffer);
+            buffer = NULL;
+        }
+    }
+
+    *romSize = stream.total_out;
+    inflateEnd(&stream);
+    return buffer;
+}
+
+static uint8_t* extractGzip(const uint8_t* data, size_t size, size_t* romSize) {
+    /* The size of the uncompressed data is stored in the last 4 bytes */
+    uint64_t sizeHint = size >= 18 ? read32(data + size - 4) : 0;
+    return inflateROM(data, size, 16 + MAX_WBITS, sizeHint, romSize);
+}
+
+static bool hasROMExtension(const uint8_t* name, uint16_t length) {
+    if (length >= 3 && strncasecmp((const char*)name + length - 3, ".gb", 3) == 0) return true;
+    if (length >= 4 && strncasecmp((const char*)name + length - 4, ".gbc", 4) == 0) return true;
+    return false;
+}
+
+static const uint8_t* findZipEntry(const uint8_t* data, size_t size) {
+    /* The central directory is used since local headers can leave the sizes out. The first
+     * .gb or .gbc file is picked, or the first file if there is none */
+    if (size < 22) return NULL;
+
+    const uint8_t* end = NULL;
+    for (size_t offset = size - 22; ; offset--) {
+        if (read32(data + offset) == ZIP_END_OF_CENTRAL_DIRECTORY) {
+            end = data + offset;
+            break;
+        }
+        /* The comment after the record is at most 0xFFFF bytes */
+        if (offset == 0 || size - offset > 22 + 0xFFFF) return NULL;
+    }
+
+    uint16_t entries = read16(end + 10);
+    size_t offset = read32(end + 16);
+    const uint8_t* firstFile = NULL;
+
+    for (uint16_t i = 0; i < entries; i++) {
+        if (offset + 46 > size || read32(data + offset) != ZIP_CENTRAL_HEADER) return NULL;
+
+        const uint8_t* entry = data + offset;
+        uint16_t nameLength = read16(entry + 28);
+        if (offset + 46 + nameLength > size) return NULL;
+
+        /* Directories are empty */
+        if (read32(entry + 24) != 0) {
+            if (hasROMExtension(entry + 46, nameLength)) return entry;
+            if (firstFile == NULL) firstFile = entry;
+        }
+
+        offset += 46 + nameLength + read16(entry + 30) + read16(entry + 32);
+    }
+
+    return firstFile;
+}
+
+static uint8_t* extractZip(const uint8_t* data, size_t size, size_t* romSize) {
+    const uint8_t* entry = findZipEntry(data, size);
+    if (entry == NULL) {
+        printf("Error : No ROM found in zip archive\n");
+        return NULL;
+    }
+
+    uint16_t flags = read16(entry + 8);
+    uint16_t method = read16(entry + 10);
+    uint32_t crc = read32(entry + 16);
+    size_t compressedSize = read32(entry + 20);
+    size_t uncompressedSize = read32(entry + 24);
+    size_t localOffset = read32(entry + 42);
+
+    if (flags & 0x1) {
+        printf("Error : Encrypted zip archives are not supported\n");
+        return NULL;
+    }
+
+    if (uncompressedSize > ARCHIVE_MAX_ROM_SIZE) {
+        printf("Error : ROM in zip archive is too big\n");
+        return NULL;
+    }
+
+    if (localOffset + 30 > size || read32(data + localOffset) != ZIP_LOCAL_HEADER) return NULL;
+    size_t start = localOffset + 30 + read16(data + localOffset + 26) + read16(data + localOffset + 28);
+    if (start > size || compressedSize > size - start) return NULL;
+
+    uint8_t* rom = NULL;
+    if (method == 0) {
+        /* Stored */
+        if (compressedSize != uncompressedSize) return NULL;
+        rom = (uint8_t*)malloc(uncompressedSize);
+        if (rom != NULL) memcpy(rom, data + start, uncompressedSize);
+        *romSize = uncompressedSize;
+    } else if (method == 8) {
+        /* Deflated, without a zlib header */
+        rom = inflateROM(data + start, compressedSize, -MAX_WBITS, uncompressedSize, romSize);
+    } else {
+        printf("Error : Unsupported zip compression method %d\n", method);
+        return NULL;
+    }
+
+    if (rom != NULL && (*romSize != uncompressedSize || crc32(0, rom, *romSize) != crc)) {
+        free(rom);
+        return NULL;
+    }
+
+    return rom;
+}
+
+static uint8_t* extractZstd(const uint8_t* data, size_t size, size_t* romSize) {
+    /* The frame header usually has the content size, it is unknown for streamed frames */
+    size_t capacity = getInitialCapacity(ZSTD_getFrameContentSize(data, size));
+    uint8_t* buffer = (uint8_t*)malloc(capacity);
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+
+    ZSTD_inBuffer input = { data, size, 0 };
+    ZSTD_outBuffer output = { buffer, capacity, 0 };
+
+    while (buffer != NULL && context != NULL) {
+        size_t status = ZSTD_decompressStream(context, &output, &input);
+        bool failed = ZSTD_isError(status);
+
+        /* 0 is returned once a frame is complete */
+        if (!failed && status == 0 && input.pos == input.size) break;
+
+        if (!failed && output.pos == output.size) {
+            failed = !growBuffer(&buffer, &capacity);
+            output.dst = buffer;
+            output.size = capacity;
+        } else if (!failed && input.pos == input.size) {
+            /* Truncated */
+            failed = true;
+        }
+
+        if (failed) {
+            free(buffer);
+            buffer = NULL;
+        }
+    }
+
+    if (context == NULL) {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    ZSTD_freeDCtx(context);
+    *romSize = output.pos;
+    return buffer;
+}
+
+uint8_t* archive_extract(const uint8_t* data, size_t size, ARCHIVE_FORMAT format, size_t* romSize) {
+    uint8_t* rom = NULL;
+    *romSize = 0;
+
+    switch (format) {
+        case ARCHIVE_GZIP: rom = extractGzip(data, size, romSize); break;
+        case ARCHIVE_ZIP: rom = extractZip(data, size, romSize); break;
+        case ARCHIVE_ZSTD: rom = extractZstd(data, size, romSize); break;
+        default: break;
+    }
+
+    if (rom == NULL) printf("Error : Could not decompress the ROM archive\n");
+    return rom;
+}
@@ -0,0 +1,260 @@
+#include <gb/blockcache.h>
+#include <gb/gb.h>
+#include <gb/cpu.h>
+#include <gb/debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const CachedInstruction blockcache_noInstruction = { 0 };
+
+/* Instruction lengths in bytes, illegal opcodes are 1 byte long */
+static const uint8_t opcodeLengths[256] = {
+/*  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,     /* 0x */
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     /* 1x */
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     /* 2x */
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     /* 3x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 4x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 5x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 6x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 7x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 8x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 9x */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* Ax */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* Bx */
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,     /* Cx */
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,     /* Dx */
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     /* Ex */
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1      /* Fx */
+};
+
+/* Cost in M cycles with conditional branches not taken, the CB prefix is counted
+ * together with the prefixed instruction */
+static const uint8_t opcodeCycles[256] = {
+/*  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
+    1, 3, 2, 2, 1, 1, 2, 1, 5, 2, 2, 2, 1, 1, 2, 1,     /* 0x */
+    1, 3, 2, 2, 1, 1, 2, 1, 3, 2, 2, 2, 1, 1, 2, 1,     /* 1x */
+    2, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,     /* 2x */
+    2, 3, 2, 2, 3, 3, 3, 1, 2, 2, 2, 2, 1, 1, 2, 1,     /* 3x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* 4x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* 5x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* 6x */
+    2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1,     /* 7x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* 8x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* 9x */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* Ax */
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* Bx */
+    2, 3, 3, 4, 3, 4, 2, 4, 2, 4, 3, 0, 3, 6, 2, 4,     /* Cx */
+    2, 3, 3, 1, 3, 4, 2, 4, 2, 4, 3, 1, 3, 1, 2, 4,     /* Dx */
+    3, 3, 2, 1, 1, 4, 2, 4, 4, 1, 4, 1, 1, 1, 2, 4,     /* Ex */
+    3, 3, 2, 1, 1, 4, 2, 4, 3, 2, 4, 1, 1, 1, 2, 4      /* Fx */
+};
+
+static inline uint8_t getCBCycles(uint8_t cbOpcode) {
+    /* Register operands take 2 cycles, (HL) takes 4 or 3 for BIT which doesnt write back */
+    if ((cbOpcode & 7) != 6) return 2;
+    return (cbOpcode >= 0x40 && cbOpcode <= 0x7F) ? 3 : 4;
+}
+
+static inline bool endsBlock(uint8_t opcode) {
+    /* Unconditional changes of the PC, conditional ones dont end blocks because the CPU
+     * notices when the next instruction isnt at the address it expects */
+    switch (opcode) {
+        case 0x10: case 0x18: case 0x76:
+        case 0xC3: case 0xC9: case 0xCD: case 0xD9: case 0xE9:
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF:
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF: return true;
+        default: return false;
+    }
+}
+
+static inline uint32_t getSlot(uint32_t key) {
+    /* Fibonacci hashing, keys of neighbouring blocks end up in different slots */
+    return (key * 2654435761u) >> (32 - BLOCK_CACHE_BITS);
+}
+
+static bool getKey(GB* gb, uint16_t address, uint32_t* key, uint16_t* regionEnd) {
+    /* Finds where the code at the address physically is, returns false if its in memory
+     * which isnt cached (VRAM, external RAM, OAM, IO and echo RAM) */
+    if (address <= ROM_N0_16KB_END) {
+        *key = gb->blockCache.rom0Offset + address;
+        *regionEnd = ROM_N0_16KB_END;
+    } else if (address <= ROM_NN_16KB_END) {
+        *key = gb->blockCache.romNNOffset + (address - ROM_NN_16KB);
+        *regionEnd = ROM_NN_16KB_END;
+    } else if (address >= WRAM_N0_4KB && address < WRAM_NN_4KB) {
+        *key = BLOCK_KEY_RAM | (address - WRAM_N0_4KB);
+        *regionEnd = WRAM_NN_4KB - 1;
+    } else if (address >= WRAM_NN_4KB && address <= WRAM_NN_4KB_END) {
+        *key = BLOCK_KEY_RAM | ((gb->selectedWRAMBank * 0x1000) + (address - WRAM_NN_4KB));
+        *regionEnd = WRAM_NN_4KB_END;
+    } else if (address >= HRAM_N0 && address <= HRAM_N0_END) {
+        *key = BLOCK_KEY_RAM | (BLOCK_CODE_MAP_HRAM + (address - HRAM_N0));
+        *regionEnd = HRAM_N0_END;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static void countCodePages(GB* gb, CachedBlock* block, int change) {
+    /* WRAM pages stop or start being mapped for writing when the first block is added to
+     * them or the last one is dropped */
+    uint32_t offset = block->key & ~BLOCK_KEY_RAM;
+    uint16_t* codePages = gb->blockCache.codePages;
+
+    for (uint32_t page = offset / MEMORY_PAGE_SIZE; page <= (offset + block->size - 1) / MEMORY_PAGE_SIZE; page++) {
+        codePages[page] += change;
+        if (page * MEMORY_PAGE_SIZE < BLOCK_CODE_MAP_HRAM && codePages[page] == (change > 0 ? 1 : 0)) {
+            updateWRAMPageMapping(gb, page * MEMORY_PAGE_SIZE);
+        }
+    }
+}
+
+static void dropBlock(GB* gb, CachedBlock* block) {
+    if (block->valid && (block->key & BLOCK_KEY_RAM)) {
+        uint8_t* codeMap = &gb->blockCache.codeMap[block->key & ~BLOCK_KEY_RAM];
+        for (int i = 0; i < block->size; i++) codeMap[i]--;
+        countCodePages(gb, block, -1);
+    }
+
+    block->valid = false;
+}
+
+void blockcache_init(GB* gb) {
+    BlockCache* cache = &gb->blockCache;
+    cache->blocks = (CachedBlock*)calloc(BLOCK_CACHE_SIZE, sizeof(CachedBlock));
+    cache->codeMap = (uint8_t*)calloc(BLOCK_CODE_MAP_SIZE, 1);
+
+    if (cache->blocks == NULL || cache->codeMap == NULL) {
+        log_fatal(gb, "[FATAL] Could not allocate space for the block cache\n");
+        return;
+    }
+
+    memset(cache->codePages, 0, sizeof(cache->codePages));
+    cache->rom0Offset = 0;
+    cache->romNNOffset = 0x4000;
+    cache->blocksDecoded = 0;
+    cache->blocksInvalidated = 0;
+}
+
+void blockcache_free(GB* gb) {
+    free(gb->blockCache.blocks);
+    free(gb->blockCache.codeMap);
+    gb->blockCache.blocks = NULL;
+    gb->blockCache.codeMap = NULL;
+}
+
+void blockcache_flush(GB* gb) {
+    memset(gb->blockCache.blocks, 0, BLOCK_CACHE_SIZE * sizeof(CachedBlock));
+    memset(gb->blockCache.codeMap, 0, BLOCK_CODE_MAP_SIZE);
+    memset(gb->blockCache.codePages, 0, sizeof(gb->blockCache.codePages));
+    updateMemoryMap(gb, MEMORY_REGION_WRAM);
+    gb->nextInstruction = &blockcache_noInstruction;
+}
+
+void blockcache_syncBanks(GB* gb) {
+    gb->blockCache.rom0Offset = mbc_getSelectedROM0Bank(gb) * 0x4000;
+    gb->blockCache.romNNOffset = mbc_getSelectedROMBank(gb) * 0x4000;
+
+    /* The rest of the current block may be in a bank which isnt mapped anymore */
+    gb->nextInstruction = &blockcache_noInstruction;
+}
+
+static bool decodeBlock(GB* gb, CachedBlock* block, uint16_t address, uint16_t regionEnd) {
+    /* Decodes instructions until the block ends, instructions crossing the end of the
+     * region are left out since the next region can be switched independently */
+    block->count = 0;
+    block->size = 0;
+    block->cycles = 0;
+
+    while (block->count < BLOCK_MAX_INSTRUCTIONS) {
+        uint8_t opcode = readAddr(gb, address);
+        uint8_t length = opcodeLengths[opcode];
+        if ((uint32_t)address + length - 1 > regionEnd) break;
+
+        CachedInstruction* instruction = &block->instructions[block->count++];
+        instruction->address = address;
+        instruction->opcode = opcode;
+        instruction->length = length;
+        instruction->operands[0] = length > 1 ? readAddr(gb, address + 1) : 0;
+        instruction->operands[1] = length > 2 ? readAddr(gb, address + 2) : 0;
+        instruction->cycles = opcode == 0xCB ? getCBCycles(instruction->operands[0]) : opcodeCycles[opcode];
+
+        block->size += length;
+        block->cycles += instruction->cycles;
+        address += length;
+
+        if (endsBlock(opcode) || address - 1 == regionEnd) break;
+    }
+
+    /* Terminator */
+    block->instructions[block->count] = blockcache_noInstruction;
+    return block->count > 0;
+}
+
+CachedBlock* blockcache_lookupBlock(GB* gb, uint16_t address) {
+#ifdef DEBUG_NO_BLOCK_CACHE
+    return NULL;
+#endif
+    uint32_t key;
+    uint16_t regionEnd;
+    if (!getKey(gb, address, &key, &regionEnd)) return NULL;
+
+    BlockCache* cache = &gb->blockCache;
+    CachedBlock* block = &cache->blocks[getSlot(key)];
+    if (block->valid && block->key == key) return block;
+
+    /* Miss, the block in this slot is replaced */
+    dropBlock(gb, block);
+    if (!decodeBlock(gb, block, address, regionEnd)) return NULL;
+
+    block->key = key;
+    block->valid = true;
+    block->executions = 0;
+    block->jitFailed = false;
+    block->jitCode = NULL;
+    block->idleLoop = IDLE_LOOP_UNKNOWN;
+    cache->blocksDecoded++;
+
+    if (key & BLOCK_KEY_RAM) {
+        uint8_t* codeMap = &cache->codeMap[key & ~BLOCK_KEY_RAM];
+        for (int i = 0; i < block->size; i++) codeMap[i]++;
+        countCodePages(gb, block, 1);
+    }
+
+    return block;
+}
+
+const CachedInstruction* blockcache_lookup(GB* gb, uint16_t address) {
+    CachedBlock* block = blockcache_lookupBlock(gb, address);
+    return block != NULL ? &block->instructions[0] : &blockcache_noInstruction;
+}
+
+void blockcache_invalidate(GB* gb, uint32_t codeMapOffset) {
+    /* Blocks covering the byte start at most BLOCK_MAX_BYTES - 1 bytes before it */
+    BlockCache* cache = &gb->blockCache;
+    uint32_t first = codeMapOffset >= BLOCK_MAX_BYTES - 1 ? codeMapOffset - (BLOCK_MAX_BYTES - 1) : 0;
+
+    for (uint32_t start = first; start <= codeMapOffset && cache->codeMap[codeMapOffset] > 0; start++) {
+        uint32_t key = BLOCK_KEY_RAM | start;
+        CachedBlock* block = &cache->blocks[getSlot(key)];
+
+        if (block->valid && block->key == key && start + block->size > codeMapOffset) {
+            dropBlock(gb, block);
+            cache->blocksInvalidated++;
+        }
+    }
+
+    /* The CPU may be running the block which was just written over */
+    gb->nextInstruction = &blockcache_noInstruction;
+}
+
+void blockcache_printStats(GB* gb) {
+    printf("Blocks Decoded : %llu, Blocks Invalidated : %llu\n",
+            (unsigned long long)gb->blockCache.blocksDecoded,
+            (unsigned long long)gb->blockCache.blocksInvalidated);
+    printf("Idle Loop Cycles Skipped : %llu\n", (unsigned long long)gb->idleLoop.skippedCycles);
+}
@@ -2,7 +2,12 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <gb/cartridge.h>
+#include <gb/archive.h>
 
 bool initCartridge(Cartridge* c, uint8_t* data, size_t size) {
     if (data == NULL) {
@@ -11,11 +16,15 @@ bool initCartridge(Cartridge* c, uint8_t* data, size_t size) {
     }
 
 
-    if (size < 0x3FFF) {
+    if (size < 0x8000) {
+        /* Even cartridges without an MBC have 2 ROM banks */
         printf("Error : Too small cartridge\n");
         return false;
     }
     c->allocated = data;
+    c->size = size;
+    c->mapped = false;
+    c->savePath = NULL;
 
     /* Set the logo */
 
@@ -181,6 +190,102 @@ void printCartridge(Cartridge* c) {
     printf("==========================\n");
 }
 
+static char* getSavePath(const char* path) {
+    /* The extension of the ROM is replaced, or .sav is added if it has none. An archive
+     * extension is dropped first so game.gb.gz saves to game.sav like game.gb */
+    const char* name = strrchr(path, '/');
+    name = name != NULL ? name : path;
+    const char* extension = strrchr(name, '.');
+    size_t length = extension != NULL ? (size_t)(extension - path) : strlen(path);
+
+    if (extension != NULL && archive_isArchiveExtension(extension)) {
+        for (const char* c = extension - 1; c > name; c--) {
+            if (*c == '.') {
+                length = c - path;
+                break;
+            }
+        }
+    }
+
+    char* savePath = (char*)malloc(length + sizeof(".sav"));
+    if (savePath == NULL) return NULL;
+
+    memcpy(savePath, path, length);
+    strcpy(savePath + length, ".sav");
+    return savePath;
+}
+
+bool loadCartridge(Cartridge* c, const char* path) {
+    /* The ROM is mapped read only instead of being copied, so it is paged in straight from
+     * the page cache and every emulator running the same ROM shares the pages */
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error : Couldn't open input file\n");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        printf("Error : Invalid Cartridge File\n");
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    uint8_t* data = (uint8_t*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping stays valid after the file is closed */
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        printf("Error : Could not map input file\n");
+        return false;
+    }
+
+    ARCHIVE_FORMAT format = archive_detect(data, size);
+
+    if (format != ARCHIVE_NONE) {
+        /* Compressed ROMs are decompressed into a heap buffer, the archive is read once in
+         * order so it is only read ahead */
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        size_t romSize;
+        uint8_t* rom = archive_extract(data, size, format, &romSize);
+        munmap(data, size);
+
+        if (!initCartridge(c, rom, romSize)) {
+            free(rom);
+            return false;
+        }
+
+        c->savePath = getSavePath(path);
+        return true;
+    }
+
+    /* The whole ROM is read ahead since banks are accessed randomly */
+    madvise(data, size, MADV_WILLNEED);
+#if defined(MADV_HUGEPAGE) && defined(CARTRIDGE_HUGE_PAGES)
+    /* Only honoured if the kernel supports huge pages for the file system */
+    madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+    if (!initCartridge(c, data, size)) {
+        munmap(data, size);
+        return false;
+    }
+
+    c->mapped = true;
+    c->savePath = getSavePath(path);
+    return true;
+}
+
 void freeCartridge(Cartridge* c) {
-    free(c->allocated);
+    if (c->mapped) {
+        munmap(c->allocated, c->size);
+    } else {
+        free(c->allocated);
+    }
+
+    c->allocated = NULL;
+    free(c->savePath);
+    c->savePath = NULL;
 }
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <gb/gb.h>
 #include <gb/cpu.h>
+#include <gb/debug.h>
 
 #define PORT_ADDR 0xFF00
 
@@ -16,7 +17,8 @@
 #define LOAD_R_D8(gb, R) set_reg8(gb, R, readByte(gb)); cyclesSync_4(gb)
 /* Dereference the address contained in the R16 register and set it's value
  * to the R8 register */
-#define LOAD_R_ARR(gb, R, RR) set_reg8(gb, R, readAddr(gb, get_reg16(gb, RR))); cyclesSync_4(gb)
+#define LOAD_R_ARR(gb, R, RR) syncHardwareForAccess(gb, get_reg16(gb, RR)); \
+    set_reg8(gb, R, readAddr(gb, get_reg16(gb, RR))); cyclesSync_4(gb)
 /* Load 8 bit data into address at R16 register (dereferencing) */
 #define LOAD_ARR_D8(gb, RR) writeAddr_4C(gb, get_reg16(gb, RR), readByte_4C(gb))
 /* Load contents of R8 register into another R8 register */
@@ -51,7 +53,7 @@
 #define PUSH_R16(gb, RR) cyclesSync_4(gb); push16(gb, get_reg16(gb, RR))
 #define POP_R16(gb, RR) set_reg16(gb, RR, pop16(gb))
 #define RST(gb, a16) call(gb, a16)
-#define INTERRUPT_MASTER_ENABLE(gb) gb->scheduleInterruptEnable = true
+#define INTERRUPT_MASTER_ENABLE(gb) gb->scheduleInterruptEnable = true; gb->cpuEventPending = true
 #define INTERRUPT_MASTER_DISABLE(gb) gb->IME = false
 #define CCF(gb) set_flag(gb, FLAG_C, get_flag(gb, FLAG_C) ^ 1); \
     set_flag(gb, FLAG_N, 0);                        \
@@ -82,26 +84,83 @@ static inline void writeAddr_4C(GB* gb, uint16_t addr, uint8_t byte);
 static inline uint8_t readAddr_4C(GB* gb, uint16_t addr);
 
 static inline uint8_t readByte(GB* gb) {
-    /* Reads a byte and doesnt consume any cycles */
+    /* Reads a byte and doesnt consume any cycles, instructions from the block cache
+     * already have their operands decoded */
+    if (gb->operandCursor != NULL) {
+        gb->PC++;
+        return *gb->operandCursor++;
+    }
+
+    syncHardwareForAccess(gb, gb->PC);
     return readAddr(gb, gb->PC++);
 }
 
 static inline uint8_t readByte_4C(GB* gb) {
     /* Reads a byte and consumes 4 cycles */
-    return readAddr_4C(gb, gb->PC++);
+    uint8_t byte = readByte(gb);
+    cyclesSync_4(gb);
+
+    return byte;
 }
 
 static inline uint16_t read2Bytes(GB* gb) {
     /* Reads 2 bytes and doesnt consume any cycles */
-    return (uint16_t)(readAddr(gb, gb->PC++) | readAddr(gb, gb->PC++) << 8);
+    uint8_t low = readByte(gb);
+    return (uint16_t)(low | readByte(gb) << 8);
 }
 
 static uint16_t read2Bytes_8C(GB* gb) {
     /* Reads 2 bytes and consumes 8 cycles, 4 per byte */
-    return (uint16_t)(readAddr_4C(gb, gb->PC++) | (readAddr_4C(gb, gb->PC++) << 8));
+    uint8_t low = readByte_4C(gb);
+    return (uint16_t)(low | (readByte_4C(gb) << 8));
+}
+
+static uint8_t computeFlags(GB* gb) {
+    /* Flags of the last ALU instruction, or F if they were computed already */
+    const LazyFlags* lazy = &gb->lazyFlags;
+    uint8_t x = lazy->x;
+    uint8_t y = lazy->y;
+    uint8_t carry = lazy->carry;
+    uint8_t z = lazy->result == 0 ? 0x80 : 0;
+
+    switch (lazy->op) {
+        case FLAG_OP_ADD:       return z | (((x & 0xF) + (y & 0xF) > 0xF) << 5) | ((x + y > 0xFF) << 4);
+        case FLAG_OP_ADC:       return z | (((x & 0xF) + (y & 0xF) + carry > 0xF) << 5) |
+                                       ((x + y + carry > 0xFF) << 4);
+        case FLAG_OP_SUB:       return z | 0x40 | (((x & 0xF) < (y & 0xF)) << 5) | ((x < y) << 4);
+        case FLAG_OP_SBC:       return z | 0x40 | (((x & 0xF) < (y & 0xF) + carry) << 5) |
+                                       ((x < y + carry) << 4);
+        case FLAG_OP_AND:       return z | 0x20;
+        case FLAG_OP_LOGIC:     return z;
+        case FLAG_OP_INC:       return z | (((x & 0xF) == 0xF) << 5) | (carry << 4);
+        case FLAG_OP_DEC:       return z | 0x40 | (((x & 0xF) == 0) << 5) | (carry << 4);
+        case FLAG_OP_BIT:       return z | 0x20 | (carry << 4);
+        case FLAG_OP_SHIFT:     return z | (carry << 4);
+        case FLAG_OP_SHIFT_A:   return carry << 4;
+        default:                return gb->GPR[R8_F];
+    }
+}
+
+void syncFlags(GB* gb) {
+    gb->GPR[R8_F] = computeFlags(gb);
+    gb->lazyFlags.op = FLAG_OP_NONE;
+}
+
+uint8_t getFlagRegister(GB* gb) {
+    return computeFlags(gb);
+}
+
+static inline void record_flags(GB* gb, FLAG_OP op, uint8_t x, uint8_t y, uint8_t carry, uint8_t result) {
+    /* Flags are computed from this when something reads F */
+    gb->lazyFlags.op = op;
+    gb->lazyFlags.x = x;
+    gb->lazyFlags.y = y;
+    gb->lazyFlags.carry = carry;
+    gb->lazyFlags.result = result;
 }
 
 static inline uint8_t get_reg8(GB* gb, GP_REG R) {
+    if (R == R8_F && gb->lazyFlags.op != FLAG_OP_NONE) syncFlags(gb);
     return gb->GPR[R];
 }
 
@@ -114,6 +173,8 @@ static inline void dec_reg8(GB* gb, GP_REG R) {
 }
 
 static inline void set_reg8(GB* gb, GP_REG R, uint8_t value) {
+    /* Writing F drops the flags of the last ALU instruction */
+    if (R == R8_F) gb->lazyFlags.op = FLAG_OP_NONE;
     gb->GPR[R] = value;
 }
 
@@ -130,27 +191,23 @@ static inline uint8_t get_flag(GB* gb, FLAG flag) {
     return (get_reg8(gb, R8_F) >> (flag + 4)) & 1;
 }
 
-/* Retrives the value of the 16 bit registers by combining the values
- * of its 8 bit registers */
-static inline uint16_t get_reg16(GB* gb, GP_REG RR) {
-    return ((get_reg8(gb, RR) << 8) | get_reg8(gb, RR + 1));
+/* Register pairs are stored natively, only AF has to bring F up to date */
+static inline uint16_t get_reg16(GB* gb, GP_REG16 RR) {
+    if (RR == R16_AF && gb->lazyFlags.op != FLAG_OP_NONE) syncFlags(gb);
+    return gb->GPR16[RR];
 }
 
-/* Sets 16 bit register by modifying the individual 8 bit registers
- * it consists of */
-static inline uint16_t set_reg16(GB* gb, GP_REG RR, uint16_t v) {
-    set_reg8(gb, RR, v >> 8);
-    set_reg8(gb, RR + 1, v & 0xFF);
+static inline uint16_t set_reg16(GB* gb, GP_REG16 RR, uint16_t v) {
+    if (RR == R16_AF) gb->lazyFlags.op = FLAG_OP_NONE;
+    gb->GPR16[RR] = v;
 
     return v;
 }
 
-static uint16_t set_reg16_8C(GB* gb, GP_REG RR, uint16_t v) {
+static uint16_t set_reg16_8C(GB* gb, GP_REG16 RR, uint16_t v) {
     /* Takes 8 clock cycles */
-    set_reg8(gb, RR, v >> 8);
+    set_reg16(gb, RR, v);
     cyclesSync_4(gb);
-
-    set_reg8(gb, RR + 1, v & 0xFF);
     cyclesSync_4(gb);
     return v;
 }
@@ -192,6 +249,10 @@ void resetGBC(GB* gb) {
     /* Reset all background colors to white (ffff) */
     memset(gb->bgColorRAM, 0xFF, 64);
     memset(gb->spriteColorRAM, 0xFF, 64);
+    for (int i = 0; i < 32; i++) {
+        updatePaletteColor_CGB(gb, false, i);
+        updatePaletteColor_CGB(gb, true, i);
+    }
     /* 0xFF50 to 0xFFFE = 0xFF */
     memset(&gb->IO[0x50], 0xFF, 0xAF);
 	gb->IO[R_SVBK] = 0xF9; 					// Default bank
@@ -236,7 +297,7 @@ void resetGB(GB* gb) {
     INTERRUPT_MASTER_DISABLE(gb);
 }
 
-static void load_rr_rri8(GB* gb, GP_REG RR1, GP_REG RR2) {
+static void load_rr_rri8(GB* gb, GP_REG16 RR1, GP_REG16 RR2) {
     /* Opcode 0xF8 specific
      *
      * RR1 = RR2 + I8 */
@@ -266,9 +327,8 @@ static void incrementR8(GB* gb, GP_REG R) {
     uint8_t old = get_reg8(gb, R);
     inc_reg8(gb, R);
 
-    TEST_Z_FLAG(gb, get_reg8(gb, R));
-    TEST_H_FLAG_ADD(gb, old, 1);
-    set_flag(gb, FLAG_N, 0);
+    /* Carry is kept */
+    record_flags(gb, FLAG_OP_INC, old, 1, get_flag(gb, FLAG_C), get_reg8(gb, R));
 }
 
 static void decrementR8(GB* gb, GP_REG R) {
@@ -276,9 +336,7 @@ static void decrementR8(GB* gb, GP_REG R) {
     uint8_t old = get_reg8(gb, R);
     dec_reg8(gb, R);
 
-    TEST_Z_FLAG(gb, get_reg8(gb, R));
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, 1);
+    record_flags(gb, FLAG_OP_DEC, old, 1, get_flag(gb, FLAG_C), get_reg8(gb, R));
 }
 
 /* The folloing functions are used for all 8 bit rotation
@@ -293,17 +351,10 @@ static void rotateLeftR8(GB* gb, GP_REG R, bool setZFlag) {
     toModify |= bit7;
 
     set_reg8(gb, R, toModify);
-    if (setZFlag) {
-        TEST_Z_FLAG(gb, toModify);
-    } else {
-        set_flag(gb, FLAG_Z, 0);
-    }
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit7, toModify);
 }
 
-static void rotateLeftAR16(GB* gb, GP_REG R16, bool setZFlag) {
+static void rotateLeftAR16(GB* gb, GP_REG16 R16, bool setZFlag) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t toModify = readAddr_4C(gb, addr);
     uint8_t bit7 = toModify >> 7;
@@ -312,14 +363,7 @@ static void rotateLeftAR16(GB* gb, GP_REG R16, bool setZFlag) {
     toModify |= bit7;
 
     writeAddr_4C(gb, addr, toModify);
-    if (setZFlag) {
-        TEST_Z_FLAG(gb, toModify);
-    } else {
-        set_flag(gb, FLAG_Z, 0);
-    }
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit7, toModify);
 }
 
 static void rotateRightR8(GB* gb, GP_REG R, bool setZFlag) {
@@ -332,17 +376,10 @@ static void rotateRightR8(GB* gb, GP_REG R, bool setZFlag) {
 
     set_reg8(gb, R, toModify);
 
-    if (setZFlag) {
-        TEST_Z_FLAG(gb, toModify);
-    } else {
-        set_flag(gb, FLAG_Z, 0);
-    }
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit1);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit1, toModify);
 }
 
-static void rotateRightAR16(GB* gb, GP_REG R16, bool setZFlag) {
+static void rotateRightAR16(GB* gb, GP_REG16 R16, bool setZFlag) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t toModify = readAddr_4C(gb, addr);
     uint8_t bit1 = toModify & 1;
@@ -352,12 +389,7 @@ static void rotateRightAR16(GB* gb, GP_REG R16, bool setZFlag) {
 
     writeAddr_4C(gb, addr, toModify);
 
-    if (setZFlag) TEST_Z_FLAG(gb, toModify);
-    else set_flag(gb, FLAG_Z, 0);
-
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit1);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit1, toModify);
 }
 
 static void rotateLeftCarryR8(GB* gb, GP_REG R8, bool setZFlag) {
@@ -372,15 +404,10 @@ static void rotateLeftCarryR8(GB* gb, GP_REG R8, bool setZFlag) {
 
     set_reg8(gb, R8, toModify);
 
-    if (setZFlag) TEST_Z_FLAG(gb, toModify);
-    else set_flag(gb, FLAG_Z, 0);
-
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit7, toModify);
 }
 
-static void rotateLeftCarryAR16(GB* gb, GP_REG R16, bool setZFlag) {
+static void rotateLeftCarryAR16(GB* gb, GP_REG16 R16, bool setZFlag) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t toModify = readAddr_4C(gb, addr);
     bool carryFlag = get_flag(gb, FLAG_C);
@@ -391,12 +418,7 @@ static void rotateLeftCarryAR16(GB* gb, GP_REG R16, bool setZFlag) {
 
     writeAddr_4C(gb, addr, toModify);
 
-    if (setZFlag) TEST_Z_FLAG(gb, toModify);
-    else set_flag(gb, FLAG_Z, 0);
-
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit7, toModify);
 }
 
 static void rotateRightCarryR8(GB* gb, GP_REG R8, bool setZFlag) {
@@ -411,15 +433,10 @@ static void rotateRightCarryR8(GB* gb, GP_REG R8, bool setZFlag) {
 
     set_reg8(gb, R8, toModify);
 
-    if (setZFlag) TEST_Z_FLAG(gb, toModify);
-    else set_flag(gb, FLAG_Z, 0);
-
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit0);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit0, toModify);
 }
 
-static void rotateRightCarryAR16(GB* gb, GP_REG R16, bool setZFlag) {
+static void rotateRightCarryAR16(GB* gb, GP_REG16 R16, bool setZFlag) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t toModify = readAddr_4C(gb, addr);
     bool carryFlag = get_flag(gb, FLAG_C);
@@ -430,12 +447,7 @@ static void rotateRightCarryAR16(GB* gb, GP_REG R16, bool setZFlag) {
 
     writeAddr_4C(gb, addr, toModify);
 
-    if (setZFlag) TEST_Z_FLAG(gb, toModify);
-    else set_flag(gb, FLAG_Z, 0);
-
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit0);
+    record_flags(gb, setZFlag ? FLAG_OP_SHIFT : FLAG_OP_SHIFT_A, 0, 0, bit0, toModify);
 }
 
 static void shiftLeftArithmeticR8(GB* gb, GP_REG R) {
@@ -445,13 +457,10 @@ static void shiftLeftArithmeticR8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit7, result);
 }
 
-static void shiftLeftArithmeticAR16(GB* gb, GP_REG R16) {
+static void shiftLeftArithmeticAR16(GB* gb, GP_REG16 R16) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t bit7 = value >> 7;
@@ -459,10 +468,7 @@ static void shiftLeftArithmeticAR16(GB* gb, GP_REG R16) {
 
     writeAddr_4C(gb, addr, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit7);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit7, result);
 }
 
 static void shiftRightLogicalR8(GB* gb, GP_REG R) {
@@ -472,13 +478,10 @@ static void shiftRightLogicalR8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit1);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit1, result);
 }
 
-static void shiftRightLogicalAR16(GB* gb, GP_REG R16) {
+static void shiftRightLogicalAR16(GB* gb, GP_REG16 R16) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t bit1 = value & 0x1;
@@ -486,10 +489,7 @@ static void shiftRightLogicalAR16(GB* gb, GP_REG R16) {
 
     writeAddr_4C(gb, addr, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit1);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit1, result);
 }
 
 static void shiftRightArithmeticR8(GB* gb, GP_REG R) {
@@ -502,13 +502,10 @@ static void shiftRightArithmeticR8(GB* gb, GP_REG R) {
     result |= bit7 << 7;
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit0);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit0, result);
 }
 
-static void shiftRightArithmeticAR16(GB* gb, GP_REG R16) {
+static void shiftRightArithmeticAR16(GB* gb, GP_REG16 R16) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t bit7 = value >> 7;
@@ -519,10 +516,7 @@ static void shiftRightArithmeticAR16(GB* gb, GP_REG R16) {
     result |= bit7 << 7;
     writeAddr_4C(gb, addr, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, bit0);
+    record_flags(gb, FLAG_OP_SHIFT, 0, 0, bit0, result);
 }
 
 static void swapR8(GB* gb, GP_REG R8) {
@@ -534,13 +528,10 @@ static void swapR8(GB* gb, GP_REG R8) {
 
     set_reg8(gb, R8, newValue);
 
-    TEST_Z_FLAG(gb, newValue);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, 0, 0, 0, newValue);
 }
 
-static void swapAR16(GB* gb, GP_REG R16) {
+static void swapAR16(GB* gb, GP_REG16 R16) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t highNibble = value >> 4;
@@ -550,28 +541,23 @@ static void swapAR16(GB* gb, GP_REG R16) {
 
     writeAddr_4C(gb, addr, newValue);
 
-    TEST_Z_FLAG(gb, newValue);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, 0, 0, 0, newValue);
 }
 
 static void testBitR8(GB* gb, GP_REG R8, uint8_t bit) {
     uint8_t value = get_reg8(gb, R8);
     uint8_t bitValue = (value >> bit) & 0x1;
 
-    TEST_Z_FLAG(gb, bitValue);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 1);
+    /* Carry is kept */
+    record_flags(gb, FLAG_OP_BIT, value, bit, get_flag(gb, FLAG_C), bitValue);
 }
 
-static void testBitAR16(GB* gb, GP_REG R16, uint8_t bit) {
+static void testBitAR16(GB* gb, GP_REG16 R16, uint8_t bit) {
     uint8_t value = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t bitValue = (value >> bit) & 0x1;
 
-    TEST_Z_FLAG(gb, bitValue);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 1);
+    /* Carry is kept */
+    record_flags(gb, FLAG_OP_BIT, value, bit, get_flag(gb, FLAG_C), bitValue);
 }
 
 static void setBitR8(GB* gb, GP_REG R8, uint8_t bit) {
@@ -582,7 +568,7 @@ static void setBitR8(GB* gb, GP_REG R8, uint8_t bit) {
     set_reg8(gb, R8, result);
 }
 
-static void setBitAR16(GB* gb, GP_REG R16, uint8_t bit) {
+static void setBitAR16(GB* gb, GP_REG16 R16, uint8_t bit) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t orValue = 1 << bit;
@@ -600,7 +586,7 @@ static void resetBitR8(GB* gb, GP_REG R8, uint8_t bit) {
     set_reg8(gb, R8, result);
 }
 
-static void resetBitAR16(GB* gb, GP_REG R16, uint8_t bit) {
+static void resetBitAR16(GB* gb, GP_REG16 R16, uint8_t bit) {
     uint16_t addr = get_reg16(gb, R16);
     uint8_t value = readAddr_4C(gb, addr);
     uint8_t andValue = ~(1 << bit);
@@ -612,7 +598,7 @@ static void resetBitAR16(GB* gb, GP_REG R16, uint8_t bit) {
 /* The following functions form the most of the arithmetic and logical
  * operations of the CPU */
 
-static void addR16(GB* gb, GP_REG RR1, GP_REG RR2) {
+static void addR16(GB* gb, GP_REG16 RR1, GP_REG16 RR2) {
     uint16_t old = get_reg16(gb, RR1);
     uint16_t toAdd = get_reg16(gb, RR2);
     uint16_t result = set_reg16(gb, RR1, old + toAdd);
@@ -626,7 +612,7 @@ static void addR16(GB* gb, GP_REG RR1, GP_REG RR2) {
 
 /* Adding a signed 8 bit integer to a 16 bit register */
 
-static void addR16I8(GB* gb, GP_REG RR) {
+static void addR16I8(GB* gb, GP_REG16 RR) {
     uint16_t old = get_reg16(gb, RR);
     int8_t toAdd = (int8_t)readByte_4C(gb);
     uint16_t result = set_reg16_8C(gb, RR, old + toAdd);
@@ -650,10 +636,7 @@ static void addR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    TEST_H_FLAG_ADD(gb, old, toAdd);
-    TEST_C_FLAG_ADD8(gb, old, toAdd);
+    record_flags(gb, FLAG_OP_ADD, old, toAdd, 0, result);
 }
 
 static void addR8D8(GB* gb, GP_REG R) {
@@ -663,51 +646,17 @@ static void addR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    TEST_H_FLAG_ADD(gb, old, data);
-    TEST_C_FLAG_ADD8(gb, old, data);
+    record_flags(gb, FLAG_OP_ADD, old, data, 0, result);
 }
 
-static void addR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void addR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t toAdd = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old + toAdd;
 
     set_reg8(gb, R8, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    TEST_H_FLAG_ADD(gb, old, toAdd);
-    TEST_C_FLAG_ADD8(gb, old, toAdd);
-}
-
-static void test_adc_hcflags(GB* gb, uint8_t old, uint8_t toAdd, uint8_t result, uint8_t carry) {
-    /* ADC has a slightly different behaviour i.e it adds the
-     * carry flag to the result, the normal H & C flag tests
-     * have edge cases if used with ADC, so we do a custom test here */
-
-    bool halfCarryOccurred = false;
-    bool carryOccured = false;
-
-    /* Half carry - It can occur either when:
-     * 1. The initial value is added to the value that has to be added
-     * 2. The result of the above is added to the carry flag
-     *
-     * We note if a half carry occured in both the cases */
-
-    if (((old & 0xF) + (toAdd & 0xF)) > 0xF) halfCarryOccurred = true;
-    if (((result & 0xF) + (carry & 0xF)) > 0xF) halfCarryOccurred = true;
-
-    /* Carry Flag - When theres an integer overflow for the 8 bit addition
-     * we set the carry flag, the overflow must also be calculated separately like
-     * we did for half carry */
-
-    if (((uint16_t)old + (uint16_t)toAdd) > 0xFF) carryOccured = true;
-    if (((uint16_t)result + (uint16_t)carry) > 0xFF) carryOccured = true;
-
-    set_flag(gb, FLAG_H, halfCarryOccurred);
-    set_flag(gb, FLAG_C, carryOccured);
+    record_flags(gb, FLAG_OP_ADD, old, toAdd, 0, result);
 }
 
 static void adcR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -719,9 +668,7 @@ static void adcR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 0);
-    test_adc_hcflags(gb, old, toAdd, result, carry);
+    record_flags(gb, FLAG_OP_ADC, old, toAdd, carry, finalResult);
 }
 
 static void adcR8D8(GB* gb, GP_REG R) {
@@ -733,12 +680,10 @@ static void adcR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 0);
-    test_adc_hcflags(gb, old, data, result, carry);
+    record_flags(gb, FLAG_OP_ADC, old, data, carry, finalResult);
 }
 
-static void adcR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void adcR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t toAdd = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t carry = get_flag(gb, FLAG_C);
@@ -747,9 +692,7 @@ static void adcR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
 
     set_reg8(gb, R8, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 0);
-    test_adc_hcflags(gb, old, toAdd, result, carry);
+    record_flags(gb, FLAG_OP_ADC, old, toAdd, carry, finalResult);
 }
 
 static void subR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -759,10 +702,7 @@ static void subR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, toSub);
-    TEST_C_FLAG_SUB8(gb, old, toSub);
+    record_flags(gb, FLAG_OP_SUB, old, toSub, 0, result);
 }
 
 static void subR8D8(GB* gb, GP_REG R) {
@@ -772,41 +712,17 @@ static void subR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, data);
-    TEST_C_FLAG_SUB8(gb, old, data);
+    record_flags(gb, FLAG_OP_SUB, old, data, 0, result);
 }
 
-static void subR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void subR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t toSub = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old - toSub;
 
     set_reg8(gb, R8, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, toSub);
-    TEST_C_FLAG_SUB8(gb, old, toSub);
-}
-
-static void test_sbc_hcflags(GB* gb, uint8_t old, uint8_t toSub, uint8_t result, uint8_t carry) {
-    /* SBC is also similar to ADC so we need a custom test here aswell */
-    bool halfCarryOccurred = false;
-    bool carryOccurred = false;
-
-    uint8_t oldLow = old & 0xF;
-    uint8_t resultLow = result & 0xF;
-
-    if ((uint8_t)(oldLow - (toSub & 0xF)) > oldLow) halfCarryOccurred = true;
-    if ((uint8_t)(resultLow - carry) > resultLow) halfCarryOccurred = true;
-
-    if ((uint8_t)((uint16_t)old - (uint16_t)toSub) > old) carryOccurred = true;
-    if ((uint8_t)((uint16_t)result - carry) > result) carryOccurred = true;
-
-    set_flag(gb, FLAG_H, halfCarryOccurred);
-    set_flag(gb, FLAG_C, carryOccurred);
+    record_flags(gb, FLAG_OP_SUB, old, toSub, 0, result);
 }
 
 static void sbcR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -818,9 +734,7 @@ static void sbcR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 1);
-    test_sbc_hcflags(gb, old, toSub, result, carry);
+    record_flags(gb, FLAG_OP_SBC, old, toSub, carry, finalResult);
 }
 
 static void sbcR8D8(GB* gb, GP_REG R) {
@@ -832,12 +746,10 @@ static void sbcR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 1);
-    test_sbc_hcflags(gb, old, data, result, carry);
+    record_flags(gb, FLAG_OP_SBC, old, data, carry, finalResult);
 }
 
-static void sbcR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void sbcR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t toSub = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t carry = get_flag(gb, FLAG_C);
@@ -846,9 +758,7 @@ static void sbcR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
 
     set_reg8(gb, R8, finalResult);
 
-    TEST_Z_FLAG(gb, finalResult);
-    set_flag(gb, FLAG_N, 1);
-    test_sbc_hcflags(gb, old, toSub, result, carry);
+    record_flags(gb, FLAG_OP_SBC, old, toSub, carry, finalResult);
 }
 
 static void andR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -858,10 +768,7 @@ static void andR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 1);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_AND, old, operand, 0, result);
 }
 
 static void andR8D8(GB* gb, GP_REG R) {
@@ -871,23 +778,17 @@ static void andR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 1);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_AND, old, operand, 0, result);
 }
 
-static void andR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void andR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t operand = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old & operand;
 
     set_reg8(gb, R8, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 1);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_AND, old, operand, 0, result);
 }
 
 static void xorR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -897,10 +798,7 @@ static void xorR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
 static void xorR8D8(GB* gb, GP_REG R) {
@@ -910,23 +808,17 @@ static void xorR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
-static void xorR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void xorR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t operand = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old ^ operand;
 
     set_reg8(gb, R8, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
 static void orR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -936,10 +828,7 @@ static void orR8(GB* gb, GP_REG R1, GP_REG R2) {
 
     set_reg8(gb, R1, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
 static void orR8D8(GB* gb, GP_REG R) {
@@ -949,23 +838,17 @@ static void orR8D8(GB* gb, GP_REG R) {
 
     set_reg8(gb, R, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
-static void orR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void orR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t operand = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old | operand;
 
     set_reg8(gb, R8, result);
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 0);
-    set_flag(gb, FLAG_H, 0);
-    set_flag(gb, FLAG_C, 0);
+    record_flags(gb, FLAG_OP_LOGIC, old, operand, 0, result);
 }
 
 static void compareR8(GB* gb, GP_REG R1, GP_REG R2) {
@@ -974,10 +857,7 @@ static void compareR8(GB* gb, GP_REG R1, GP_REG R2) {
     uint8_t toSub = get_reg8(gb, R2);
     uint8_t result = old - toSub;
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, toSub);
-    TEST_C_FLAG_SUB8(gb, old, toSub);
+    record_flags(gb, FLAG_OP_SUB, old, toSub, 0, result);
 }
 
 static void compareR8D8(GB* gb, GP_REG R) {
@@ -985,21 +865,15 @@ static void compareR8D8(GB* gb, GP_REG R) {
     uint8_t toSub = readByte_4C(gb);
     uint8_t result = old - toSub;
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, toSub);
-    TEST_C_FLAG_SUB8(gb, old, toSub);
+    record_flags(gb, FLAG_OP_SUB, old, toSub, 0, result);
 }
 
-static void compareR8_AR16(GB* gb, GP_REG R8, GP_REG R16) {
+static void compareR8_AR16(GB* gb, GP_REG R8, GP_REG16 R16) {
     uint8_t old = get_reg8(gb, R8);
     uint8_t toSub = readAddr_4C(gb, get_reg16(gb, R16));
     uint8_t result = old - toSub;
 
-    TEST_Z_FLAG(gb, result);
-    set_flag(gb, FLAG_N, 1);
-    TEST_H_FLAG_SUB(gb, old, toSub);
-    TEST_C_FLAG_SUB8(gb, old, toSub);
+    record_flags(gb, FLAG_OP_SUB, old, toSub, 0, result);
 }
 
 /* The following functions are responsible for returning, calling & stack manipulation*/
@@ -1068,6 +942,49 @@ static void cpl(GB* gb) {
     set_flag(gb, FLAG_H, 1);
 }
 
+static void scf(GB* gb) {
+    set_flag(gb, FLAG_C, 1);
+    set_flag(gb, FLAG_N, 0);
+    set_flag(gb, FLAG_H, 0);
+}
+
+static void storeSP(GB* gb) {
+    /* LD (a16), SP */
+    uint16_t a = read2Bytes_8C(gb);
+    uint16_t sp = get_reg16(gb, R16_SP);
+    /* Write high byte to high and low byte to low */
+    writeAddr_4C(gb, a+1, sp >> 8);
+    writeAddr_4C(gb, a, sp & 0xFF);
+}
+
+static void incrementAR16(GB* gb, GP_REG16 R16) {
+    /* Increment what is at the address in R16 */
+    uint16_t address = get_reg16(gb, R16);
+    uint8_t old = readAddr_4C(gb, address);
+    uint8_t new = old + 1;
+
+    record_flags(gb, FLAG_OP_INC, old, 1, get_flag(gb, FLAG_C), new);
+    writeAddr_4C(gb, address, new);
+}
+
+static void decrementAR16(GB* gb, GP_REG16 R16) {
+    /* Decrement what is at the address in R16 */
+    uint16_t address = get_reg16(gb, R16);
+    uint8_t old = readAddr_4C(gb, address);
+    uint8_t new = old - 1;
+
+    record_flags(gb, FLAG_OP_DEC, old, 1, get_flag(gb, FLAG_C), new);
+    writeAddr_4C(gb, address, new);
+}
+
+static void popAF(GB* gb) {
+    POP_R16(gb, R16_AF);
+
+    /* Always clear the lower 4 bits, they need to always
+     * be 0, we failed a blargg test because of this lol */
+    set_reg8(gb, R8_F, get_reg8(gb, R8_F) & 0xF0);
+}
+
 /* Conditional Jumps (both relative and direct) */
 
 #define CONDITION_NZ(gb) (get_flag(gb, FLAG_Z) != 1)
@@ -1133,22 +1050,107 @@ static void decimalAdjust(GB* gb) {
      * 'https://github.com/guigzzz/GoGB/blob/master/backend/cpu_arithmetic.go#L349' */
 }
 
+static void mapPages(uint8_t** map, uint16_t start, uint16_t end, uint8_t* memory) {
+    /* Maps the memory from start to end, or makes accesses go through the handlers
+     * if its NULL */
+    for (unsigned int page = start / MEMORY_PAGE_SIZE; page <= end / MEMORY_PAGE_SIZE; page++) {
+        map[page] = memory != NULL ? memory + (page * MEMORY_PAGE_SIZE - start) : NULL;
+    }
+}
+
+static void mapWRAMPages(GB* gb, uint16_t start, uint16_t end, uint32_t wramOffset) {
+    /* Writes to pages with cached code have to invalidate blocks */
+    mapPages(gb->readMap, start, end, &gb->wram[wramOffset]);
+    for (unsigned int page = start / MEMORY_PAGE_SIZE; page <= end / MEMORY_PAGE_SIZE; page++) {
+        uint32_t offset = wramOffset + (page * MEMORY_PAGE_SIZE - start);
+        bool hasCode = gb->blockCache.codePages[offset / MEMORY_PAGE_SIZE] > 0;
+        gb->writeMap[page] = hasCode ? NULL : &gb->wram[offset];
+    }
+}
+
+void updateWRAMPageMapping(GB* gb, uint32_t wramOffset) {
+    uint32_t page = wramOffset / MEMORY_PAGE_SIZE;
+    uint8_t* mapped = gb->blockCache.codePages[page] > 0 ? NULL : &gb->wram[page * MEMORY_PAGE_SIZE];
+    uint32_t bankOffset = gb->selectedWRAMBank * 0x1000;
+
+    if (wramOffset < 0x1000) {
+        gb->writeMap[(WRAM_N0_4KB + wramOffset) / MEMORY_PAGE_SIZE] = mapped;
+        gb->writeMap[(ECHO_N0_8KB + wramOffset) / MEMORY_PAGE_SIZE] = mapped;
+    } else if (wramOffset >= bankOffset && wramOffset < bankOffset + 0x1000) {
+        gb->writeMap[(WRAM_NN_4KB + wramOffset - bankOffset) / MEMORY_PAGE_SIZE] = mapped;
+        /* Echo RAM ignores banking and ends before the last two pages of bank 1 */
+        if (wramOffset + ECHO_N0_8KB <= ECHO_N0_8KB_END) {
+            gb->writeMap[(ECHO_N0_8KB + wramOffset) / MEMORY_PAGE_SIZE] = mapped;
+        }
+    } else if (wramOffset < 0x2000 && wramOffset + ECHO_N0_8KB <= ECHO_N0_8KB_END) {
+        gb->writeMap[(ECHO_N0_8KB + wramOffset) / MEMORY_PAGE_SIZE] = mapped;
+    }
+}
+
+void updateMemoryMap(GB* gb, MEMORY_REGION region) {
+    switch (region) {
+        case MEMORY_REGION_ROM: {
+            /* Games write to the MBC all the time, often without switching banks. Writes are
+             * MBC register writes, so the write pages stay NULL */
+            if (gb->readMap[ROM_N0_16KB / MEMORY_PAGE_SIZE] != gb->rom0Bank) {
+                mapPages(gb->readMap, ROM_N0_16KB, ROM_N0_16KB_END, gb->rom0Bank);
+            }
+            if (gb->readMap[ROM_NN_16KB / MEMORY_PAGE_SIZE] != gb->romNNBank) {
+                mapPages(gb->readMap, ROM_NN_16KB, ROM_NN_16KB_END, gb->romNNBank);
+            }
+            break;
+        }
+        case MEMORY_REGION_VRAM: {
+            /* Writes mark tiles dirty */
+            uint8_t* bank = &gb->vram[gb->selectedVRAMBank * 0x2000];
+            mapPages(gb->readMap, VRAM_N0_8KB, VRAM_N0_8KB_END, gb->lockVRAM ? NULL : bank);
+            mapPages(gb->writeMap, VRAM_N0_8KB, VRAM_N0_8KB_END, NULL);
+            break;
+        }
+        case MEMORY_REGION_EXTERNAL_RAM: {
+            if (gb->readMap[RAM_NN_8KB / MEMORY_PAGE_SIZE] == gb->externalRAMBank) break;
+
+            /* Writes to saved RAM mark pages dirty */
+            mapPages(gb->readMap, RAM_NN_8KB, RAM_NN_8KB_END, gb->externalRAMBank);
+            mapPages(gb->writeMap, RAM_NN_8KB, RAM_NN_8KB_END, gb->save.mapped ? NULL : gb->externalRAMBank);
+            break;
+        }
+        case MEMORY_REGION_WRAM:
+            mapWRAMPages(gb, WRAM_N0_4KB, WRAM_N0_4KB_END, 0);
+            mapWRAMPages(gb, WRAM_NN_4KB, WRAM_NN_4KB_END, gb->selectedWRAMBank * 0x1000);
+            /* Echo RAM ignores banking */
+            mapWRAMPages(gb, ECHO_N0_8KB, ECHO_N0_8KB_END, 0);
+            break;
+        case MEMORY_REGION_WRAM_BANK:
+            mapWRAMPages(gb, WRAM_NN_4KB, WRAM_NN_4KB_END, gb->selectedWRAMBank * 0x1000);
+            break;
+        default: break;
+    }
+}
+
 /* This function is responsible for writing 1 byte to a memory address */
 
 void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
 #ifdef DEBUG_MEM_LOGGING
     printf("Writing 0x%02x to address 0x%04x\n", byte, addr);
 #endif
+    uint8_t* page = gb->writeMap[addr / MEMORY_PAGE_SIZE];
+    if (page != NULL) {
+        page[addr % MEMORY_PAGE_SIZE] = byte;
+        return;
+    }
 
     if (addr >= WRAM_N0_4KB && addr <= WRAM_NN_4KB_END) {
+        /* Bank 0 unless its the switchable bank */
+        uint16_t wramAddress = addr - WRAM_N0_4KB;
         if (addr >= WRAM_NN_4KB) {
             /* Respect banking */
-            gb->wram[(gb->selectedWRAMBank * 0x1000) + (addr - WRAM_NN_4KB)] = byte;
-            return;
+            wramAddress = (gb->selectedWRAMBank * 0x1000) + (addr - WRAM_NN_4KB);
         }
 
-        /* Otherwise use bank 0 */
-        gb->wram[addr - WRAM_N0_4KB] = byte;
+        gb->wram[wramAddress] = byte;
+        /* Writing over cached code */
+        if (gb->blockCache.codeMap[wramAddress]) blockcache_invalidate(gb, wramAddress);
         return;
     } else if (addr >= RAM_NN_8KB && addr <= RAM_NN_8KB_END) {
         /* External RAM write request */
@@ -1241,7 +1243,12 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
                              uint8_t bankNumber = byte & 0b00000111;
 
                              if (bankNumber == 0) bankNumber = 1;
-                             gb->selectedWRAMBank = bankNumber;
+                             if (gb->selectedWRAMBank != bankNumber) {
+                                 gb->selectedWRAMBank = bankNumber;
+                                 updateMemoryMap(gb, MEMORY_REGION_WRAM_BANK);
+                             }
+                             /* Code running from 0xD000 has to continue in the new bank */
+                             gb->nextInstruction = &blockcache_noInstruction;
                              /* Ignore bits 7-3 */
                              gb->IO[R_SVBK] |= bankNumber;
                              return;
@@ -1254,6 +1261,7 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
                             uint8_t bankNumber = byte & 1;
 
                             gb->selectedVRAMBank = bankNumber;
+                            updateMemoryMap(gb, MEMORY_REGION_VRAM);
                             /* Ignore all bits other than bit 0 */
                             gb->IO[R_VBK] |= bankNumber;
                             return;
@@ -1277,6 +1285,7 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
                              }
 
                              gb->bgColorRAM[gb->currentBackgroundCRAMIndex] = byte;
+                             updatePaletteColor_CGB(gb, false, gb->currentBackgroundCRAMIndex / 2);
                              if (GET_BIT(gb->IO[R_BCPS], 7)) {
                                  gb->currentBackgroundCRAMIndex++;
 
@@ -1314,6 +1323,7 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
                              }
 
                              gb->spriteColorRAM[gb->currentSpriteCRAMIndex] = byte;
+                             updatePaletteColor_CGB(gb, true, gb->currentSpriteCRAMIndex / 2);
                              if (GET_BIT(gb->IO[R_OCPS], 7)) {
                                  gb->currentSpriteCRAMIndex++;
 
@@ -1334,12 +1344,16 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
                              break;
                          }
             case R_BGP: {
+                            gb->IO[R_BGP] = byte;
+                            updatePaletteColors_DMG(gb, DMG_PALETTE_BGP);
                             break;
                         }
             case R_OBP0:
             case R_OBP1:
 						/* NOTE: BGP, OBP0 and OBP1 are still R/W in CGB mode as some games seem to use it*/
                         // if (gb->emuMode != EMU_DMG) return;
+                        gb->IO[addr - IO_REG] = byte;
+                        updatePaletteColors_DMG(gb, addr - IO_REG == R_OBP0 ? DMG_PALETTE_OBP0 : DMG_PALETTE_OBP1);
                         break;
             case R_STAT:
                         /* Bit 7 in STAT is unused so it has to always be 1.
@@ -1402,22 +1416,48 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
         }
 
         gb->IO[addr - IO_REG] = byte;
+
+        if (gb->ppuMode == PPU_MODE_3) {
+            /* Let the PPU know that the scanline being drawn has changed */
+            switch (addr - IO_REG) {
+                case R_LCDC: case R_SCY: case R_SCX: case R_WY: case R_WX:
+                case R_BGP: case R_OBP0: case R_OBP1:
+                    handleMode3Write(gb);
+                    break;
+            }
+        }
         return;
     } else if (addr >= VRAM_N0_8KB && addr <= VRAM_N0_8KB_END) {
+        /* VRAM writes in mode 3 are dropped, but a game racing the end of mode 3 relies on
+         * exact mode 3 timing which only the FIFO renderer has */
+        if (gb->ppuMode == PPU_MODE_3) handleMode3Write(gb);
+
         /* Handle the case when VRAM has been locked by PPU */
         if (gb->lockVRAM) {
             return;
         }
 
-        gb->vram[(gb->selectedVRAMBank * 0x2000) + (addr - VRAM_N0_8KB)] = byte;
+        uint16_t vramAddress = (gb->selectedVRAMBank * 0x2000) + (addr - VRAM_N0_8KB);
+        /* Rewriting the same value (common when games copy whole tilesets) keeps
+         * the decoded tile */
+        if (gb->vram[vramAddress] != byte) {
+            gb->vram[vramAddress] = byte;
+            markTileDirty(gb, vramAddress);
+        }
         return;
     } else if (addr >= ROM_N0_16KB && addr <= ROM_NN_16KB_END) {
         /* Pass over control to an MBC, maybe this is a call for
          * bank switch */
         mbc_interceptROMWrite(gb, addr, byte);
+        blockcache_syncBanks(gb);
+        updateMemoryMap(gb, MEMORY_REGION_ROM);
+        updateMemoryMap(gb, MEMORY_REGION_EXTERNAL_RAM);
         return;
     } else if (addr >= HRAM_N0 && addr <= HRAM_N0_END) {
         gb->hram[addr - HRAM_N0] = byte;
+        if (gb->blockCache.codeMap[BLOCK_CODE_MAP_HRAM + (addr - HRAM_N0)]) {
+            blockcache_invalidate(gb, BLOCK_CODE_MAP_HRAM + (addr - HRAM_N0));
+        }
         return;
     } else if (addr == R_IE) {
         gb->IE = byte;
@@ -1430,6 +1470,7 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
         return;
     } else if (addr >= ECHO_N0_8KB && addr <= ECHO_N0_8KB_END) {
         gb->wram[addr - ECHO_N0_8KB] = byte;
+        if (gb->blockCache.codeMap[addr - ECHO_N0_8KB]) blockcache_invalidate(gb, addr - ECHO_N0_8KB);
         return;
     } else if (addr >= UNUSABLE_N0 && addr <= UNUSABLE_N0_END) {
 #ifdef DEBUG_LOGGING
@@ -1440,18 +1481,13 @@ void writeAddr(GB* gb, uint16_t addr, uint8_t byte) {
 }
 
 uint8_t readAddr(GB* gb, uint16_t addr) {
-    if (addr >= ROM_N0_16KB && addr <= ROM_N0_16KB_END) {
-        if (gb->memControllerType == MBC_NONE) {
-            return gb->cartridge->allocated[addr];
-        }
+    const uint8_t* page = gb->readMap[addr / MEMORY_PAGE_SIZE];
+    if (page != NULL) return page[addr % MEMORY_PAGE_SIZE];
 
-        return mbc_readROM_N0(gb, addr);
+    if (addr >= ROM_N0_16KB && addr <= ROM_N0_16KB_END) {
+        return gb->rom0Bank[addr];
     } else if (addr >= ROM_NN_16KB && addr <= ROM_NN_16KB_END) {
-        if (gb->memControllerType == MBC_NONE) {
-            return gb->cartridge->allocated[addr];
-        }
-
-        return mbc_readROM_NN(gb, addr - ROM_NN_16KB);
+        return gb->romNNBank[addr - ROM_NN_16KB];
     } else if (addr >= WRAM_N0_4KB && addr <= WRAM_NN_4KB_END) {
         if (addr >= WRAM_NN_4KB) {
             /* Respect banking */
@@ -1512,13 +1548,27 @@ uint8_t readAddr(GB* gb, uint16_t addr) {
     return 0xFF;
 }
 
+uint8_t peekAddr(GB* gb, uint16_t addr) {
+    const uint8_t* page = gb->readMap[addr / MEMORY_PAGE_SIZE];
+    if (page != NULL) return page[addr % MEMORY_PAGE_SIZE];
+
+    /* External RAM goes through the MBC which may latch or catch up state, and IO reads sync
+     * the timer, so those are shown as they are without any side effects */
+    if (addr >= RAM_NN_8KB && addr <= RAM_NN_8KB_END) return 0xFF;
+    if (addr >= IO_REG && addr <= IO_REG_END) return gb->IO[addr - IO_REG];
+
+    return readAddr(gb, addr);
+}
+
 
 static void writeAddr_4C(GB* gb, uint16_t addr, uint8_t byte) {
+    syncHardwareForAccess(gb, addr);
     writeAddr(gb, addr, byte);
     cyclesSync_4(gb);
 }
 
 static uint8_t readAddr_4C(GB* gb, uint16_t addr) {
+    syncHardwareForAccess(gb, addr);
     uint8_t byte = readAddr(gb, addr);
     cyclesSync_4(gb);
 
@@ -1540,6 +1590,7 @@ static void dispatchInterrupt(GB* gb, INTERRUPT interrupt) {
 
     /* Set the bit of this interrupt in the IF register to 0 */
     gb->IO[R_IF] &= ~(1 << interrupt);
+    gb->interruptsDispatched++;
 
     /* Now we pass control to the interrupt handler
      *
@@ -1613,6 +1664,7 @@ static void halt(GB* gb) {
         if ((IE & IF & 0x1F) == 0) {
             /* IME Enabled, No enabled interrupts requested */
             gb->haltMode = true;
+            gb->cpuEventPending = true;
             return;
         }
 
@@ -1627,11 +1679,13 @@ static void halt(GB* gb) {
              * We wait till an interrupt is requested, then we dont jump to the
              * interrupt vector and just continue executing instructions */
             gb->haltMode = true;
+            gb->cpuEventPending = true;
         } else {
             /* IME Disabled, 1 or more enabled interrupts requested
              *
              * Halt Bug Occurs */
             gb->scheduleHaltBug = true;
+            gb->cpuEventPending = true;
         }
     }
 }
@@ -1645,6 +1699,8 @@ static void stop(GB* gb) {
 
 	if (gb->emuMode != EMU_CGB) return;
 	gb->doingSpeedSwitch = true;
+	/* Catch up timing stays eager until the speed has switched */
+	syncHardware(gb);
 
 	/* CPU Idles for 2050 M-Cycles, TIMA keeps ticking, DIV doesnt tick,
 	 * Interrupts are not handled as CPU is stopped */
@@ -1657,6 +1713,8 @@ static void stop(GB* gb) {
 	}
 
 	gb->doingSpeedSwitch = false;
+	gb->realCyclesAtSpeedSwitch = getRealTimeCycles(gb);
+	gb->speedSwitchClock = gb->clock;
 	gb->isDoubleSpeedMode = !gb->isDoubleSpeedMode;
 	gb->IO[R_KEY1] &= 0x7E;
 	gb->IO[R_KEY1] |= (int)gb->isDoubleSpeedMode << 7;
@@ -1666,291 +1724,245 @@ static void stop(GB* gb) {
 #endif
 }
 
-/* Main CPU instruction dispatchers */
+/* Main CPU instruction dispatchers
+ *
+ * Both dispatchers are generated from the opcode table in gb/opcodes.h. With GCC and Clang
+ * every instruction is a label and jumps straight to the next instruction through a label
+ * table (computed goto), so every instruction has its own indirect branch which predicts far
+ * better than a single switch. Other compilers call through a function table instead
+ *
+ * Anything which doesnt happen on most instructions (halting, EI, the halt bug, stopping the
+ * emulator) is behind gb->cpuEventPending, which is checked once per instruction */
 
-static void prefixCB(GB* gb) {
-    /* This function contains opcode interpretations for
-     * all the instruction prefixed by opcode CB */
-    uint8_t byte = readByte_4C(gb);
-	
+#if defined(__GNUC__) && !defined(DEBUG_NO_THREADED_DISPATCH)
+#define CPU_THREADED_DISPATCH
+#endif
+
+static inline void recordDispatchedAddress(GB* gb, uint16_t address) {
+    gb->dispatchedAddresses[gb->dispatchedAddressesStart++] = address;
+    if (gb->dispatchedAddressesStart > 10) gb->dispatchedAddressesStart = 0;
+}
+
+/* Idle loops
+ *
+ * Games wait for VBlank, a scanline or an interrupt handler by polling LY, STAT, IF or a
+ * variable in a short loop. Such a loop runs the same way every time until a value it reads
+ * changes, and none of them change before the hardware next has something to do, so the
+ * iterations up to that point are skipped */
+
+static bool isIdleLoopInstruction(const CachedInstruction* instruction) {
+    /* Instructions which dont write memory or any register other than A and F, so the
+     * registers used for addressing dont change inside the loop */
+    uint8_t opcode = instruction->opcode;
+
+    if (opcode == 0xCB) {
+        uint8_t cbOpcode = instruction->operands[0];
+        /* BIT on anything, rotates, shifts, SWAP, RES and SET on A */
+        return (cbOpcode >= 0x40 && cbOpcode <= 0x7F) || (cbOpcode & 7) == 7;
+    }
+    /* LD A, r and ALU instructions */
+    if (opcode >= 0x78 && opcode <= 0xBF) return true;
+
+    switch (opcode) {
+        case 0x00:                                          /* NOP */
+        case 0x07: case 0x0F: case 0x17: case 0x1F:         /* RLCA RRCA RLA RRA */
+        case 0x27: case 0x2F: case 0x37: case 0x3F:         /* DAA CPL SCF CCF */
+        case 0x3C: case 0x3D: case 0x3E:                    /* INC A, DEC A, LD A, d8 */
+        case 0x0A: case 0x1A:                               /* LD A, (BC) and (DE) */
+        case 0xF0: case 0xF2: case 0xFA:                    /* LDH A, (a8) and (C), LD A, (a16) */
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE:         /* ALU with d8 */
+        case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static IDLE_LOOP checkIdleLoop(CachedBlock* block) {
+    /* Conditional branches dont end blocks, the loop is the part of the block up to the
+     * first branch, which has to go back to the start */
+    uint16_t start = block->instructions[0].address;
+    unsigned int cycles = 0;
+
+    for (int i = 0; i < block->count; i++) {
+        const CachedInstruction* instruction = &block->instructions[i];
+        cycles += instruction->cycles;
+        if (isIdleLoopInstruction(instruction)) continue;
+
+        uint16_t target;
+        switch (instruction->opcode) {
+            case 0x20: case 0x28: case 0x30: case 0x38:
+                /* Taken conditional branches cost one more cycle */
+                cycles++;
+                /* Fallthrough */
+            case 0x18:
+                target = instruction->address + 2 + (int8_t)instruction->operands[0];
+                break;
+            case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+                cycles++;
+                /* Fallthrough */
+            case 0xC3:
+                target = instruction->operands[0] | (instruction->operands[1] << 8);
+                break;
+            default:
+                return IDLE_LOOP_NO;
+        }
+        if (target != start) return IDLE_LOOP_NO;
+
+        block->idleLoopLength = i + 1;
+        block->idleLoopCycles = cycles;
+        return IDLE_LOOP_YES;
+    }
+    return IDLE_LOOP_NO;
+}
+
+static bool isIdleAddress(uint16_t address) {
+    /* Memory which only changes when the CPU writes it or when the hardware reaches an
+     * event getIdleCycles knows about (DMA stops it from skipping) */
+    if (address <= ROM_NN_16KB_END) return true;
+    if (address >= VRAM_N0_8KB && address <= VRAM_N0_8KB_END) return true;
+    if (address >= WRAM_N0_4KB && address <= OAM_N0_160B_END) return true;
+    if (address >= HRAM_N0) return true;
+    if (address < IO_REG || address > IO_REG_END) return false;
+
+    switch (address - IO_REG) {
+        case R_P1_JOYP:                                     /* Input is applied every frame */
+        case R_IF:
+        case R_LCDC: case R_STAT: case R_SCY: case R_SCX:
+        case R_LY: case R_LYC: case R_BGP: case R_OBP0: case R_OBP1:
+        case R_WY: case R_WX:
+            return true;
+        default:
+            /* DIV and TIMA count between events */
+            return false;
+    }
+}
+
+static bool readsIdleMemory(GB* gb, const CachedBlock* block) {
+    /* The registers used for addressing are the same on every iteration */
+    for (int i = 0; i < block->idleLoopLength - 1; i++) {
+        const CachedInstruction* instruction = &block->instructions[i];
+        uint8_t opcode = instruction->opcode;
+        int address = -1;
+
+        switch (opcode) {
+            case 0x0A: address = get_reg16(gb, R16_BC); break;
+            case 0x1A: address = get_reg16(gb, R16_DE); break;
+            case 0xF0: address = PORT_ADDR + instruction->operands[0]; break;
+            case 0xF2: address = PORT_ADDR + get_reg8(gb, R8_C); break;
+            case 0xFA: address = instruction->operands[0] | (instruction->operands[1] << 8); break;
+            case 0xCB:
+                if ((instruction->operands[0] & 7) == 6) address = get_reg16(gb, R16_HL);
+                break;
+            default:
+                /* LD A, (HL) and ALU with (HL) */
+                if (opcode >= 0x78 && opcode <= 0xBF && (opcode & 7) == 6) address = get_reg16(gb, R16_HL);
+                break;
+        }
+
+        if (address >= 0 && !isIdleAddress(address)) return false;
+    }
+    return true;
+}
+
+static void skipIdleLoop(GB* gb, CachedBlock* block) {
+    /* Called when the CPU enters an idle loop. If the last iteration started with the same
+     * state and the hardware was idle during all of it, every iteration until the hardware
+     * does something reads the same values and ends with the same state */
+    IdleLoopState* loop = &gb->idleLoop;
+    syncFlags(gb);
+    unsigned int idleCycles = getIdleCycles(gb);
+    unsigned int iterationCycles = block->idleLoopCycles;
+
+    /* Only an iteration which branched back takes exactly this long since the last time the
+     * loop was entered */
+    if (loop->address == gb->PC && gb->clock - loop->clock == iterationCycles * 4 &&
+        iterationCycles <= loop->idleCycles &&
+        loop->IME == gb->IME && memcmp(loop->GPR, gb->GPR, GP_COUNT) == 0 &&
+        readsIdleMemory(gb, block)) {
+
+        unsigned int skipped = idleCycles / iterationCycles * iterationCycles;
+        if (skipped > 0) {
+            skipCycles(gb, skipped);
+            idleCycles -= skipped;
+            loop->skippedCycles += skipped;
+        }
+    }
+
+    loop->address = gb->PC;
+    loop->clock = gb->clock;
+    loop->idleCycles = idleCycles;
+    loop->IME = gb->IME;
+    memcpy(loop->GPR, gb->GPR, GP_COUNT);
+}
+
+static const CachedInstruction* enterBlock(GB* gb) {
+    /* Hot blocks in ROM are run by the JIT for as long as it can, the interpreter continues
+     * wherever it stops. If the JIT ran into a CPU event the interpreter runs one instruction
+     * before handling it, events raised by compiled code only stop the emulator */
+    CachedBlock* block = blockcache_lookupBlock(gb, gb->PC);
+    if (block != NULL && gb->settings.idleLoopSkip && !gb->jit.busy) {
+        if (block->idleLoop == IDLE_LOOP_UNKNOWN) block->idleLoop = checkIdleLoop(block);
+        if (block->idleLoop == IDLE_LOOP_YES) skipIdleLoop(gb, block);
+    }
+    while (block != NULL && gb->settings.jit && !gb->cpuEventPending && jit_run(gb, block)) {
+        block = blockcache_lookupBlock(gb, gb->PC);
+    }
+
+    return block != NULL ? &block->instructions[0] : &blockcache_noInstruction;
+}
+
+static inline uint8_t fetchOpcode(GB* gb) {
 #ifdef DEBUG_PRINT_REGISTERS
     printRegisters(gb);
 #endif
 #ifdef DEBUG_REALTIME_PRINTING
-    printCBInstruction(gb, byte);
+    printInstruction(gb);
 #endif
+    const CachedInstruction* instruction = gb->nextInstruction;
+    if (instruction->address != gb->PC || instruction->length == 0) {
+        /* Jumped, interrupted or at the end of a block */
+        instruction = enterBlock(gb);
+    }
+    recordDispatchedAddress(gb, gb->PC);
 
-    switch (byte) {
-        case 0x00: rotateLeftR8(gb, R8_B, true); break;
-        case 0x01: rotateLeftR8(gb, R8_C, true); break;
-        case 0x02: rotateLeftR8(gb, R8_D, true); break;
-        case 0x03: rotateLeftR8(gb, R8_E, true); break;
-        case 0x04: rotateLeftR8(gb, R8_H, true); break;
-        case 0x05: rotateLeftR8(gb, R8_L, true); break;
-        case 0x06: rotateLeftAR16(gb, R16_HL, true); break;
-        case 0x07: rotateLeftR8(gb, R8_A, true); break;
-        case 0x08: rotateRightR8(gb, R8_B, true); break;
-        case 0x09: rotateRightR8(gb, R8_C, true); break;
-        case 0x0A: rotateRightR8(gb, R8_D, true); break;
-        case 0x0B: rotateRightR8(gb, R8_E, true); break;
-        case 0x0C: rotateRightR8(gb, R8_H, true); break;
-        case 0x0D: rotateRightR8(gb, R8_L, true); break;
-        case 0x0E: rotateRightAR16(gb, R16_HL, true); break;
-        case 0x0F: rotateRightR8(gb, R8_A, true); break;
-        case 0x10: rotateLeftCarryR8(gb, R8_B, true); break;
-        case 0x11: rotateLeftCarryR8(gb, R8_C, true); break;
-        case 0x12: rotateLeftCarryR8(gb, R8_D, true); break;
-        case 0x13: rotateLeftCarryR8(gb, R8_E, true); break;
-        case 0x14: rotateLeftCarryR8(gb, R8_H, true); break;
-        case 0x15: rotateLeftCarryR8(gb, R8_L, true); break;
-        case 0x16: rotateLeftCarryAR16(gb, R16_HL, true); break;
-        case 0x17: rotateLeftCarryR8(gb, R8_A, true); break;
-        case 0x18: rotateRightCarryR8(gb, R8_B, true); break;
-        case 0x19: rotateRightCarryR8(gb, R8_C, true); break;
-        case 0x1A: rotateRightCarryR8(gb, R8_D, true); break;
-        case 0x1B: rotateRightCarryR8(gb, R8_E, true); break;
-        case 0x1C: rotateRightCarryR8(gb, R8_H, true); break;
-        case 0x1D: rotateRightCarryR8(gb, R8_L, true); break;
-        case 0x1E: rotateRightCarryAR16(gb, R16_HL, true); break;
-        case 0x1F: rotateRightCarryR8(gb, R8_A, true); break;
-        case 0x20: shiftLeftArithmeticR8(gb, R8_B); break;
-        case 0x21: shiftLeftArithmeticR8(gb, R8_C); break;
-        case 0x22: shiftLeftArithmeticR8(gb, R8_D); break;
-        case 0x23: shiftLeftArithmeticR8(gb, R8_E); break;
-        case 0x24: shiftLeftArithmeticR8(gb, R8_H); break;
-        case 0x25: shiftLeftArithmeticR8(gb, R8_L); break;
-        case 0x26: shiftLeftArithmeticAR16(gb, R16_HL); break;
-        case 0x27: shiftLeftArithmeticR8(gb, R8_A); break;
-        case 0x28: shiftRightArithmeticR8(gb, R8_B); break;
-        case 0x29: shiftRightArithmeticR8(gb, R8_C); break;
-        case 0x2A: shiftRightArithmeticR8(gb, R8_D); break;
-        case 0x2B: shiftRightArithmeticR8(gb, R8_E); break;
-        case 0x2C: shiftRightArithmeticR8(gb, R8_H); break;
-        case 0x2D: shiftRightArithmeticR8(gb, R8_L); break;
-        case 0x2E: shiftRightArithmeticAR16(gb, R16_HL); break;
-        case 0x2F: shiftRightArithmeticR8(gb, R8_A); break;
-        case 0x30: swapR8(gb, R8_B); break;
-        case 0x31: swapR8(gb, R8_C); break;
-        case 0x32: swapR8(gb, R8_D); break;
-        case 0x33: swapR8(gb, R8_E); break;
-        case 0x34: swapR8(gb, R8_H); break;
-        case 0x35: swapR8(gb, R8_L); break;
-        case 0x36: swapAR16(gb, R16_HL); break;
-        case 0x37: swapR8(gb, R8_A); break;
-        case 0x38: shiftRightLogicalR8(gb, R8_B); break;
-        case 0x39: shiftRightLogicalR8(gb, R8_C); break;
-        case 0x3A: shiftRightLogicalR8(gb, R8_D); break;
-        case 0x3B: shiftRightLogicalR8(gb, R8_E); break;
-        case 0x3C: shiftRightLogicalR8(gb, R8_H); break;
-        case 0x3D: shiftRightLogicalR8(gb, R8_L); break;
-        case 0x3E: shiftRightLogicalAR16(gb, R16_HL); break;
-        case 0x3F: shiftRightLogicalR8(gb, R8_A); break;
-        case 0x40: testBitR8(gb, R8_B, 0); break;
-        case 0x41: testBitR8(gb, R8_C, 0); break;
-        case 0x42: testBitR8(gb, R8_D, 0); break;
-        case 0x43: testBitR8(gb, R8_E, 0); break;
-        case 0x44: testBitR8(gb, R8_H, 0); break;
-        case 0x45: testBitR8(gb, R8_L, 0); break;
-        case 0x46: testBitAR16(gb, R16_HL, 0); break;
-        case 0x47: testBitR8(gb, R8_A, 0); break;
-        case 0x48: testBitR8(gb, R8_B, 1); break;
-        case 0x49: testBitR8(gb, R8_C, 1); break;
-        case 0x4A: testBitR8(gb, R8_D, 1); break;
-        case 0x4B: testBitR8(gb, R8_E, 1); break;
-        case 0x4C: testBitR8(gb, R8_H, 1); break;
-        case 0x4D: testBitR8(gb, R8_L, 1); break;
-        case 0x4E: testBitAR16(gb, R16_HL, 1); break;
-        case 0x4F: testBitR8(gb, R8_A, 1); break;
-        case 0x50: testBitR8(gb, R8_B, 2); break;
-        case 0x51: testBitR8(gb, R8_C, 2); break;
-        case 0x52: testBitR8(gb, R8_D, 2); break;
-        case 0x53: testBitR8(gb, R8_E, 2); break;
-        case 0x54: testBitR8(gb, R8_H, 2); break;
-        case 0x55: testBitR8(gb, R8_L, 2); break;
-        case 0x56: testBitAR16(gb, R16_HL, 2); break;
-        case 0x57: testBitR8(gb, R8_A, 2); break;
-        case 0x58: testBitR8(gb, R8_B, 3); break;
-        case 0x59: testBitR8(gb, R8_C, 3); break;
-        case 0x5A: testBitR8(gb, R8_D, 3); break;
-        case 0x5B: testBitR8(gb, R8_E, 3); break;
-        case 0x5C: testBitR8(gb, R8_H, 3); break;
-        case 0x5D: testBitR8(gb, R8_L, 3); break;
-        case 0x5E: testBitAR16(gb, R16_HL, 3); break;
-        case 0x5F: testBitR8(gb, R8_A, 3); break;
-        case 0x60: testBitR8(gb, R8_B, 4); break;
-        case 0x61: testBitR8(gb, R8_C, 4); break;
-        case 0x62: testBitR8(gb, R8_D, 4); break;
-        case 0x63: testBitR8(gb, R8_E, 4); break;
-        case 0x64: testBitR8(gb, R8_H, 4); break;
-        case 0x65: testBitR8(gb, R8_L, 4); break;
-        case 0x66: testBitAR16(gb, R16_HL, 4); break;
-        case 0x67: testBitR8(gb, R8_A, 4); break;
-        case 0x68: testBitR8(gb, R8_B, 5); break;
-        case 0x69: testBitR8(gb, R8_C, 5); break;
-        case 0x6A: testBitR8(gb, R8_D, 5); break;
-        case 0x6B: testBitR8(gb, R8_E, 5); break;
-        case 0x6C: testBitR8(gb, R8_H, 5); break;
-        case 0x6D: testBitR8(gb, R8_L, 5); break;
-        case 0x6E: testBitAR16(gb, R16_HL, 5); break;
-        case 0x6F: testBitR8(gb, R8_A, 5); break;
-        case 0x70: testBitR8(gb, R8_B, 6); break;
-        case 0x71: testBitR8(gb, R8_C, 6); break;
-        case 0x72: testBitR8(gb, R8_D, 6); break;
-        case 0x73: testBitR8(gb, R8_E, 6); break;
-        case 0x74: testBitR8(gb, R8_H, 6); break;
-        case 0x75: testBitR8(gb, R8_L, 6); break;
-        case 0x76: testBitAR16(gb, R16_HL, 6); break;
-        case 0x77: testBitR8(gb, R8_A, 6); break;
-        case 0x78: testBitR8(gb, R8_B, 7); break;
-        case 0x79: testBitR8(gb, R8_C, 7); break;
-        case 0x7A: testBitR8(gb, R8_D, 7); break;
-        case 0x7B: testBitR8(gb, R8_E, 7); break;
-        case 0x7C: testBitR8(gb, R8_H, 7); break;
-        case 0x7D: testBitR8(gb, R8_L, 7); break;
-        case 0x7E: testBitAR16(gb, R16_HL, 7); break;
-        case 0x7F: testBitR8(gb, R8_A, 7); break;
-        case 0x80: resetBitR8(gb, R8_B, 0); break;
-        case 0x81: resetBitR8(gb, R8_C, 0); break;
-        case 0x82: resetBitR8(gb, R8_D, 0); break;
-        case 0x83: resetBitR8(gb, R8_E, 0); break;
-        case 0x84: resetBitR8(gb, R8_H, 0); break;
-        case 0x85: resetBitR8(gb, R8_L, 0); break;
-        case 0x86: resetBitAR16(gb, R16_HL, 0); break;
-        case 0x87: resetBitR8(gb, R8_A, 0); break;
-        case 0x88: resetBitR8(gb, R8_B, 1); break;
-        case 0x89: resetBitR8(gb, R8_C, 1); break;
-        case 0x8A: resetBitR8(gb, R8_D, 1); break;
-        case 0x8B: resetBitR8(gb, R8_E, 1); break;
-        case 0x8C: resetBitR8(gb, R8_H, 1); break;
-        case 0x8D: resetBitR8(gb, R8_L, 1); break;
-        case 0x8E: resetBitAR16(gb, R16_HL, 1); break;
-        case 0x8F: resetBitR8(gb, R8_A, 1); break;
-        case 0x90: resetBitR8(gb, R8_B, 2); break;
-        case 0x91: resetBitR8(gb, R8_C, 2); break;
-        case 0x92: resetBitR8(gb, R8_D, 2); break;
-        case 0x93: resetBitR8(gb, R8_E, 2); break;
-        case 0x94: resetBitR8(gb, R8_H, 2); break;
-        case 0x95: resetBitR8(gb, R8_L, 2); break;
-        case 0x96: resetBitAR16(gb, R16_HL, 2); break;
-        case 0x97: resetBitR8(gb, R8_A, 2); break;
-        case 0x98: resetBitR8(gb, R8_B, 3); break;
-        case 0x99: resetBitR8(gb, R8_C, 3); break;
-        case 0x9A: resetBitR8(gb, R8_D, 3); break;
-        case 0x9B: resetBitR8(gb, R8_E, 3); break;
-        case 0x9C: resetBitR8(gb, R8_H, 3); break;
-        case 0x9D: resetBitR8(gb, R8_L, 3); break;
-        case 0x9E: resetBitAR16(gb, R16_HL, 3); break;
-        case 0x9F: resetBitR8(gb, R8_A, 3); break;
-        case 0xA0: resetBitR8(gb, R8_B, 4); break;
-        case 0xA1: resetBitR8(gb, R8_C, 4); break;
-        case 0xA2: resetBitR8(gb, R8_D, 4); break;
-        case 0xA3: resetBitR8(gb, R8_E, 4); break;
-        case 0xA4: resetBitR8(gb, R8_H, 4); break;
-        case 0xA5: resetBitR8(gb, R8_L, 4); break;
-        case 0xA6: resetBitAR16(gb, R16_HL, 4); break;
-        case 0xA7: resetBitR8(gb, R8_A, 4); break;
-        case 0xA8: resetBitR8(gb, R8_B, 5); break;
-        case 0xA9: resetBitR8(gb, R8_C, 5); break;
-        case 0xAA: resetBitR8(gb, R8_D, 5); break;
-        case 0xAB: resetBitR8(gb, R8_E, 5); break;
-        case 0xAC: resetBitR8(gb, R8_H, 5); break;
-        case 0xAD: resetBitR8(gb, R8_L, 5); break;
-        case 0xAE: resetBitAR16(gb, R16_HL, 5); break;
-        case 0xAF: resetBitR8(gb, R8_A, 5); break;
-        case 0xB0: resetBitR8(gb, R8_B, 6); break;
-        case 0xB1: resetBitR8(gb, R8_C, 6); break;
-        case 0xB2: resetBitR8(gb, R8_D, 6); break;
-        case 0xB3: resetBitR8(gb, R8_E, 6); break;
-        case 0xB4: resetBitR8(gb, R8_H, 6); break;
-        case 0xB5: resetBitR8(gb, R8_L, 6); break;
-        case 0xB6: resetBitAR16(gb, R16_HL, 6); break;
-        case 0xB7: resetBitR8(gb, R8_A, 6); break;
-        case 0xB8: resetBitR8(gb, R8_B, 7); break;
-        case 0xB9: resetBitR8(gb, R8_C, 7); break;
-        case 0xBA: resetBitR8(gb, R8_D, 7); break;
-        case 0xBB: resetBitR8(gb, R8_E, 7); break;
-        case 0xBC: resetBitR8(gb, R8_H, 7); break;
-        case 0xBD: resetBitR8(gb, R8_L, 7); break;
-        case 0xBE: resetBitAR16(gb, R16_HL, 7); break;
-        case 0xBF: resetBitR8(gb, R8_A, 7); break;
-        case 0xC0: setBitR8(gb, R8_B, 0); break;
-        case 0xC1: setBitR8(gb, R8_C, 0); break;
-        case 0xC2: setBitR8(gb, R8_D, 0); break;
-        case 0xC3: setBitR8(gb, R8_E, 0); break;
-        case 0xC4: setBitR8(gb, R8_H, 0); break;
-        case 0xC5: setBitR8(gb, R8_L, 0); break;
-        case 0xC6: setBitAR16(gb, R16_HL, 0); break;
-        case 0xC7: setBitR8(gb, R8_A, 0); break;
-        case 0xC8: setBitR8(gb, R8_B, 1); break;
-        case 0xC9: setBitR8(gb, R8_C, 1); break;
-        case 0xCA: setBitR8(gb, R8_D, 1); break;
-        case 0xCB: setBitR8(gb, R8_E, 1); break;
-        case 0xCC: setBitR8(gb, R8_H, 1); break;
-        case 0xCD: setBitR8(gb, R8_L, 1); break;
-        case 0xCE: setBitAR16(gb, R16_HL, 1); break;
-        case 0xCF: setBitR8(gb, R8_A, 1); break;
-        case 0xD0: setBitR8(gb, R8_B, 2); break;
-        case 0xD1: setBitR8(gb, R8_C, 2); break;
-        case 0xD2: setBitR8(gb, R8_D, 2); break;
-        case 0xD3: setBitR8(gb, R8_E, 2); break;
-        case 0xD4: setBitR8(gb, R8_H, 2); break;
-        case 0xD5: setBitR8(gb, R8_L, 2); break;
-        case 0xD6: setBitAR16(gb, R16_HL, 2); break;
-        case 0xD7: setBitR8(gb, R8_A, 2); break;
-        case 0xD8: setBitR8(gb, R8_B, 3); break;
-        case 0xD9: setBitR8(gb, R8_C, 3); break;
-        case 0xDA: setBitR8(gb, R8_D, 3); break;
-        case 0xDB: setBitR8(gb, R8_E, 3); break;
-        case 0xDC: setBitR8(gb, R8_H, 3); break;
-        case 0xDD: setBitR8(gb, R8_L, 3); break;
-        case 0xDE: setBitAR16(gb, R16_HL, 3); break;
-        case 0xDF: setBitR8(gb, R8_A, 3); break;
-        case 0xE0: setBitR8(gb, R8_B, 4); break;
-        case 0xE1: setBitR8(gb, R8_C, 4); break;
-        case 0xE2: setBitR8(gb, R8_D, 4); break;
-        case 0xE3: setBitR8(gb, R8_E, 4); break;
-        case 0xE4: setBitR8(gb, R8_H, 4); break;
-        case 0xE5: setBitR8(gb, R8_L, 4); break;
-        case 0xE6: setBitAR16(gb, R16_HL, 4); break;
-        case 0xE7: setBitR8(gb, R8_A, 4); break;
-        case 0xE8: setBitR8(gb, R8_B, 5); break;
-        case 0xE9: setBitR8(gb, R8_C, 5); break;
-        case 0xEA: setBitR8(gb, R8_D, 5); break;
-        case 0xEB: setBitR8(gb, R8_E, 5); break;
-        case 0xEC: setBitR8(gb, R8_H, 5); break;
-        case 0xED: setBitR8(gb, R8_L, 5); break;
-        case 0xEE: setBitAR16(gb, R16_HL, 5); break;
-        case 0xEF: setBitR8(gb, R8_A, 5); break;
-        case 0xF0: setBitR8(gb, R8_B, 6); break;
-        case 0xF1: setBitR8(gb, R8_C, 6); break;
-        case 0xF2: setBitR8(gb, R8_D, 6); break;
-        case 0xF3: setBitR8(gb, R8_E, 6); break;
-        case 0xF4: setBitR8(gb, R8_H, 6); break;
-        case 0xF5: setBitR8(gb, R8_L, 6); break;
-        case 0xF6: setBitAR16(gb, R16_HL, 6); break;
-        case 0xF7: setBitR8(gb, R8_A, 6); break;
-        case 0xF8: setBitR8(gb, R8_B, 7); break;
-        case 0xF9: setBitR8(gb, R8_C, 7); break;
-        case 0xFA: setBitR8(gb, R8_D, 7); break;
-        case 0xFB: setBitR8(gb, R8_E, 7); break;
-        case 0xFC: setBitR8(gb, R8_H, 7); break;
-        case 0xFD: setBitR8(gb, R8_L, 7); break;
-        case 0xFE: setBitAR16(gb, R16_HL, 7); break;
-        case 0xFF: setBitR8(gb, R8_A, 7); break;
+    if (instruction->length == 0) {
+        /* Code which isnt cached, operands are read from memory when used */
+        gb->nextInstruction = instruction;
+        gb->operandCursor = NULL;
+        return readByte_4C(gb);
     }
-}
 
-/* Instruction Set : https://www.pastraiser.com/cpu/gameboy/gameboy_opcodes.html */
+    gb->nextInstruction = instruction + 1;
+    gb->operandCursor = instruction->operands;
+    gb->PC++;
+    cyclesSync_4(gb);
+    return instruction->opcode;
+}
 
-void dispatch(GB* gb) {	
+static inline uint8_t fetchCBOpcode(GB* gb) {
+    uint8_t byte = readByte_4C(gb);
 #ifdef DEBUG_PRINT_REGISTERS
     printRegisters(gb);
 #endif
 #ifdef DEBUG_REALTIME_PRINTING
-    printInstruction(gb);
+    printCBInstruction(gb, byte);
 #endif
+    return byte;
+}
+
+void endInstruction(GB* gb) {
+    /* We sync the timer after every dispatch just before checking for interrupts */
+    syncTimer(gb);
+    /* We handle any interrupts that are requested */
+    handleInterrupts(gb);
+}
 
-    uint8_t byte = 0; /* Will get set later */
+static int handleCPUEvents(GB* gb) {
+    /* Slow path between instructions, returns the next opcode to run or -1 if the emulator
+     * was stopped */
+    gb->cpuEventPending = false;
+    if (!__atomic_load_n(&gb->run, __ATOMIC_RELAXED)) return -1;
 
     /* Enable interrupts if it was scheduled */
     if (gb->scheduleInterruptEnable) {
@@ -1958,341 +1970,147 @@ void dispatch(GB* gb) {
         gb->IME = true;
     }
 
-    if (gb->haltMode) {
-        /* Skip dispatch and directly check for pending interrupts */
-
+    while (gb->haltMode) {
         /* The CPU is in sleep mode while halt mode is true,
          * but the device clock will not be affected and continue
          * ticking
          *
          * Other syncs will also continue taking place */
+#ifndef DEBUG_NO_HALT_SKIP
+        /* Nothing can wake the CPU up before the next hardware event, the cycles up to
+         * it are run in one step */
+        unsigned int idleCycles = getIdleCycles(gb);
+        if (idleCycles > 0) skipCycles(gb, idleCycles);
+#endif
         cyclesSync_4(gb);
         syncTimer(gb);
         handleInterrupts(gb);
-        return;
-    } else if (gb->scheduleHaltBug) {
-        /* Revert the PC increment */
-
-        byte = readByte(gb);
-        gb->PC--;
-		gb->dispatchedAddresses[gb->dispatchedAddressesStart++] = gb->PC;
-		if (gb->dispatchedAddressesStart > 10) gb->dispatchedAddressesStart = 0;
-        cyclesSync_4(gb);
-    } else {
-        /* Normal Read */
-        byte = readByte_4C(gb);
 
-		gb->dispatchedAddresses[gb->dispatchedAddressesStart++] = gb->PC-1;
-		if (gb->dispatchedAddressesStart > 10) gb->dispatchedAddressesStart = 0;
+        if (!__atomic_load_n(&gb->run, __ATOMIC_RELAXED)) return -1;
     }
 
-    /* Do the dispatch */
-    switch (byte) {
-        // nop
-        case 0x00: break;
-        case 0x01: LOAD_RR_D16(gb, R16_BC); break;
-        case 0x02: LOAD_ARR_R(gb, R16_BC, R8_A); break;
-        case 0x03: INC_RR(gb, R16_BC); break;
-        case 0x04: incrementR8(gb, R8_B); break;
-        case 0x05: decrementR8(gb, R8_B); break;
-        case 0x06: LOAD_R_D8(gb, R8_B); break;
-        case 0x07: rotateLeftR8(gb, R8_A, false); break;
-        case 0x08: {
-                       uint16_t a = read2Bytes_8C(gb);
-                       uint16_t sp = get_reg16(gb, R16_SP);
-                       /* Write high byte to high and low byte to low */
-                       writeAddr_4C(gb, a+1, sp >> 8);
-                       writeAddr_4C(gb, a, sp & 0xFF);
-                       break;
-                   }
-        case 0x09: addR16(gb, R16_HL, R16_BC); break;
-        case 0x0A: LOAD_R_ARR(gb, R8_A, R16_BC); break;
-        case 0x0B: DEC_RR(gb, R16_BC); break;
-        case 0x0C: incrementR8(gb, R8_C); break;
-        case 0x0D: decrementR8(gb, R8_C); break;
-        case 0x0E: LOAD_R_D8(gb, R8_C); break;
-        case 0x0F: rotateRightR8(gb, R8_A, false); break;
-        case 0x10: stop(gb); return;
-        case 0x11: LOAD_RR_D16(gb, R16_DE); break;
-        case 0x12: LOAD_ARR_R(gb, R16_DE, R8_A); break;
-        case 0x13: INC_RR(gb, R16_DE); break;
-        case 0x14: incrementR8(gb, R8_D); break;
-        case 0x15: decrementR8(gb, R8_D); break;
-        case 0x16: LOAD_R_D8(gb, R8_D); break;
-        case 0x17: rotateLeftCarryR8(gb, R8_A, false); break;
-        case 0x18: JUMP_RL(gb, readByte_4C(gb)); break;
-        case 0x19: addR16(gb, R16_HL, R16_DE); break;
-        case 0x1A: LOAD_R_ARR(gb, R8_A, R16_DE); break;
-        case 0x1B: DEC_RR(gb, R16_DE); break;
-        case 0x1C: incrementR8(gb, R8_E); break;
-        case 0x1D: decrementR8(gb, R8_E); break;
-        case 0x1E: LOAD_R_D8(gb, R8_E); break;
-        case 0x1F: rotateRightCarryR8(gb, R8_A, false); break;
-        case 0x20: jumpRelativeCondition(gb, CONDITION_NZ(gb)); break;
-        case 0x21: LOAD_RR_D16(gb, R16_HL); break;
-        case 0x22: LOAD_ARR_R(gb, R16_HL, R8_A);
-                   set_reg16(gb, R16_HL, (get_reg16(gb, R16_HL) + 1));
-                   break;
-        case 0x23: INC_RR(gb, R16_HL); break;
-        case 0x24: incrementR8(gb, R8_H); break;
-        case 0x25: decrementR8(gb, R8_H); break;
-        case 0x26: LOAD_R_D8(gb, R8_H); break;
-        case 0x27: decimalAdjust(gb); break;
-        case 0x28: jumpRelativeCondition(gb, CONDITION_Z(gb)); break;
-        case 0x29: addR16(gb, R16_HL, R16_HL); break;
-        case 0x2A: LOAD_R_ARR(gb, R8_A, R16_HL);
-                   set_reg16(gb, R16_HL, (get_reg16(gb, R16_HL) + 1));
-                   break;
-        case 0x2B: DEC_RR(gb, R16_HL); break;
-        case 0x2C: incrementR8(gb, R8_L); break;
-        case 0x2D: decrementR8(gb, R8_L); break;
-        case 0x2E: LOAD_R_D8(gb, R8_L); break;
-        case 0x2F: cpl(gb); break;
-        case 0x30: jumpRelativeCondition(gb, CONDITION_NC(gb)); break;
-        case 0x31: LOAD_RR_D16(gb, R16_SP); break;
-        case 0x32: LOAD_ARR_R(gb, R16_HL, R8_A);
-                   set_reg16(gb, R16_HL, (get_reg16(gb, R16_HL) - 1));
-                   break;
-        case 0x33: INC_RR(gb, R16_SP); break;
-        case 0x34: {
-                       /* Increment what is at the address in HL */
-                       uint16_t address = get_reg16(gb, R16_HL);
-                       uint8_t old = readAddr_4C(gb, address);
-                       uint8_t new = old + 1;
-
-                       TEST_Z_FLAG(gb, new);
-                       TEST_H_FLAG_ADD(gb, old, 1);
-                       set_flag(gb, FLAG_N, 0);
-                       writeAddr_4C(gb, address, new);
-                       break;
-                   }
-        case 0x35: {
-                       /* Decrement what is at the address in HL */
-                       uint16_t address = get_reg16(gb, R16_HL);
-                       uint8_t old = readAddr_4C(gb, address);
-                       uint8_t new = old - 1;
-
-                       TEST_Z_FLAG(gb, new);
-                       TEST_H_FLAG_SUB(gb, old, 1);
-                       set_flag(gb, FLAG_N, 1);
-                       writeAddr_4C(gb, address, new);
-                       break;
-                   }
-        case 0x36: LOAD_ARR_D8(gb, R16_HL); break;
-        case 0x37: {
-                       set_flag(gb, FLAG_C, 1);
-                       set_flag(gb, FLAG_N, 0);
-                       set_flag(gb, FLAG_H, 0);
-                       break;
-                   }
-        case 0x38: jumpRelativeCondition(gb, CONDITION_C(gb)); break;
-        case 0x39: addR16(gb, R16_HL, R16_SP); break;
-        case 0x3A: {
-                       LOAD_R_ARR(gb, R8_A, R16_HL);
-                       set_reg16(gb, R16_HL, (get_reg16(gb, R16_HL) - 1));
-                       break;
-                   }
-        case 0x3B: DEC_RR(gb, R16_SP); break;
-        case 0x3C: incrementR8(gb, R8_A); break;
-        case 0x3D: decrementR8(gb, R8_A); break;
-        case 0x3E: LOAD_R_D8(gb, R8_A); break;
-        case 0x3F: CCF(gb); break;
-        case 0x40: LOAD_R_R(gb, R8_B, R8_B);
-#ifdef DEBUG_LDBB_BREAKPOINT
-                   exit(0);
+    if (gb->scheduleHaltBug) {
+        /* The byte after HALT is read twice, revert the PC increment */
+        gb->scheduleHaltBug = false;
+#ifdef DEBUG_REALTIME_PRINTING
+        printInstruction(gb);
 #endif
-                   break;
-        case 0x41: LOAD_R_R(gb, R8_B, R8_C); break;
-        case 0x42: LOAD_R_R(gb, R8_B, R8_D); break;
-        case 0x43: LOAD_R_R(gb, R8_B, R8_E); break;
-        case 0x44: LOAD_R_R(gb, R8_B, R8_H); break;
-        case 0x45: LOAD_R_R(gb, R8_B, R8_L); break;
-        case 0x46: LOAD_R_ARR(gb, R8_B, R16_HL); break;
-        case 0x47: LOAD_R_R(gb, R8_B, R8_A); break;
-        case 0x48: LOAD_R_R(gb, R8_C, R8_B); break;
-        case 0x49: LOAD_R_R(gb, R8_C, R8_C); break;
-        case 0x4A: LOAD_R_R(gb, R8_C, R8_D); break;
-        case 0x4B: LOAD_R_R(gb, R8_C, R8_E); break;
-        case 0x4C: LOAD_R_R(gb, R8_C, R8_H); break;
-        case 0x4D: LOAD_R_R(gb, R8_C, R8_L); break;
-        case 0x4E: LOAD_R_ARR(gb, R8_C, R16_HL); break;
-        case 0x4F: LOAD_R_R(gb, R8_C, R8_A); break;
-        case 0x50: LOAD_R_R(gb, R8_D, R8_B); break;
-        case 0x51: LOAD_R_R(gb, R8_D, R8_C); break;
-        case 0x52: LOAD_R_R(gb, R8_D, R8_D); break;
-        case 0x53: LOAD_R_R(gb, R8_D, R8_E); break;
-        case 0x54: LOAD_R_R(gb, R8_D, R8_H); break;
-        case 0x55: LOAD_R_R(gb, R8_D, R8_L); break;
-        case 0x56: LOAD_R_ARR(gb, R8_D, R16_HL); break;
-        case 0x57: LOAD_R_R(gb, R8_D, R8_A); break;
-        case 0x58: LOAD_R_R(gb, R8_E, R8_B); break;
-        case 0x59: LOAD_R_R(gb, R8_E, R8_C); break;
-        case 0x5A: LOAD_R_R(gb, R8_E, R8_D); break;
-        case 0x5B: LOAD_R_R(gb, R8_E, R8_E); break;
-        case 0x5C: LOAD_R_R(gb, R8_E, R8_H); break;
-        case 0x5D: LOAD_R_R(gb, R8_E, R8_L); break;
-        case 0x5E: LOAD_R_ARR(gb, R8_E, R16_HL); break;
-        case 0x5F: LOAD_R_R(gb, R8_E, R8_A); break;
-        case 0x60: LOAD_R_R(gb, R8_H, R8_B); break;
-        case 0x61: LOAD_R_R(gb, R8_H, R8_C); break;
-        case 0x62: LOAD_R_R(gb, R8_H, R8_D); break;
-        case 0x63: LOAD_R_R(gb, R8_H, R8_E); break;
-        case 0x64: LOAD_R_R(gb, R8_H, R8_H); break;
-        case 0x65: LOAD_R_R(gb, R8_H, R8_L); break;
-        case 0x66: LOAD_R_ARR(gb, R8_H, R16_HL); break;
-        case 0x67: LOAD_R_R(gb, R8_H, R8_A); break;
-        case 0x68: LOAD_R_R(gb, R8_L, R8_B); break;
-        case 0x69: LOAD_R_R(gb, R8_L, R8_C); break;
-        case 0x6A: LOAD_R_R(gb, R8_L, R8_D); break;
-        case 0x6B: LOAD_R_R(gb, R8_L, R8_E); break;
-        case 0x6C: LOAD_R_R(gb, R8_L, R8_H); break;
-        case 0x6D: LOAD_R_R(gb, R8_L, R8_L); break;
-        case 0x6E: LOAD_R_ARR(gb, R8_L, R16_HL); break;
-        case 0x6F: LOAD_R_R(gb, R8_L, R8_A); break;
-        case 0x70: LOAD_ARR_R(gb, R16_HL, R8_B); break;
-        case 0x71: LOAD_ARR_R(gb, R16_HL, R8_C); break;
-        case 0x72: LOAD_ARR_R(gb, R16_HL, R8_D); break;
-        case 0x73: LOAD_ARR_R(gb, R16_HL, R8_E); break;
-        case 0x74: LOAD_ARR_R(gb, R16_HL, R8_H); break;
-        case 0x75: LOAD_ARR_R(gb, R16_HL, R8_L); break;
-        case 0x76: halt(gb); break;
-        case 0x77: LOAD_ARR_R(gb, R16_HL, R8_A); break;
-        case 0x78: LOAD_R_R(gb, R8_A, R8_B); break;
-        case 0x79: LOAD_R_R(gb, R8_A, R8_C); break;
-        case 0x7A: LOAD_R_R(gb, R8_A, R8_D); break;
-        case 0x7B: LOAD_R_R(gb, R8_A, R8_E); break;
-        case 0x7C: LOAD_R_R(gb, R8_A, R8_H); break;
-        case 0x7D: LOAD_R_R(gb, R8_A, R8_L); break;
-        case 0x7E: LOAD_R_ARR(gb, R8_A, R16_HL); break;
-        case 0x7F: LOAD_R_R(gb, R8_A, R8_A); break;
-        case 0x80: addR8(gb, R8_A, R8_B); break;
-        case 0x81: addR8(gb, R8_A, R8_C); break;
-        case 0x82: addR8(gb, R8_A, R8_D); break;
-        case 0x83: addR8(gb, R8_A, R8_E); break;
-        case 0x84: addR8(gb, R8_A, R8_H); break;
-        case 0x85: addR8(gb, R8_A, R8_L); break;
-        case 0x86: addR8_AR16(gb, R8_A, R16_HL); break;
-        case 0x87: addR8(gb, R8_A, R8_A); break;
-        case 0x88: adcR8(gb, R8_A, R8_B); break;
-        case 0x89: adcR8(gb, R8_A, R8_C); break;
-        case 0x8A: adcR8(gb, R8_A, R8_D); break;
-        case 0x8B: adcR8(gb, R8_A, R8_E); break;
-        case 0x8C: adcR8(gb, R8_A, R8_H); break;
-        case 0x8D: adcR8(gb, R8_A, R8_L); break;
-        case 0x8E: adcR8_AR16(gb, R8_A, R16_HL); break;
-        case 0x8F: adcR8(gb, R8_A, R8_A); break;
-        case 0x90: subR8(gb, R8_A, R8_B); break;
-        case 0x91: subR8(gb, R8_A, R8_C); break;
-        case 0x92: subR8(gb, R8_A, R8_D); break;
-        case 0x93: subR8(gb, R8_A, R8_E); break;
-        case 0x94: subR8(gb, R8_A, R8_H); break;
-        case 0x95: subR8(gb, R8_A, R8_L); break;
-        case 0x96: subR8_AR16(gb, R8_A, R16_HL); break;
-        case 0x97: subR8(gb, R8_A, R8_A); break;
-        case 0x98: sbcR8(gb, R8_A, R8_B); break;
-        case 0x99: sbcR8(gb, R8_A, R8_C); break;
-        case 0x9A: sbcR8(gb, R8_A, R8_D); break;
-        case 0x9B: sbcR8(gb, R8_A, R8_E); break;
-        case 0x9C: sbcR8(gb, R8_A, R8_H); break;
-        case 0x9D: sbcR8(gb, R8_A, R8_L); break;
-        case 0x9E: sbcR8_AR16(gb, R8_A, R16_HL); break;
-        case 0x9F: sbcR8(gb, R8_A, R8_A); break;
-        case 0xA0: andR8(gb, R8_A, R8_B); break;
-        case 0xA1: andR8(gb, R8_A, R8_C); break;
-        case 0xA2: andR8(gb, R8_A, R8_D); break;
-        case 0xA3: andR8(gb, R8_A, R8_E); break;
-        case 0xA4: andR8(gb, R8_A, R8_H); break;
-        case 0xA5: andR8(gb, R8_A, R8_L); break;
-        case 0xA6: andR8_AR16(gb, R8_A, R16_HL); break;
-        case 0xA7: andR8(gb, R8_A, R8_A); break;
-        case 0xA8: xorR8(gb, R8_A, R8_B); break;
-        case 0xA9: xorR8(gb, R8_A, R8_C); break;
-        case 0xAA: xorR8(gb, R8_A, R8_D); break;
-        case 0xAB: xorR8(gb, R8_A, R8_E); break;
-        case 0xAC: xorR8(gb, R8_A, R8_H); break;
-        case 0xAD: xorR8(gb, R8_A, R8_L); break;
-        case 0xAE: xorR8_AR16(gb, R8_A, R16_HL); break;
-        case 0xAF: xorR8(gb, R8_A, R8_A); break;
-        case 0xB0: orR8(gb, R8_A, R8_B); break;
-        case 0xB1: orR8(gb, R8_A, R8_C); break;
-        case 0xB2: orR8(gb, R8_A, R8_D); break;
-        case 0xB3: orR8(gb, R8_A, R8_E); break;
-        case 0xB4: orR8(gb, R8_A, R8_H); break;
-        case 0xB5: orR8(gb, R8_A, R8_L); break;
-        case 0xB6: orR8_AR16(gb, R8_A, R16_HL); break;
-        case 0xB7: orR8(gb, R8_A, R8_A); break;
-        case 0xB8: compareR8(gb, R8_A, R8_B); break;
-        case 0xB9: compareR8(gb, R8_A, R8_C); break;
-        case 0xBA: compareR8(gb, R8_A, R8_D); break;
-        case 0xBB: compareR8(gb, R8_A, R8_E); break;
-        case 0xBC: compareR8(gb, R8_A, R8_H); break;
-        case 0xBD: compareR8(gb, R8_A, R8_L); break;
-        case 0xBE: compareR8_AR16(gb, R8_A, R16_HL); break;
-        case 0xBF: compareR8(gb, R8_A, R8_A); break;
-        case 0xC0: retCondition(gb, CONDITION_NZ(gb)); break;
-        case 0xC1: POP_R16(gb, R16_BC); break;
-        case 0xC2: jumpCondition(gb, CONDITION_NZ(gb)); break;
-        case 0xC3: JUMP(gb, read2Bytes_8C(gb)); break;
-        case 0xC4: callCondition(gb, read2Bytes_8C(gb), CONDITION_NZ(gb)); break;
-        case 0xC5: PUSH_R16(gb, R16_BC); break;
-        case 0xC6: addR8D8(gb, R8_A); break;
-        case 0xC7: RST(gb, 0x00); break;
-        case 0xC8: retCondition(gb, CONDITION_Z(gb)); break;
-        case 0xC9: ret(gb); break;
-        case 0xCA: jumpCondition(gb, CONDITION_Z(gb)); break;
-        case 0xCB: prefixCB(gb); break;
-        case 0xCC: callCondition(gb, read2Bytes_8C(gb), CONDITION_Z(gb)); break;
-        case 0xCD: call(gb, read2Bytes_8C(gb)); break;
-        case 0xCE: adcR8D8(gb, R8_A); break;
-        case 0xCF: RST(gb, 0x08); break;
-        case 0xD0: retCondition(gb, CONDITION_NC(gb)); break;
-        case 0xD1: POP_R16(gb, R16_DE); break;
-        case 0xD2: jumpCondition(gb, CONDITION_NC(gb)); break;
-        case 0xD4: callCondition(gb, read2Bytes_8C(gb), CONDITION_NC(gb)); break;
-        case 0xD5: PUSH_R16(gb, R16_DE); break;
-        case 0xD6: subR8D8(gb, R8_A); break;
-        case 0xD7: RST(gb, 0x10); break;
-        case 0xD8: retCondition(gb, CONDITION_C(gb)); break;
-        case 0xD9: INTERRUPT_MASTER_ENABLE(gb); ret(gb); break;
-        case 0xDA: jumpCondition(gb, CONDITION_C(gb)); break;
-        case 0xDC: callCondition(gb, read2Bytes_8C(gb), CONDITION_C(gb)); break;
-        case 0xDE: sbcR8D8(gb, R8_A); break;
-        case 0xDF: RST(gb, 0x18); break;
-        case 0xE0: LOAD_D8PORT_R(gb, R8_A); break;
-        case 0xE1: POP_R16(gb, R16_HL); break;
-        case 0xE2: LOAD_RPORT_R(gb, R8_A, R8_C); break;
-        case 0xE5: PUSH_R16(gb, R16_HL); break;
-        case 0xE6: andR8D8(gb, R8_A); break;
-        case 0xE7: RST(gb, 0x20); break;
-        case 0xE8: addR16I8(gb, R16_SP); break;
-        case 0xE9: JUMP_RR(gb, R16_HL); break;
-        case 0xEA: LOAD_MEM_R(gb, R8_A); break;
-        case 0xEE: xorR8D8(gb, R8_A); break;
-        case 0xEF: RST(gb, 0x28); break;
-        case 0xF0: LOAD_R_D8PORT(gb, R8_A); break;
-        case 0xF1: {
-                       POP_R16(gb, R16_AF);
-
-                       /* Always clear the lower 4 bits, they need to always
-                        * be 0, we failed a blargg test because of this lol */
-                       set_reg8(gb, R8_F, get_reg8(gb, R8_F) & 0xF0);
-                       break;
-                   }
-        case 0xF2: LOAD_R_RPORT(gb, R8_A, R8_C); break;
-        case 0xF3: INTERRUPT_MASTER_DISABLE(gb); break;
-        case 0xF5: PUSH_R16(gb, R16_AF); break;
-        case 0xF6: orR8D8(gb, R8_A); break;
-        case 0xF7: RST(gb, 0x30); break;
-        case 0xF8: LOAD_RR_RRI8(gb, R16_HL, R16_SP); break;
-        case 0xF9: LOAD_RR_RR(gb, R16_SP, R16_HL); break;
-        case 0xFA: LOAD_R_MEM(gb, R8_A); break;
-        case 0xFB: INTERRUPT_MASTER_ENABLE(gb); break;
-        case 0xFE: compareR8D8(gb, R8_A); break;
-        case 0xFF: RST(gb, 0x38); break;
+        gb->operandCursor = NULL;
+        uint8_t byte = readByte(gb);
+        gb->PC--;
+        recordDispatchedAddress(gb, gb->PC);
+        cyclesSync_4(gb);
+        return byte;
     }
 
-    /* We sync the timer after every dispatch just before checking for interrupts */
-    syncTimer(gb);
-    /* We handle any interrupts that are requested */
-    handleInterrupts(gb);
+    return fetchOpcode(gb);
+}
+
+/* Every instruction as a function, used by compilers without computed goto and to run
+ * single instructions */
+
+/* Handlers return false if the timer and interrupts shouldnt be synced after them */
+typedef bool (*OpcodeHandler)(GB* gb);
+typedef void (*CBOpcodeHandler)(GB* gb);
+
+static const CBOpcodeHandler cbOpcodeHandlers[256];
+#define PREFIX_CB(gb) cbOpcodeHandlers[fetchCBOpcode(gb)](gb)
+
+/* Some bodies like NOP are empty and dont use gb */
+#define OP(opcode, ...) static bool op_##opcode(GB* gb) { (void)gb; __VA_ARGS__; return true; }
+#define OP_NO_SYNC(opcode, ...) static bool op_##opcode(GB* gb) { (void)gb; __VA_ARGS__; return false; }
+#define CB_OP(opcode, ...) static void cb_##opcode(GB* gb) { (void)gb; __VA_ARGS__; }
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+#undef PREFIX_CB
+
+static const OpcodeHandler opcodeHandlers[256] = {
+#define OP(opcode, ...) [opcode] = op_##opcode,
+#define OP_NO_SYNC OP
+#define CB_OP(opcode, ...)
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+};
+
+static const CBOpcodeHandler cbOpcodeHandlers[256] = {
+#define OP(opcode, ...)
+#define OP_NO_SYNC OP
+#define CB_OP(opcode, ...) [opcode] = cb_##opcode,
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+};
+
+bool stepInstruction(GB* gb) {
+    int next = gb->cpuEventPending ? handleCPUEvents(gb) : fetchOpcode(gb);
+    if (next < 0) return false;
+
+    if (opcodeHandlers[next](gb)) endInstruction(gb);
+    return true;
+}
+
+#ifdef CPU_THREADED_DISPATCH
+
+void dispatch(GB* gb) {
+    static const void* const opcodeLabels[256] = {
+#define OP(opcode, ...) [opcode] = &&op_##opcode,
+#define OP_NO_SYNC OP
+#define CB_OP(opcode, ...)
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+    };
+    static const void* const cbOpcodeLabels[256] = {
+#define OP(opcode, ...)
+#define OP_NO_SYNC OP
+#define CB_OP(opcode, ...) [opcode] = &&cb_##opcode,
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+    };
+    int next;
+
+/* Every instruction ends with its own copy of the jump to the next one */
+#define NEXT_NO_SYNC() \
+    if (gb->cpuEventPending) { \
+        if ((next = handleCPUEvents(gb)) < 0) return; \
+        goto *opcodeLabels[next]; \
+    } \
+    goto *opcodeLabels[fetchOpcode(gb)]
+#define NEXT() endInstruction(gb); NEXT_NO_SYNC()
+#define PREFIX_CB(gb) goto *cbOpcodeLabels[fetchCBOpcode(gb)]
+
+    if ((next = handleCPUEvents(gb)) < 0) return;
+    goto *opcodeLabels[next];
+
+#define OP(opcode, ...) op_##opcode: { __VA_ARGS__; } NEXT();
+#define OP_NO_SYNC(opcode, ...) op_##opcode: { __VA_ARGS__; } NEXT_NO_SYNC();
+#define CB_OP(opcode, ...) cb_##opcode: { __VA_ARGS__; } NEXT();
+#include <gb/opcodes.h>
+#undef OP
+#undef OP_NO_SYNC
+#undef CB_OP
+#undef NEXT
+#undef NEXT_NO_SYNC
+#undef PREFIX_CB
+}
+
+#else
+
+void dispatch(GB* gb) {
+    int next = handleCPUEvents(gb);
+
+    while (next >= 0) {
+        if (opcodeHandlers[next](gb)) endInstruction(gb);
+        next = gb->cpuEventPending ? handleCPUEvents(gb) : fetchOpcode(gb);
+    }
 }
+
+#endif
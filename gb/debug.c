@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <gb/debug.h>
 
 void log_fatal(GB* gb, const char* string) {
@@ -17,14 +18,14 @@ void log_warning(GB* gb, const char* string) {
 }
 
 static uint16_t read2Bytes(GB* gb, uint16_t addr) {
-    uint8_t b1 = readAddr(gb, addr + 1);
-    uint8_t b2 = readAddr(gb, addr + 2);
+    uint8_t b1 = peekAddr(gb, addr + 1);
+    uint8_t b2 = peekAddr(gb, addr + 2);
     uint16_t D16 = (b2 << 8) | b1;
     return D16;
 }
 
 static void printFlags(GB* gb) {
-    uint8_t flagState = gb->GPR[R8_F];
+    uint8_t flagState = getFlagRegister(gb);
 
     printf("[Z%d", flagState >> 7);
     printf(" N%d", (flagState >> 6) & 1);
@@ -43,7 +44,7 @@ static int d16(GB* gb, char* fins, uint16_t addr, char* output) {
 }
 
 static int d8(GB* gb, char* fins, uint16_t addr, char* output) {
-    sprintf(output, fins, readAddr(gb, addr + 1));
+    sprintf(output, fins, peekAddr(gb, addr + 1));
 	return 2;
 }
 
@@ -53,7 +54,7 @@ static int a16(GB* gb, char* fins, uint16_t addr, char* output) {
 }
 
 static int r8(GB* gb, char* fins, uint16_t addr, char* output) {
-    sprintf(output, fins, (int8_t)readAddr(gb, addr + 1));
+    sprintf(output, fins, (int8_t)peekAddr(gb, addr + 1));
 	return 2;
 }
 
@@ -322,7 +323,7 @@ int disassembleCBInstruction(GB* gb, uint8_t byte, char* output) {
 }
 
 int disassembleInstruction(GB* gb, uint16_t addr, char* output) {
-	uint8_t byte = readAddr(gb, addr);
+	uint8_t byte = peekAddr(gb, addr);
 
 	switch (byte) {
         case 0x00: return simpleInstruction(gb, "NOP", output);
@@ -621,7 +622,7 @@ void printInstruction(GB* gb) {
 #endif
     printf(" %5s", "");
 #ifdef DEBUG_PRINT_OPCODE
-	printf("0x%02x ", readAddr(gb, gb->PC));
+	printf("0x%02x ", peekAddr(gb, gb->PC));
 #endif
     char disasm[30];
 	disassembleInstruction(gb, gb->PC, (char*)&disasm);
@@ -632,5 +633,46 @@ void printRegisters(GB* gb) {
     printf("[A%02x|B%02x|C%02x|D%02x|E%02x|H%02x|L%02x|SP%04x]\n",
             gb->GPR[R8_A], gb->GPR[R8_B], gb->GPR[R8_C],
             gb->GPR[R8_D], gb->GPR[R8_E], gb->GPR[R8_H],
-            gb->GPR[R8_L], (uint16_t)(gb->GPR[R8_SP_HIGH] << 8) + gb->GPR[R8_SP_LOW]);
+            gb->GPR[R8_L], gb->GPR16[R16_SP]);
+}
+
+static int traceInstruction(GB* gb, uint16_t addr, char* output) {
+    if (peekAddr(gb, addr) == 0xCB) {
+        disassembleCBInstruction(gb, peekAddr(gb, addr + 1), output);
+        return 2;
+    }
+
+    return disassembleInstruction(gb, addr, output);
+}
+
+void updateDebugSnapshot(GB* gb, DebugSnapshot* snapshot) {
+    memcpy(snapshot->GPR, gb->GPR, sizeof(snapshot->GPR));
+    /* Flags may not be computed yet */
+    snapshot->GPR[R8_F] = getFlagRegister(gb);
+    snapshot->PC = gb->PC;
+    snapshot->SP = gb->GPR16[R16_SP];
+
+    /* The 10 instructions dispatched before the current one, oldest first */
+    int index = gb->dispatchedAddressesStart;
+    for (int i = 0; i < DEBUG_TRACE_CURRENT; i++) {
+        snapshot->traceAddresses[i] = gb->dispatchedAddresses[index];
+        traceInstruction(gb, snapshot->traceAddresses[i], snapshot->trace[i]);
+
+        index++;
+        if (index > 10) index = 0;
+    }
+
+    /* The current instruction, and the ones following it in memory */
+    uint16_t addr = gb->dispatchedAddresses[gb->dispatchedAddressesStart > 0 ? gb->dispatchedAddressesStart - 1 : 10];
+    for (int i = DEBUG_TRACE_CURRENT; i < DEBUG_TRACE_LENGTH; i++) {
+        snapshot->traceAddresses[i] = addr;
+        addr += traceInstruction(gb, addr, snapshot->trace[i]);
+    }
+
+    snapshot->jitterMean = gb->pacer.jitterMean;
+    snapshot->jitterDeviation = pacer_getJitterDeviation(&gb->pacer);
+    snapshot->jitterMax = gb->pacer.jitterMax;
+    snapshot->deadlinesMissed = gb->pacer.deadlinesMissed;
+    snapshot->jitBlocksCompiled = gb->jit.blocksCompiled;
+    snapshot->jitLockstepMismatches = gb->jit.lockstepMismatches;
 }
@@ -2,35 +2,84 @@
 #include <gb/display.h>
 #include <gb/debug.h>
 #include <gb/gui.h>
+#include <gb/pixel.h>
 #include <stdbool.h>
 
 #include <SDL2/SDL.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+static void updateFrameskip(GB* gb, int64_t lateness) {
+    /* Decides if the next frame is rendered, while frames finish after their deadline,
+     * rendering of up to maxFrameskip frames in a row is skipped and the PPU only keeps
+     * its timing. The pacer doesnt wait while behind, so skipped frames catch up */
+    if (!gb->settings.frameskip || gb->settings.frameSync != FRAME_SYNC_TIMER) {
+        gb->framesSkipped = 0;
+        gb->skipFrameRender = false;
+        return;
+    }
 
-static void lockToFramerate(GB* gb) {
+    if (lateness > 0 && gb->framesSkipped < gb->settings.maxFrameskip) {
+        gb->skipFrameRender = true;
+        gb->framesSkipped++;
+    } else {
+        gb->skipFrameRender = false;
+        gb->framesSkipped = 0;
+    }
+}
+
+static void waitForPresent(GB* gb) {
+    /* Waits until the presentation thread has presented the last published frame, with
+     * vsync on this blocks for the refresh of the display. Gives up after a few frames
+     * in case the window cant present (minimized) */
+    uint64_t timeout = pacer_now() + 100000000;
+
+    while (__atomic_load_n(&gb->framesPresented, __ATOMIC_ACQUIRE) < gb->framesPublished &&
+            __atomic_load_n(&gb->run, __ATOMIC_ACQUIRE) && pacer_now() < timeout) {
+        pacer_sleep(200000);
+    }
+}
+
+static void lockToFramerate(GB* gb, bool published) {
     /* The emulator keeps its speed accurate by locking to the framerate
      * Whatever has to be done (cpu execution, audio, rendering a frame) in
      * the interval equivalent to 1 frame render on the gameboy is done in 1 frame
      * render on the emulator, the remaining time is waited for on the emulator to
-     * sync with the time on the gameboy */
-    unsigned long ticksElapsed = (clock_u() - gb->ticksAtStartup) - gb->ticksAtLastRender;
-
-    /* Ticks elapsed is the amount of time elapsed since last frame render (in microsec),
-     * which is lesser than the amount of time it would have taken on the real gameboy
-     * because the emulator goes very fast
+     * sync with the time on the gameboy
      *
-     * In special cases where the emulator needs to be able to go slower than the
-     * gb itself (for debugging), we add a special check */
-
-#ifdef DEBUG_SUPPORT_SLOW_EMULATION
-    if (ticksElapsed < (1e6/DEFAULT_FRAMERATE)) {
-#endif
-        usleep((1e6/DEFAULT_FRAMERATE) - ticksElapsed);
-#ifdef DEBUG_SUPPORT_SLOW_EMULATION
+     * Frames have absolute deadlines, so time lost on one frame is made up on the next ones
+     * and nothing drifts. When the emulator is slower than the gameboy (debugging, slow hosts)
+     * the pacer doesnt wait at all until it catches up */
+    updateFrameskip(gb, pacer_getLateness(&gb->pacer));
+
+    switch (gb->settings.frameSync) {
+        case FRAME_SYNC_TIMER:
+            pacer_waitFrame(&gb->pacer);
+            break;
+        case FRAME_SYNC_VSYNC:
+            /* Frames which arent presented fall back to the timer */
+            if (published) {
+                waitForPresent(gb);
+                pacer_reset(&gb->pacer);
+            } else pacer_waitFrame(&gb->pacer);
+            break;
+        case FRAME_SYNC_FREE_RUN:
+            pacer_reset(&gb->pacer);
+            break;
     }
-#endif
-    gb->ticksAtLastRender = clock_u() - gb->ticksAtStartup;
+}
+
+static void publishFrame(GB* gb) {
+    /* Hands the finished back buffer to the presentation thread and takes the buffer it
+     * was holding as the new back buffer, the presentation thread never waits on us or
+     * the other way around */
+    uint8_t previous = __atomic_exchange_n(&gb->readyFrameBuffer,
+            gb->backFrameBuffer | FRAME_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+
+    gb->backFrameBuffer = previous & ~FRAME_BUFFER_FRESH;
+    gb->framebuffer = gb->frameBuffers[gb->backFrameBuffer];
+    gb->framesPublished++;
 }
 
 static void updateSTAT(GB* gb, STAT_UPDATE_TYPE type) {
@@ -87,6 +136,7 @@ static void updateSTAT(GB* gb, STAT_UPDATE_TYPE type) {
 }
 
 static inline void switchModePPU(GB* gb, PPU_MODE mode) {
+    bool lockedVRAM = gb->lockVRAM;
     gb->ppuMode = mode;
     gb->cyclesSinceLastMode = 0;
 
@@ -116,6 +166,8 @@ static inline void switchModePPU(GB* gb, PPU_MODE mode) {
             updateSTAT(gb, STAT_UPDATE_SWITCH_MODE1);
             break;
     }
+
+    if (gb->lockVRAM != lockedVRAM) updateMemoryMap(gb, MEMORY_REGION_VRAM);
 }
 
 static uint8_t* getCurrentFetcherTileData(GB* gb) {
@@ -194,71 +246,51 @@ static inline uint8_t toRGB888(uint8_t rgb555) {
     return (rgb555 << 3) | (rgb555 >> 2);
 }
 
-static void getPixelColor_CGB(GB* gb, FIFO_Pixel pixel, uint8_t* r, uint8_t* g, uint8_t* b,
-        bool isSprite) {
-
+void updatePaletteColor_CGB(GB* gb, bool isSprite, uint8_t colorIndex) {
+    /* Decodes one rgb555 color from color ram into the cached ARGB8888 palette table,
+     * colorIndex is palette * 4 + color ID, so it is the color ram byte index / 2 */
     uint8_t* colorRAM = isSprite ? gb->spriteColorRAM : gb->bgColorRAM;
-    uint8_t* palettePointer = &colorRAM[pixel.colorPalette * 8];
     /* Color is stored as little endian rgb555 */
-    uint8_t colorLow = palettePointer[pixel.colorID * 2];
-    uint8_t colorHigh = palettePointer[(pixel.colorID * 2) + 1];
-    // printf("ci %d cl %02x ch %02x cp %02x x %03d y %03d\n", pixel.colorID, colorLow, colorHigh, pixel.colorPalette, pixel.screenX, pixel.screenY);
-    uint16_t color = (colorHigh << 8) + colorLow;
+    uint16_t color = (colorRAM[(colorIndex * 2) + 1] << 8) + colorRAM[colorIndex * 2];
 
     /* We need to convert these values to rgb888
      * Source for conversion : https://stackoverflow.com/questions/4409763/how-to-convert-from-rgb555-to-rgb888-in-c*/
-                                     // printf("c%04x p%d\n", color, pixel.colorPalette);
+    uint8_t r = toRGB888((color & 0b0000000000011111));
+    uint8_t g = toRGB888((color & 0b0000001111100000) >> 5);
+    uint8_t b = toRGB888((color & 0b0111110000000000) >> 10);
 
-    *r = toRGB888((color & 0b0000000000011111));
-    *g = toRGB888((color & 0b0000001111100000) >> 5);
-    *b = toRGB888((color & 0b0111110000000000) >> 10);
-		
+    gb->cgbPaletteColors[isSprite][colorIndex] = 0xFF000000 | (r << 16) | (g << 8) | b;
 }
 
-static void getPixelColor_DMG(GB* gb, FIFO_Pixel pixel, uint8_t* r, uint8_t* g, uint8_t* b,
-        bool isSprite) {
-
-    int paletteReg = R_BGP;
-    if (isSprite) paletteReg = pixel.colorPalette == 0 ? R_OBP0 : R_OBP1;
+static inline uint32_t getPixelColor_CGB(GB* gb, FIFO_Pixel pixel, bool isSprite) {
+    /* Colors are decoded when color ram is written to, so this is a single lookup */
+    return gb->cgbPaletteColors[isSprite][(pixel.colorPalette * 4) + pixel.colorID];
+}
 
-    uint8_t shadeId = (gb->IO[paletteReg] >> (pixel.colorID * 2)) & 0b00000011;
+void updatePaletteColors_DMG(GB* gb, DMG_PALETTE palette) {
+    /* Rebuilds the 4 ARGB8888 colors of a DMG palette register from the user configured
+     * shades, this is done when BGP/OBP0/OBP1 are written or the shades are changed */
+    const int paletteRegs[3] = {R_BGP, R_OBP0, R_OBP1};
+    const uint32_t shades[4] = {
+        gb->settings.shade0_rgb,            /* White */
+        gb->settings.shade1_rgb,            /* Light Gray */
+        gb->settings.shade2_rgb,            /* Dark Gray */
+        gb->settings.shade3_rgb             /* Black */
+    };
 
-    switch (shadeId) {
-        case 0: {
-                    /* White, 0xb6bed3 */
-					uint32_t shade0 = gb->settings.shade0_rgb;
-					*r = (shade0>>16)&0xFF;
-					*g = (shade0>>8)&0xFF;
-					*b = shade0&0xFF;
+    uint8_t paletteValue = gb->IO[paletteRegs[palette]];
 
-                    break;
-                }
-        case 1: {
-                    /* Light Gray, 0x11a396 */
-					uint32_t shade1 = gb->settings.shade1_rgb;
-					*r = (shade1>>16)&0xFF;
-					*g = (shade1>>8)&0xFF;
-					*b = shade1&0xFF;
-                    break;
-                }
-        case 2: {
-                    /* Dark Gray, 0xcf4151 */
-					uint32_t shade2 = gb->settings.shade2_rgb;
-					*r = (shade2>>16)&0xFF;
-					*g = (shade2>>8)&0xFF;
-					*b = shade2&0xFF;
-                    break;
-                }
-        case 3: {
-                    /* Black, 0x3e1318 */
-                    uint32_t shade3 = gb->settings.shade3_rgb;
-					*r = (shade3>>16)&0xFF;
-					*g = (shade3>>8)&0xFF;
-					*b = shade3&0xFF;
-                    break;
-                }
+    for (int colorID = 0; colorID < 4; colorID++) {
+        uint8_t shadeId = (paletteValue >> (colorID * 2)) & 0b00000011;
+        gb->dmgPaletteColors[palette][colorID] = 0xFF000000 | (shades[shadeId] & 0xFFFFFF);
     }
+}
+
+static inline uint32_t getPixelColor_DMG(GB* gb, FIFO_Pixel pixel, bool isSprite) {
+    /* Sprite pixels store which OBP they use in the color palette */
+    DMG_PALETTE palette = isSprite ? DMG_PALETTE_OBP0 + pixel.colorPalette : DMG_PALETTE_BGP;
 
+    return gb->dmgPaletteColors[palette][pixel.colorID];
 }
 
 static void renderPixel(GB* gb) {
@@ -266,7 +298,7 @@ static void renderPixel(GB* gb) {
     if (gb->BackgroundFIFO.count == 0) return;
 
     FIFO_Pixel pixel = popFIFO(&gb->BackgroundFIFO);
-    uint8_t r, g, b = 0;
+    uint32_t color = 0;
     bool isSprite = false;
 
     if (gb->OAMFIFO.count != 0) {
@@ -312,17 +344,18 @@ static void renderPixel(GB* gb) {
        }
        */
 
-    if (gb->emuMode == EMU_CGB) {
-        getPixelColor_CGB(gb, pixel, &r, &g, &b, isSprite);
-    } else if (gb->emuMode == EMU_DMG) {
-        getPixelColor_DMG(gb, pixel, &r, &g, &b, isSprite);
-    }
+    /* Frames which are skipped only need the pixel to be consumed */
+    if (!gb->skipFrameRender) {
+        if (gb->emuMode == EMU_CGB) {
+            color = getPixelColor_CGB(gb, pixel, isSprite);
+        } else if (gb->emuMode == EMU_DMG) {
+            color = getPixelColor_DMG(gb, pixel, isSprite);
+        }
 
-    SDL_SetRenderDrawColor(gb->sdl_renderer, r, g, b, 255);
-	/* Make sure to offset for menu */
-	/* Set scale before rendering PPU */
-	SDL_RenderSetScale(gb->sdl_renderer, DISPLAY_SCALING, DISPLAY_SCALING);
-    SDL_RenderDrawPoint(gb->sdl_renderer, pixel.screenX, pixel.screenY+MENU_HEIGHT_PX/DISPLAY_SCALING);
+        /* Write the pixel into the framebuffer as ARGB8888, it is uploaded to the screen
+         * once the frame is over */
+        gb->framebuffer[pixel.screenY * WIDTH_PX + pixel.screenX] = color;
+    }
 
     gb->nextRenderPixelX = pixel.screenX + 1;
     // printf("rendered pixel at x%d\n", pixel.screenX);
@@ -370,8 +403,7 @@ static uint8_t* getSprite(GB* gb) {
 }
 
 static void pushPixels(GB* gb) {
-    uint8_t tileDataLow = gb->fetcherTileRowLow;
-    uint8_t tileDataHigh = gb->fetcherTileRowHigh;
+    uint8_t tileColorIDs[8];
     bool switchedToWindowRender = false;
     bool switchedToSpriteRender = false;
     /* Push pixels to FIFO
@@ -383,6 +415,8 @@ static void pushPixels(GB* gb) {
      * and then continue rendering normally. This also means in the end we might not
      * fully render the rightmost tile, we exit the pushing when the last pixel that can
      * be rendered is pushed, i.e screen X = 159*/
+    decodeTileRow(gb->fetcherTileRowLow, gb->fetcherTileRowHigh, GET_BIT(gb->fetcherTileAttributes, 5), tileColorIDs);
+
     for (int i = 1; i <= 8; i++) {
         uint8_t* sprite = getSprite(gb);
         if (sprite != NULL) {
@@ -479,23 +513,21 @@ static void pushPixels(GB* gb) {
 
         // if (pixelsToDiscard > 0 && gb->fetcherX != 0 && !gb->renderingSprites && !gb->renderingWindow) printf("fuck x%d y%d %d\n", gb->nextPushPixelX - 1, gb->fetcherY, gb->pixelsToDiscard);
         FIFO_Pixel pixel;
-        /* Check for horizontal bit flip */
-        uint8_t index = GET_BIT(gb->fetcherTileAttributes, 5) ? i - 1 : 8 - i;
-        uint8_t higherBit = GET_BIT(tileDataHigh, index);
-        uint8_t lowerBit = GET_BIT(tileDataLow, index);
+        /* Horizontal flip is already applied by the decode */
+        uint8_t colorID = tileColorIDs[i - 1];
         uint8_t bgPriority = 0;
 
         /* Set color palette, color ID and other data  */
         if (gb->emuMode == EMU_CGB) {
             pixel.colorPalette = gb->fetcherTileAttributes & 0b00000111;
-            pixel.colorID = (higherBit << 1) | lowerBit;
+            pixel.colorID = colorID;
             bgPriority = GET_BIT(gb->fetcherTileAttributes, 7);
 
         } else if (gb->emuMode == EMU_DMG) {
             pixel.colorPalette = 0;
             /* On DMG, if background/window is disabled through lcdc, bgp color 0 is rendered */
             if (GET_BIT(gb->IO[R_LCDC], 0)) {
-                pixel.colorID = (higherBit << 1) | lowerBit;
+                pixel.colorID = colorID;
             } else {
                 pixel.colorID = 0;
             }
@@ -534,9 +566,8 @@ static void pushSpritePixels(GB* gb) {
     /* When the sprite fetch is complete, this function is called to push the
      * sprite pixels to the sprite fifo as well as push the BG/Window pixels
      * which were remaining at the start of sprite rendering. */
-    uint8_t tileDataLow = gb->fetcherTileRowLow;
-    uint8_t tileDataHigh = gb->fetcherTileRowHigh;
     uint8_t tileAttributes = gb->fetcherTileAttributes;
+    uint8_t tileColorIDs[8];
     int startX = gb->spriteData[1] - 8;
     uint8_t spriteOAMIndex = gb->spriteData[4];
     bool partiallyOverlaps = false;
@@ -566,17 +597,15 @@ static void pushSpritePixels(GB* gb) {
      *
      * In case the sprite starts a bit off screen to the left, we discard the correct amount
      * of pixels */
+    decodeTileRow(gb->fetcherTileRowLow, gb->fetcherTileRowHigh, GET_BIT(tileAttributes, 5), tileColorIDs);
+
     for (int i = startX < 0 ? -startX + 1 : 1; i <= 8; i++) {
-        /* Check for horizontal bit flip */
-        uint8_t pixelIndex = GET_BIT(tileAttributes, 5) ? i - 1 : 8 - i;
         /* Make adjustments to the index in the fifo that is utilized when sprite is
          * off screen to the left
          *
          * Note : startX is a negative value so its subtracted */
         uint8_t fifoIndex = (i - 1) + (startX < 0 ? startX : 0);
-        uint8_t higherBit = GET_BIT(tileDataHigh, pixelIndex);
-        uint8_t lowerBit = GET_BIT(tileDataLow, pixelIndex);
-        uint8_t colorID = (higherBit << 1) | lowerBit;
+        uint8_t colorID = tileColorIDs[i - 1];
         uint8_t bgPriority = GET_BIT(tileAttributes, 7);
         uint8_t colorPalette = 0;
 
@@ -906,6 +935,242 @@ static void advanceMode2(GB* gb) {
     }
 }
 
+/* Tile cache */
+
+void markTileDirty(GB* gb, uint16_t vramAddress) {
+    /* Tile data lives in the first 0x1800 bytes of every VRAM bank, tile maps after it */
+    if ((vramAddress & 0x1FFF) >= 0x1800) return;
+    gb->dirtyTiles[((vramAddress >> 13) * TILES_PER_VRAM_BANK) + ((vramAddress & 0x1FFF) >> 4)] = true;
+}
+
+static inline const uint8_t* getDecodedTile(GB* gb, uint16_t tileDataAddress) {
+    /* Returns the 8x8 color IDs of the tile at tileDataAddress (offset in VRAM including the
+     * bank), the tile is only decoded again if it was written to since the last use */
+    uint16_t tile = ((tileDataAddress >> 13) * TILES_PER_VRAM_BANK) + ((tileDataAddress & 0x1FFF) >> 4);
+    uint8_t* decodedTile = &gb->tileCache[tile * 64];
+
+    if (gb->dirtyTiles[tile]) {
+        uint8_t* tileData = &gb->vram[tileDataAddress & ~0xF];
+        const bool flipped[2] = {false, false};
+
+        for (int row = 0; row < 8; row += 2) {
+            const uint8_t low[2] = {tileData[2 * row], tileData[2 * (row + 1)]};
+            const uint8_t high[2] = {tileData[(2 * row) + 1], tileData[(2 * (row + 1)) + 1]};
+            decodeTileRows_2(low, high, flipped, &decodedTile[row * 8]);
+        }
+
+        gb->dirtyTiles[tile] = false;
+    }
+
+    return decodedTile;
+}
+
+static inline void getDecodedTileRow(GB* gb, uint16_t tileDataAddress, uint8_t row, bool flipped,
+                                     uint8_t* colorIDs) {
+    /* Copies a row of color IDs out of the tile cache, rows past 7 continue into the next tile
+     * (the lower half of 8x16 sprites) */
+    uint64_t decodedRow;
+    memcpy(&decodedRow, getDecodedTile(gb, tileDataAddress + ((row / 8) * 16)) + ((row % 8) * 8), 8);
+
+    /* Reversing the byte order of the row flips it horizontally */
+    if (flipped) decodedRow = __builtin_bswap64(decodedRow);
+    memcpy(colorIDs, &decodedRow, 8);
+}
+
+/* Scanline renderer */
+
+static inline uint16_t getTileDataAddress(GB* gb, uint8_t tileIndex, uint8_t attributes) {
+    /* Same as getCurrentFetcherTileData but for BG/Window tiles of any position, returns the
+     * offset of the tile data in VRAM */
+    uint16_t vramBankOffset = 0;
+    if (gb->emuMode == EMU_CGB && GET_BIT(attributes, 3)) vramBankOffset = 0x2000;
+
+    if (GET_BIT(gb->IO[R_LCDC], 4)) {
+        /* $8000 method */
+        return vramBankOffset + (tileIndex * 16);
+    }
+
+    /* $8800 method */
+    if (tileIndex < 128) return vramBankOffset + 0x1000 + (tileIndex * 16);
+    return vramBankOffset + 0x800 + ((tileIndex - 128) * 16);
+}
+
+static void renderScanlineTiles(GB* gb, uint16_t tileMapBaseAddress, uint8_t tileX, uint8_t y,
+                                int screenX, int endX, uint8_t* colorIDs, uint8_t* attributes) {
+    /* Draws a row of BG/Window tiles starting at screenX (which can be negative for the first
+     * partially visible tile) until endX, y is the pixel row in the 256x256 tile map */
+    while (screenX < endX) {
+        uint16_t tileAddress = tileMapBaseAddress + (tileX & 0x1F) + (y / 8) * 32;
+        uint8_t tileAttributes = gb->emuMode == EMU_CGB ? gb->vram[0x2000 + tileAddress] : 0;
+
+        uint8_t row = y % 8;
+        /* Vertical flip for BG/Window only exists on CGB */
+        if (GET_BIT(tileAttributes, 6)) row = 7 - row;
+
+        uint8_t tileColorIDs[8];
+        getDecodedTileRow(gb, getTileDataAddress(gb, gb->vram[tileAddress], tileAttributes), row,
+                GET_BIT(tileAttributes, 5), tileColorIDs);
+
+        for (int i = 0; i < 8; i++, screenX++) {
+            if (screenX < 0 || screenX >= endX) continue;
+            colorIDs[screenX] = tileColorIDs[i];
+            attributes[screenX] = tileAttributes;
+        }
+
+        tileX++;
+    }
+}
+
+static void renderScanline(GB* gb, uint8_t startX) {
+    /* Draws the whole current scanline from the state at this moment, pixels before startX are
+     * left untouched so a line can be redrawn partially when the CPU writes PPU state mid line
+     *
+     * The mode 3 duration is estimated from the same state since the fetcher is not run */
+    uint8_t lcdc = gb->IO[R_LCDC];
+    uint8_t scx = gb->IO[R_SCX];
+    uint8_t wx = gb->IO[R_WX];
+    uint8_t line = gb->fetcherY;
+
+    /* BG/Window color IDs and attributes (CGB palette, flips and BG priority) */
+    uint8_t bgColorIDs[WIDTH_PX];
+    uint8_t bgAttributes[WIDTH_PX];
+    /* Sprite color IDs, OAM attributes and X of the sprite which owns the pixel */
+    uint8_t spriteColorIDs[WIDTH_PX];
+    uint8_t spriteAttributes[WIDTH_PX];
+    uint8_t spriteOwnerX[WIDTH_PX];
+
+    bool windowVisible = GET_BIT(lcdc, 5) && gb->lyWasWY && wx < 167;
+    int windowStartX = windowVisible ? wx - 7 : WIDTH_PX;
+    if (windowStartX < 0) windowStartX = 0;
+
+    if (startX == 0) {
+        uint8_t visibleSprites = 0;
+        for (int i = 0; i < gb->spritesInScanline && GET_BIT(lcdc, 1); i++) {
+            uint8_t spriteX = gb->oamDataBuffer[(i * 5) + 1];
+            if (spriteX != 0 && spriteX < 168) visibleSprites++;
+        }
+
+        /* 172 dots is the shortest mode 3, the SCX fine scroll, window and every sprite
+         * add to it */
+        gb->scanlineMode3Duration = 172 + (scx % 8) + (windowVisible ? 6 : 0) + (visibleSprites * 6);
+    }
+
+    /* Window line counter is incremented at the end of mode 3 if the window was drawn */
+    if (windowVisible) gb->renderingWindow = true;
+
+    /* Nothing has to be drawn for frames which are skipped */
+    if (gb->skipFrameRender) return;
+
+    if (gb->emuMode == EMU_DMG && !GET_BIT(lcdc, 0)) {
+        /* On DMG, if background/window is disabled through lcdc, bgp color 0 is rendered */
+        memset(bgColorIDs, 0, sizeof(bgColorIDs));
+        memset(bgAttributes, 0, sizeof(bgAttributes));
+    } else {
+        /* Background */
+        uint16_t bgMapBaseAddress = GET_BIT(lcdc, 3) ? 0x1C00 : 0x1800;
+        uint8_t bgY = (uint16_t)(line + gb->IO[R_SCY]) & 0xFF;
+        renderScanlineTiles(gb, bgMapBaseAddress, scx / 8, bgY, -(scx % 8), windowStartX,
+                bgColorIDs, bgAttributes);
+
+        /* Window, when WX < 7 the first 7 - WX pixels of the window are cut off */
+        if (windowVisible) {
+            uint16_t windowMapBaseAddress = GET_BIT(lcdc, 6) ? 0x1C00 : 0x1800;
+            renderScanlineTiles(gb, windowMapBaseAddress, 0, gb->windowYCounter, wx - 7, WIDTH_PX,
+                    bgColorIDs, bgAttributes);
+        }
+    }
+
+    /* Sprites, the OAM buffer filled in mode 2 is already in OAM order */
+    memset(spriteColorIDs, 0, sizeof(spriteColorIDs));
+    memset(spriteAttributes, 0, sizeof(spriteAttributes));
+
+    for (int i = 0; i < gb->spritesInScanline && GET_BIT(lcdc, 1); i++) {
+        uint8_t* sprite = &gb->oamDataBuffer[i * 5];
+        uint8_t spriteX = sprite[1];
+        uint8_t spriteAttr = sprite[3];
+
+        /* Dont render invisible sprites */
+        if (spriteX == 0 || spriteX >= 168) continue;
+
+        uint8_t tileIndex = sprite[2];
+        if (gb->spriteSize == 1) tileIndex &= 0xFE;
+
+        uint8_t row = sprite[0];
+        if (GET_BIT(spriteAttr, 6)) row = (gb->spriteSize == 0 ? 7 : 15) - row;
+
+        uint16_t vramBankOffset = 0;
+        if (gb->emuMode == EMU_CGB && GET_BIT(spriteAttr, 3)) vramBankOffset = 0x2000;
+
+        uint8_t tileColorIDs[8];
+        getDecodedTileRow(gb, vramBankOffset + (tileIndex * 16), row, GET_BIT(spriteAttr, 5), tileColorIDs);
+
+        for (int j = 0; j < 8; j++) {
+            int x = spriteX - 8 + j;
+            if (x < 0 || x >= WIDTH_PX || tileColorIDs[j] == 0) continue;
+
+            if (spriteColorIDs[x] != 0) {
+                /* On CGB the sprite earlier in OAM always wins, on DMG the one with the
+                 * smaller X wins and OAM order only breaks ties */
+                if (gb->emuMode == EMU_CGB || spriteOwnerX[x] <= spriteX) continue;
+            }
+
+            spriteColorIDs[x] = tileColorIDs[j];
+            spriteAttributes[x] = spriteAttr;
+            spriteOwnerX[x] = spriteX;
+        }
+    }
+
+    /* Mix sprites with BG/Window and write the line into the framebuffer */
+    const uint32_t* colors = gb->emuMode == EMU_CGB ? &gb->cgbPaletteColors[0][0] : &gb->dmgPaletteColors[0][0];
+
+    mixPixels(&bgColorIDs[startX], &bgAttributes[startX], &spriteColorIDs[startX], &spriteAttributes[startX],
+            gb->emuMode == EMU_CGB, GET_BIT(lcdc, 0), colors,
+            &gb->framebuffer[line * WIDTH_PX + startX], WIDTH_PX - startX);
+}
+
+void handleMode3Write(GB* gb) {
+    if (!gb->ppuEnabled || gb->ppuMode != PPU_MODE_3) return;
+
+    /* Lines with mid scanline effects are drawn with the FIFO renderer on the next frame,
+     * games usually repeat the same effects every frame */
+    gb->mode3WriteLines[gb->fetcherY] = true;
+
+    if (gb->scanlineRendered) {
+        /* The line was already drawn, redraw the pixels the LCD has not reached yet
+         * with the new state, this is approximate but only lasts for one frame */
+        int x = (int)gb->cyclesSinceLastMode - 12;
+        if (x < 0) x = 0;
+        if (x < WIDTH_PX) renderScanline(gb, x);
+    }
+}
+
+static void endMode3(GB* gb) {
+    if (gb->renderingWindow) {
+        /* If we were rendering the window in this line,
+         * increment the window line counter
+         *
+         * This means if window gets disabled between scanlines,
+         * the window line counter is still preserved */
+        gb->renderingWindow = false;
+        gb->windowYCounter++;
+    }
+
+    gb->currentFetcherTask = 0;
+    gb->fetcherX = 0;
+    gb->nextPushPixelX = 0;
+    gb->renderingSprites = false;
+    gb->spritesInScanline = 0;
+    gb->spriteData = NULL;
+    gb->preservedFetcherTileLow = 0;
+    gb->preservedFetcherTileHigh = 0;
+    gb->preservedFetcherTileAttributes = 0;
+    /* tile pixel row over */
+    gb->nextRenderPixelX = 0;
+    gb->hblankDuration = T_CYCLES_PER_SCANLINE - T_CYCLES_PER_MODE2 - gb->cyclesSinceLastMode;
+
+    switchModePPU(gb, PPU_MODE_0);
+}
+
 static void advancePPU(GB* gb) {
     /* We use a state machine to handle different PPU modes */
     gb->cyclesSinceLastMode++;
@@ -944,6 +1209,20 @@ static void advancePPU(GB* gb) {
 
             break;
         case PPU_MODE_3:
+            if (gb->cyclesSinceLastMode == 1) {
+                /* Pick the renderer for this line */
+                gb->scanlineRendered = gb->settings.renderer == PPU_RENDERER_SCANLINE &&
+                    !gb->fifoFallbackLines[gb->fetcherY];
+
+                if (gb->scanlineRendered) renderScanline(gb, 0);
+            }
+
+            if (gb->scanlineRendered) {
+                /* The line is already drawn, only wait for mode 3 to end */
+                if (gb->cyclesSinceLastMode >= gb->scanlineMode3Duration) endMode3(gb);
+                break;
+            }
+
             if (gb->pauseDotClock > 0) {
                 gb->pauseDotClock--;
                 break;
@@ -984,32 +1263,7 @@ static void advancePPU(GB* gb) {
              * has been pushed, we wait for 6 more dots (because we need to wait for the renderer
              * to finish which is 6 dots behind). At the end of the 6th dot itself, it resets back
              * to its initial state for the next scanline */
-            if (gb->nextRenderPixelX == 160) {
-                if (gb->renderingWindow) {
-                    /* If we were rendering the window in this line,
-                     * increment the window line counter
-                     *
-                     * This means if window gets disabled between scanlines,
-                     * the window line counter is still preserved */
-                    gb->renderingWindow = false;
-                    gb->windowYCounter++;
-                }
-
-                gb->currentFetcherTask = 0;
-                gb->fetcherX = 0;
-                gb->nextPushPixelX = 0;
-                gb->renderingSprites = false;
-                gb->spritesInScanline = 0;
-                gb->spriteData = NULL;
-                gb->preservedFetcherTileLow = 0;
-                gb->preservedFetcherTileHigh = 0;
-                gb->preservedFetcherTileAttributes = 0;
-                /* tile pixel row over */
-                gb->nextRenderPixelX = 0;
-                gb->hblankDuration = T_CYCLES_PER_SCANLINE - T_CYCLES_PER_MODE2 - gb->cyclesSinceLastMode;
-
-                switchModePPU(gb, PPU_MODE_0);
-            }
+            if (gb->nextRenderPixelX == 160) endMode3(gb);
 
             break;
         case PPU_MODE_0: {
@@ -1027,6 +1281,11 @@ static void advancePPU(GB* gb) {
                     gb->lyWasWY = false;
                     gb->windowYCounter = 0;
 
+                    /* Lines written to in mode 3 during this frame fall back to the FIFO
+                     * renderer in the next one */
+                    memcpy(&gb->fifoFallbackLines, &gb->mode3WriteLines, sizeof(gb->fifoFallbackLines));
+                    memset(&gb->mode3WriteLines, 0, sizeof(gb->mode3WriteLines));
+
                     switchModePPU(gb, PPU_MODE_1);
                     requestInterrupt(gb, INTERRUPT_VBLANK);
                 } else switchModePPU(gb, PPU_MODE_2);
@@ -1175,22 +1434,255 @@ void syncDisplay(GB* gb) {
     if (gb->cyclesSinceLastFrame == T_CYCLES_PER_FRAME) {
         /* End of frame */
         gb->cyclesSinceLastFrame = 0;
-        /* Draw frame */
 		if (!gb->ppuEnabled) {
 			/* On CGB and DMG, the screen goes blank or white when the PPU is disabled */
-    		SDL_SetRenderDrawColor(gb->sdl_renderer, 255, 255, 255, 255);
-    		SDL_RenderClear(gb->sdl_renderer);
+			memset(gb->framebuffer, 0xFF, sizeof(gb->frameBuffers[0]));
 		}
 
+        bool published = false;
+        if (gb->skipFrame) {
+            gb->skipFrame = false;
+        } else if (!gb->skipFrameRender) {
+            publishFrame(gb);
+            published = true;
+        }
+
+        syncFrontend(gb);
+        lockToFramerate(gb, published);
+
+        /* Lets the CPU notice if the emulator was stopped */
+        gb->cpuEventPending = true;
+    }
+}
+
+unsigned int getIdleDisplayCycles(GB* gb) {
+    /* Counts the dots until the next one on which advancePPU or the end of the frame does
+     * something, only HBlank, VBlank and a disabled PPU are idle */
+    unsigned int dots = gb->isDoubleSpeedMode ? 2 : 4;
+    if (gb->cyclesSinceLastFrame >= T_CYCLES_PER_FRAME) return 0;
+    unsigned int idleDots = T_CYCLES_PER_FRAME - gb->cyclesSinceLastFrame - 1;
+
+    if (gb->ppuEnabled) {
+        unsigned int current = gb->cyclesSinceLastMode;
+        unsigned int next;
+
+        switch (gb->ppuMode) {
+            case PPU_MODE_0:
+                /* HDMA step, LY increment, end of the scanline */
+                if (gb->doingHDMA && current < 1) next = 1;
+                else if (current < gb->hblankDuration - 6) next = gb->hblankDuration - 6;
+                else next = gb->hblankDuration;
+                break;
+            case PPU_MODE_1: {
+                /* LY increments, LY reset on line 153, its LYC check and the end of vblank */
+                unsigned cycleAtLYReset = T_CYCLES_PER_VBLANK - T_CYCLES_PER_SCANLINE + 4;
+                unsigned cycleAtLYCInterrupt = T_CYCLES_PER_VBLANK - T_CYCLES_PER_SCANLINE + 12;
+
+                next = current - current % T_CYCLES_PER_SCANLINE + T_CYCLES_PER_SCANLINE - 6;
+                if (next <= current) next += T_CYCLES_PER_SCANLINE;
+                if (cycleAtLYReset > current && cycleAtLYReset < next) next = cycleAtLYReset;
+                if (cycleAtLYCInterrupt > current && cycleAtLYCInterrupt < next) next = cycleAtLYCInterrupt;
+                if (T_CYCLES_PER_VBLANK < next) next = T_CYCLES_PER_VBLANK;
+                break;
+            }
+            default:
+                /* Mode 2 and 3 do work on every dot */
+                return 0;
+        }
+
+        if (next <= current) return 0;
+        if (next - current - 1 < idleDots) idleDots = next - current - 1;
+    }
+
+    return idleDots / dots;
+}
+
+unsigned int getQuietDisplayCycles(GB* gb) {
+    /* Mode 2 and 3 only request an interrupt when mode 3 ends and the mode 0 STAT source is
+     * enabled, the length of mode 3 isnt known ahead. Otherwise the next thing is the LY
+     * increment near the end of the line. The other modes are quiet while they are idle */
+    if (!gb->ppuEnabled || gb->ppuMode == PPU_MODE_0 || gb->ppuMode == PPU_MODE_1) {
+        return getIdleDisplayCycles(gb);
+    }
+    if (GET_BIT(gb->IO[R_STAT], 3) || gb->cyclesSinceLastFrame >= T_CYCLES_PER_FRAME) return 0;
+
+    unsigned int dots = gb->isDoubleSpeedMode ? 2 : 4;
+    unsigned int quietDots = T_CYCLES_PER_FRAME - gb->cyclesSinceLastFrame - 1;
+    unsigned int lineDot = gb->cyclesSinceLastMode;
+    if (gb->ppuMode == PPU_MODE_3) lineDot += T_CYCLES_PER_MODE2;
+
+    unsigned int lyIncrementDot = T_CYCLES_PER_SCANLINE - 6;
+    if (lineDot >= lyIncrementDot) return 0;
+    if (lyIncrementDot - lineDot - 1 < quietDots) quietDots = lyIncrementDot - lineDot - 1;
+
+    return quietDots / dots;
+}
+
+void skipDisplay(GB* gb, unsigned int mCycles) {
+    unsigned int dots = mCycles * (gb->isDoubleSpeedMode ? 2 : 4);
+
+    gb->cyclesSinceLastFrame += dots;
+    if (gb->ppuEnabled) gb->cyclesSinceLastMode += dots;
+}
+
+static void getOutputRect(GB* gb, SDL_Rect* output) {
+    /* Largest size with the aspect ratio of the frame which fits below the menu, centered */
+    int windowWidth, windowHeight;
+    SDL_GetWindowSize(gb->sdl_window, &windowWidth, &windowHeight);
+    int areaWidth = windowWidth;
+    int areaHeight = windowHeight - MENU_HEIGHT_PX;
+
+    if (areaWidth > FILTER_MAX_OUTPUT_WIDTH) areaWidth = FILTER_MAX_OUTPUT_WIDTH;
+    if (areaWidth < WIDTH_PX) areaWidth = WIDTH_PX;
+    if (areaHeight < HEIGHT_PX) areaHeight = HEIGHT_PX;
+
+    if (gb->pendingSettings.integerScaling) {
+        int scale = areaWidth / WIDTH_PX < areaHeight / HEIGHT_PX ? areaWidth / WIDTH_PX : areaHeight / HEIGHT_PX;
+        output->w = WIDTH_PX * scale;
+        output->h = HEIGHT_PX * scale;
+    } else if (areaWidth * HEIGHT_PX < areaHeight * WIDTH_PX) {
+        output->w = areaWidth;
+        output->h = (areaWidth * HEIGHT_PX) / WIDTH_PX;
+    } else {
+        output->w = (areaHeight * WIDTH_PX) / HEIGHT_PX;
+        output->h = areaHeight;
+    }
+
+    output->x = (windowWidth - output->w) / 2;
+    output->y = MENU_HEIGHT_PX + ((windowHeight - MENU_HEIGHT_PX - output->h) / 2);
+}
+
+static void filterFrame(GB* gb) {
+    /* Applies the filters which work on the frame itself */
+    const uint32_t* frame = gb->frameBuffers[gb->frontFrameBuffer];
+
+    if (gb->pendingSettings.colorCorrection && gb->emuMode == EMU_CGB) {
+        correctColors(frame, gb->correctedFrame, WIDTH_PX * HEIGHT_PX);
+        frame = gb->correctedFrame;
+    }
+
+    if (gb->pendingSettings.lcdGhosting) {
+        /* The first frame has nothing to blend with */
+        if (gb->ghostingPrimed) {
+            blendFrames(frame, gb->ghostingFrame, WIDTH_PX * HEIGHT_PX);
+        } else {
+            memcpy(gb->ghostingFrame, frame, sizeof(gb->ghostingFrame));
+            gb->ghostingPrimed = true;
+        }
+        frame = gb->ghostingFrame;
+    } else {
+        gb->ghostingPrimed = false;
+    }
+
+    gb->filteredFrame = frame;
+}
+
+static void scaleFrame(GB* gb, uint32_t* out, int pitch) {
+    /* Scales the filtered frame to the output size, scale2x/scale3x write into their own
+     * buffer first unless the output is exactly their size */
+    int width = gb->outputWidth;
+    int height = gb->outputHeight;
+    int factor = gb->pendingSettings.scaleFilter == SCALE_FILTER_SCALE2X ? 2 : 3;
+
+    switch (gb->pendingSettings.scaleFilter) {
+        case SCALE_FILTER_NEAREST:
+            scaleNearest(gb->filteredFrame, WIDTH_PX, HEIGHT_PX, out, width, height, pitch);
+            break;
+        case SCALE_FILTER_BILINEAR:
+            scaleBilinear(gb->filteredFrame, WIDTH_PX, HEIGHT_PX, out, width, height, pitch);
+            break;
+        case SCALE_FILTER_SCALE2X:
+        case SCALE_FILTER_SCALE3X: {
+            bool direct = width == WIDTH_PX * factor && height == HEIGHT_PX * factor;
+            uint32_t* scaled = direct ? out : gb->scaledFrame;
+            int scaledPitch = direct ? pitch : WIDTH_PX * factor;
+
+            if (factor == 2) scale2x(gb->filteredFrame, WIDTH_PX, HEIGHT_PX, scaled, scaledPitch);
+            else scale3x(gb->filteredFrame, WIDTH_PX, HEIGHT_PX, scaled, scaledPitch);
+
+            if (!direct) {
+                scaleNearest(scaled, WIDTH_PX * factor, HEIGHT_PX * factor, out, width, height, pitch);
+            }
+            break;
+        }
+    }
+}
+
+static void presentFrame(GB* gb, bool newFrame) {
+    /* Post process the frame into the texture, then copy it below the menu and draw the GUI
+     * on top. While paused, the texture is only rendered again when the output changes */
+    SDL_Rect output;
+    getOutputRect(gb, &output);
+
+    if (output.w != gb->outputWidth || output.h != gb->outputHeight) {
+        /* If the new texture cant be created the old one is kept and stretched to the output */
+        SDL_Texture* texture = SDL_CreateTexture(gb->sdl_renderer, SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_STREAMING, output.w, output.h);
+        if (texture != NULL) {
+            SDL_DestroyTexture(gb->sdl_texture);
+            gb->sdl_texture = texture;
+            gb->outputWidth = output.w;
+            gb->outputHeight = output.h;
+            gb->outputStale = true;
+        }
+    }
+
+    if (newFrame || gb->outputStale) {
+        uint64_t start = pacer_now();
+        void* pixels;
+        int pitch;
+
+        filterFrame(gb);
+        if (SDL_LockTexture(gb->sdl_texture, NULL, &pixels, &pitch) == 0) {
+            scaleFrame(gb, (uint32_t*)pixels, pitch / sizeof(uint32_t));
+            SDL_UnlockTexture(gb->sdl_texture);
+        }
+
+        gb->outputStale = false;
+        gb->postProcessTime = pacer_now() - start;
+    }
+
+    SDL_RenderSetScale(gb->sdl_renderer, 1, 1);
+    SDL_SetRenderDrawColor(gb->sdl_renderer, 0, 0, 0, 255);
+    SDL_RenderClear(gb->sdl_renderer);
+    SDL_RenderCopy(gb->sdl_renderer, gb->sdl_texture, NULL, &output);
+
+    renderFrameIMGUI(gb);
+    SDL_RenderPresent(gb->sdl_renderer);
+}
+
+void runPresentation(GB* gb) {
+    while (__atomic_load_n(&gb->run, __ATOMIC_ACQUIRE)) {
         handleSDLEvents(gb);
-		/* Render MENU and other GUI on top of PPU */
-		renderFrameIMGUI(gb);
-
-        if (!gb->skipFrame) {	
-            SDL_RenderPresent(gb->sdl_renderer);
-        } else gb->skipFrame = false; 
-#ifndef DEBUG_UNLOCK_FRAMERATE
-        lockToFramerate(gb);
-#endif
+
+        /* Take the newest frame if the core thread has finished one since the last present,
+         * frames finished in between are dropped */
+        bool newFrame = __atomic_load_n(&gb->readyFrameBuffer, __ATOMIC_ACQUIRE) & FRAME_BUFFER_FRESH;
+
+        /* Only the vsync target waits for the display refresh */
+        bool vsync = gb->pendingSettings.frameSync == FRAME_SYNC_VSYNC;
+        if (vsync != gb->vsyncEnabled) {
+            SDL_RenderSetVSync(gb->sdl_renderer, vsync);
+            gb->vsyncEnabled = vsync;
+        }
+
+        uint64_t framesPublished = 0;
+        if (newFrame) {
+            uint8_t ready = __atomic_exchange_n(&gb->readyFrameBuffer, gb->frontFrameBuffer, __ATOMIC_ACQ_REL);
+            gb->frontFrameBuffer = ready & ~FRAME_BUFFER_FRESH;
+            /* Can already count a newer frame than the one taken, which only means the
+             * core thread stops waiting a frame early */
+            framesPublished = __atomic_load_n(&gb->framesPublished, __ATOMIC_ACQUIRE);
+        } else if (!__atomic_load_n(&gb->paused, __ATOMIC_ACQUIRE)) {
+            /* Nothing new to show yet */
+            SDL_Delay(1);
+            continue;
+        }
+
+        presentFrame(gb, newFrame);
+        if (newFrame) __atomic_store_n(&gb->framesPresented, framesPublished, __ATOMIC_RELEASE);
+
+        /* While paused no frames arrive, keep the GUI responsive at around 60 fps */
+        if (!newFrame) SDL_Delay(16);
     }
 }
@@ -0,0 +1,439 @@
+#include <gb/filter.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Every filter has a vector loop for the bulk of a row when SSE2 is available and a plain C
+ * loop which handles the rest, or everything when it isnt */
+#if defined(__SSE2__) || defined(__AVX2__)
+#define FILTER_SIMD
+
+static inline __m128i selectPixels(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline void storeInterleaved_3(uint32_t* out, __m128i a, __m128i b, __m128i c) {
+    /* Stores a0 b0 c0 a1 b1 c1 a2 b2 c2 a3 b3 c3 */
+    __m128i aShifted = _mm_srli_si128(a, 4);
+    __m128i abLow = _mm_unpacklo_epi32(a, b);
+    __m128i abHigh = _mm_unpackhi_epi32(a, b);
+    __m128i bcLow = _mm_unpacklo_epi32(b, c);
+    __m128i bcHigh = _mm_unpackhi_epi32(b, c);
+    __m128i caLow = _mm_unpacklo_epi32(c, aShifted);
+    __m128i caHigh = _mm_unpackhi_epi32(c, aShifted);
+
+    _mm_storeu_ps((float*)out, _mm_shuffle_ps(_mm_castsi128_ps(abLow), _mm_castsi128_ps(caLow), _MM_SHUFFLE(1, 0, 1, 0)));
+    _mm_storeu_ps((float*)(out + 4), _mm_shuffle_ps(_mm_castsi128_ps(bcLow), _mm_castsi128_ps(abHigh), _MM_SHUFFLE(1, 0, 3, 2)));
+    _mm_storeu_ps((float*)(out + 8), _mm_shuffle_ps(_mm_castsi128_ps(caHigh), _mm_castsi128_ps(bcHigh), _MM_SHUFFLE(3, 2, 1, 0)));
+}
+#endif
+
+/* Color correction */
+
+static inline uint32_t correctColor(uint32_t color) {
+    /* Mixes some of the other channels into each channel and darkens green a bit */
+    uint32_t r = (color >> 16) & 0xFF;
+    uint32_t g = (color >> 8) & 0xFF;
+    uint32_t b = color & 0xFF;
+
+    uint32_t correctedR = ((r * 26) + (g * 4) + (b * 2)) >> 5;
+    uint32_t correctedG = ((g * 24) + (b * 8)) >> 5;
+    uint32_t correctedB = ((r * 6) + (g * 4) + (b * 22)) >> 5;
+
+    return 0xFF000000 | (correctedR << 16) | (correctedG << 8) | correctedB;
+}
+
+void correctColors(const uint32_t* in, uint32_t* out, int count) {
+    int i = 0;
+#ifdef FILTER_SIMD
+    /* Every channel goes into its own vector of 32 bit lanes, products stay below 16 bits so
+     * the 16 bit multiply is enough */
+    __m128i channelMask = _mm_set1_epi32(0xFF);
+    __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i colors = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(colors, 16), channelMask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(colors, 8), channelMask);
+        __m128i b = _mm_and_si128(colors, channelMask);
+
+        __m128i correctedR = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(26)),
+                    _mm_mullo_epi16(g, _mm_set1_epi32(4))), _mm_mullo_epi16(b, _mm_set1_epi32(2)));
+        __m128i correctedG = _mm_add_epi32(_mm_mullo_epi16(g, _mm_set1_epi32(24)),
+                    _mm_mullo_epi16(b, _mm_set1_epi32(8)));
+        __m128i correctedB = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(6)),
+                    _mm_mullo_epi16(g, _mm_set1_epi32(4))), _mm_mullo_epi16(b, _mm_set1_epi32(22)));
+
+        /* >> 5 and move into place, the results are at most 0xFF so nothing spills over */
+        __m128i result = _mm_or_si128(alpha, _mm_slli_epi32(_mm_srli_epi32(correctedR, 5), 16));
+        result = _mm_or_si128(result, _mm_slli_epi32(_mm_srli_epi32(correctedG, 5), 8));
+        result = _mm_or_si128(result, _mm_srli_epi32(correctedB, 5));
+        _mm_storeu_si128((__m128i*)(out + i), result);
+    }
+#endif
+    for (; i < count; i++) out[i] = correctColor(in[i]);
+}
+
+/* LCD ghosting */
+
+void blendFrames(const uint32_t* frame, uint32_t* history, int count) {
+    int i = 0;
+#ifdef FILTER_SIMD
+    for (; i + 4 <= count; i += 4) {
+        __m128i current = _mm_loadu_si128((const __m128i*)(frame + i));
+        __m128i previous = _mm_loadu_si128((const __m128i*)(history + i));
+        _mm_storeu_si128((__m128i*)(history + i), _mm_avg_epu8(current, previous));
+    }
+#endif
+    for (; i < count; i++) {
+        /* Rounded average of every channel, same as pavgb */
+        uint32_t a = frame[i];
+        uint32_t b = history[i];
+        history[i] = (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7F);
+    }
+}
+
+/* Nearest neighbour */
+
+static void scaleRowNearest(const uint32_t* in, int inWidth, uint32_t* out, int outWidth) {
+    int x = 0;
+
+    if (outWidth % inWidth == 0) {
+        /* Integer factors repeat every pixel, which needs no source positions */
+        int factor = outWidth / inWidth;
+        int i = 0;
+
+        if (factor == 1) {
+            memcpy(out, in, outWidth * sizeof(uint32_t));
+            return;
+        }
+#ifdef FILTER_SIMD
+        if (factor == 2) {
+            for (; i + 4 <= inWidth; i += 4) {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(in + i));
+                _mm_storeu_si128((__m128i*)(out + (i * 2)), _mm_unpacklo_epi32(pixels, pixels));
+                _mm_storeu_si128((__m128i*)(out + (i * 2) + 4), _mm_unpackhi_epi32(pixels, pixels));
+            }
+        } else if (factor == 3) {
+            for (; i + 4 <= inWidth; i += 4) {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(in + i));
+                storeInterleaved_3(out + (i * 3), pixels, pixels, pixels);
+            }
+        } else {
+            for (; i < inWidth; i++) {
+                __m128i pixel = _mm_set1_epi32(in[i]);
+                uint32_t* span = out + (i * factor);
+                int j = 0;
+                for (; j + 4 <= factor; j += 4) _mm_storeu_si128((__m128i*)(span + j), pixel);
+                for (; j < factor; j++) span[j] = in[i];
+            }
+        }
+#endif
+        for (; i < inWidth; i++) {
+            for (int j = 0; j < factor; j++) out[(i * factor) + j] = in[i];
+        }
+        return;
+    }
+
+    /* Other sizes step through the source in 16.16 fixed point */
+    uint32_t step = ((uint32_t)inWidth << 16) / outWidth;
+#ifdef __AVX2__
+    __m256i positions = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step));
+    __m256i positionStep = _mm256_set1_epi32(step * 8);
+
+    for (; x + 8 <= outWidth; x += 8) {
+        __m256i pixels = _mm256_i32gather_epi32((const int*)in, _mm256_srli_epi32(positions, 16), 4);
+        _mm256_storeu_si256((__m256i*)(out + x), pixels);
+        positions = _mm256_add_epi32(positions, positionStep);
+    }
+#endif
+    for (; x < outWidth; x++) out[x] = in[(x * step) >> 16];
+}
+
+void scaleNearest(const uint32_t* in, int inWidth, int inHeight,
+                  uint32_t* out, int outWidth, int outHeight, int outPitch) {
+    /* Output rows from the same source row are copies of the first one */
+    int lastSourceY = -1;
+    uint32_t* lastRow = NULL;
+
+    for (int y = 0; y < outHeight; y++) {
+        int sourceY = (y * inHeight) / outHeight;
+        uint32_t* row = out + (y * outPitch);
+
+        if (sourceY == lastSourceY) {
+            memcpy(row, lastRow, outWidth * sizeof(uint32_t));
+            continue;
+        }
+
+        scaleRowNearest(in + (sourceY * inWidth), inWidth, row, outWidth);
+        lastSourceY = sourceY;
+        lastRow = row;
+    }
+}
+
+/* Bilinear */
+
+static inline uint32_t lerpColor(uint32_t a, uint32_t b, uint32_t weight) {
+    /* weight is 0-255 towards b */
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t channel = ((((a >> shift) & 0xFF) * (256 - weight)) + (((b >> shift) & 0xFF) * weight)) >> 8;
+        result |= channel << shift;
+    }
+    return result;
+}
+
+static inline int getSourcePosition(int outPosition, int step) {
+    /* Pixel centers line up, (x + 0.5) * in / out - 0.5 in 16.16 fixed point */
+    int position = (outPosition * step) + (step / 2) - 0x8000;
+    return position < 0 ? 0 : position;
+}
+
+static void lerpRows(const uint32_t* a, const uint32_t* b, uint32_t weight, uint32_t* out, int width) {
+    int i = 0;
+#ifdef FILTER_SIMD
+    /* Channels are widened to 16 bits, a * (256 - weight) + b * weight fits in them */
+    __m128i zero = _mm_setzero_si128();
+    __m128i weightA = _mm_set1_epi16(256 - weight);
+    __m128i weightB = _mm_set1_epi16(weight);
+
+    for (; i + 4 <= width; i += 4) {
+        __m128i pixelsA = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i pixelsB = _mm_loadu_si128((const __m128i*)(b + i));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixelsA, zero), weightA),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(pixelsB, zero), weightB));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixelsA, zero), weightA),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(pixelsB, zero), weightB));
+
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+    }
+#endif
+    for (; i < width; i++) out[i] = lerpColor(a[i], b[i], weight);
+}
+
+#ifdef FILTER_SIMD
+static inline __m128i lerpPair(const uint32_t* pair, uint32_t weight) {
+    /* Blends 2 neighbouring pixels, the result is in the low 4 lanes */
+    __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pair), _mm_setzero_si128());
+    __m128i weights = _mm_set_epi16(weight, weight, weight, weight,
+                                    256 - weight, 256 - weight, 256 - weight, 256 - weight);
+    __m128i products = _mm_mullo_epi16(pixels, weights);
+    return _mm_add_epi16(products, _mm_srli_si128(products, 8));
+}
+#endif
+
+static void scaleRowBilinear(const uint32_t* in, int inWidth, const int* positions,
+                             uint32_t* out, int outWidth) {
+    /* The row gets its last pixel repeated once so the right neighbour always exists */
+    uint32_t row[FILTER_MAX_INPUT_WIDTH + 1];
+    memcpy(row, in, inWidth * sizeof(uint32_t));
+    row[inWidth] = row[inWidth - 1];
+
+    int x = 0;
+#ifdef FILTER_SIMD
+    for (; x + 2 <= outWidth; x += 2) {
+        __m128i pixels = _mm_unpacklo_epi64(lerpPair(row + (positions[x] >> 16), (positions[x] >> 8) & 0xFF),
+                                            lerpPair(row + (positions[x + 1] >> 16), (positions[x + 1] >> 8) & 0xFF));
+        pixels = _mm_srli_epi16(pixels, 8);
+        _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(pixels, pixels));
+    }
+#endif
+    for (; x < outWidth; x++) {
+        out[x] = lerpColor(row[positions[x] >> 16], row[(positions[x] >> 16) + 1], (positions[x] >> 8) & 0xFF);
+    }
+}
+
+void scaleBilinear(const uint32_t* in, int inWidth, int inHeight,
+                   uint32_t* out, int outWidth, int outHeight, int outPitch) {
+    /* Source rows are scaled horizontally once each, every output row then blends the
+     * 2 scaled rows around it, which is the cheap part when upscaling */
+    int positionsX[FILTER_MAX_OUTPUT_WIDTH];
+    uint32_t scaledRows[2][FILTER_MAX_OUTPUT_WIDTH];
+    int scaledRowY[2] = {-1, -1};
+    int stepX = (inWidth << 16) / outWidth;
+    int stepY = (inHeight << 16) / outHeight;
+
+    if (inWidth > FILTER_MAX_INPUT_WIDTH || outWidth > FILTER_MAX_OUTPUT_WIDTH) return;
+
+    for (int x = 0; x < outWidth; x++) positionsX[x] = getSourcePosition(x, stepX);
+
+    for (int y = 0; y < outHeight; y++) {
+        int positionY = getSourcePosition(y, stepY);
+        int y0 = positionY >> 16;
+        int y1 = y0 + 1 < inHeight ? y0 + 1 : inHeight - 1;
+
+        /* Moving down a row, the lower row becomes the upper one */
+        if (scaledRowY[0] != y0 && scaledRowY[1] == y0) {
+            memcpy(scaledRows[0], scaledRows[1], outWidth * sizeof(uint32_t));
+            scaledRowY[0] = y0;
+        }
+        if (scaledRowY[0] != y0) {
+            scaleRowBilinear(in + (y0 * inWidth), inWidth, positionsX, scaledRows[0], outWidth);
+            scaledRowY[0] = y0;
+        }
+        if (scaledRowY[1] != y1) {
+            scaleRowBilinear(in + (y1 * inWidth), inWidth, positionsX, scaledRows[1], outWidth);
+            scaledRowY[1] = y1;
+        }
+
+        lerpRows(scaledRows[0], scaledRows[1], (positionY >> 8) & 0xFF, out + (y * outPitch), outWidth);
+    }
+}
+
+/* Scale2x and Scale3x (AdvanceMAME), with the neighbourhood
+ *
+ * A B C
+ * D E F
+ * G H I
+ *
+ * Rows are padded with their edge pixels so D/F and the corners exist at the edges */
+
+static void padRow(const uint32_t* row, int width, uint32_t* padded) {
+    padded[0] = row[0];
+    memcpy(padded + 1, row, width * sizeof(uint32_t));
+    padded[width + 1] = row[width - 1];
+}
+
+static void scale2xRow(const uint32_t* above, const uint32_t* current, const uint32_t* below,
+                       int width, uint32_t* out0, uint32_t* out1) {
+    /* Rows are padded, pixel x of the row is at x + 1 */
+    int x = 0;
+#ifdef FILTER_SIMD
+    for (; x + 4 <= width; x += 4) {
+        __m128i B = _mm_loadu_si128((const __m128i*)(above + x + 1));
+        __m128i D = _mm_loadu_si128((const __m128i*)(current + x));
+        __m128i E = _mm_loadu_si128((const __m128i*)(current + x + 1));
+        __m128i F = _mm_loadu_si128((const __m128i*)(current + x + 2));
+        __m128i H = _mm_loadu_si128((const __m128i*)(below + x + 1));
+
+        __m128i DB = _mm_cmpeq_epi32(D, B);
+        __m128i BF = _mm_cmpeq_epi32(B, F);
+        __m128i DH = _mm_cmpeq_epi32(D, H);
+        __m128i HF = _mm_cmpeq_epi32(H, F);
+
+        /* _mm_andnot_si128(a, b) is b && !a */
+        __m128i E0 = selectPixels(_mm_andnot_si128(BF, _mm_andnot_si128(DH, DB)), D, E);
+        __m128i E1 = selectPixels(_mm_andnot_si128(DB, _mm_andnot_si128(HF, BF)), F, E);
+        __m128i E2 = selectPixels(_mm_andnot_si128(DB, _mm_andnot_si128(HF, DH)), D, E);
+        __m128i E3 = selectPixels(_mm_andnot_si128(DH, _mm_andnot_si128(BF, HF)), F, E);
+
+        _mm_storeu_si128((__m128i*)(out0 + (x * 2)), _mm_unpacklo_epi32(E0, E1));
+        _mm_storeu_si128((__m128i*)(out0 + (x * 2) + 4), _mm_unpackhi_epi32(E0, E1));
+        _mm_storeu_si128((__m128i*)(out1 + (x * 2)), _mm_unpacklo_epi32(E2, E3));
+        _mm_storeu_si128((__m128i*)(out1 + (x * 2) + 4), _mm_unpackhi_epi32(E2, E3));
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t B = above[x + 1];
+        uint32_t D = current[x];
+        uint32_t E = current[x + 1];
+        uint32_t F = current[x + 2];
+        uint32_t H = below[x + 1];
+
+        out0[x * 2] = D == B && B != F && D != H ? D : E;
+        out0[(x * 2) + 1] = B == F && B != D && F != H ? F : E;
+        out1[x * 2] = D == H && D != B && H != F ? D : E;
+        out1[(x * 2) + 1] = H == F && D != H && B != F ? F : E;
+    }
+}
+
+void scale2x(const uint32_t* in, int width, int height, uint32_t* out, int outPitch) {
+    uint32_t padded[3][FILTER_MAX_INPUT_WIDTH + 2];
+    if (width > FILTER_MAX_INPUT_WIDTH) return;
+
+    for (int y = 0; y < height; y++) {
+        padRow(in + ((y > 0 ? y - 1 : 0) * width), width, padded[0]);
+        padRow(in + (y * width), width, padded[1]);
+        padRow(in + ((y + 1 < height ? y + 1 : y) * width), width, padded[2]);
+
+        scale2xRow(padded[0], padded[1], padded[2], width,
+                   out + ((y * 2) * outPitch), out + (((y * 2) + 1) * outPitch));
+    }
+}
+
+static void scale3xRow(const uint32_t* above, const uint32_t* current, const uint32_t* below,
+                       int width, uint32_t* out0, uint32_t* out1, uint32_t* out2) {
+    int x = 0;
+#ifdef FILTER_SIMD
+    for (; x + 4 <= width; x += 4) {
+        __m128i A = _mm_loadu_si128((const __m128i*)(above + x));
+        __m128i B = _mm_loadu_si128((const __m128i*)(above + x + 1));
+        __m128i C = _mm_loadu_si128((const __m128i*)(above + x + 2));
+        __m128i D = _mm_loadu_si128((const __m128i*)(current + x));
+        __m128i E = _mm_loadu_si128((const __m128i*)(current + x + 1));
+        __m128i F = _mm_loadu_si128((const __m128i*)(current + x + 2));
+        __m128i G = _mm_loadu_si128((const __m128i*)(below + x));
+        __m128i H = _mm_loadu_si128((const __m128i*)(below + x + 1));
+        __m128i I = _mm_loadu_si128((const __m128i*)(below + x + 2));
+
+        __m128i DB = _mm_cmpeq_epi32(D, B);
+        __m128i BF = _mm_cmpeq_epi32(B, F);
+        __m128i DH = _mm_cmpeq_epi32(D, H);
+        __m128i HF = _mm_cmpeq_epi32(H, F);
+        __m128i EA = _mm_cmpeq_epi32(E, A);
+        __m128i EC = _mm_cmpeq_epi32(E, C);
+        __m128i EG = _mm_cmpeq_epi32(E, G);
+        __m128i EI = _mm_cmpeq_epi32(E, I);
+
+        /* The 4 edge conditions every output pixel is built from */
+        __m128i edgeDB = _mm_andnot_si128(BF, _mm_andnot_si128(DH, DB));
+        __m128i edgeBF = _mm_andnot_si128(DB, _mm_andnot_si128(HF, BF));
+        __m128i edgeDH = _mm_andnot_si128(DB, _mm_andnot_si128(HF, DH));
+        __m128i edgeHF = _mm_andnot_si128(DH, _mm_andnot_si128(BF, HF));
+
+        __m128i E0 = selectPixels(edgeDB, D, E);
+        __m128i E1 = selectPixels(_mm_or_si128(_mm_andnot_si128(EC, edgeDB), _mm_andnot_si128(EA, edgeBF)), B, E);
+        __m128i E2 = selectPixels(edgeBF, F, E);
+        __m128i E3 = selectPixels(_mm_or_si128(_mm_andnot_si128(EG, edgeDB), _mm_andnot_si128(EA, edgeDH)), D, E);
+        __m128i E5 = selectPixels(_mm_or_si128(_mm_andnot_si128(EI, edgeBF), _mm_andnot_si128(EC, edgeHF)), F, E);
+        __m128i E6 = selectPixels(edgeDH, D, E);
+        __m128i E7 = selectPixels(_mm_or_si128(_mm_andnot_si128(EI, edgeDH), _mm_andnot_si128(EG, edgeHF)), H, E);
+        __m128i E8 = selectPixels(edgeHF, F, E);
+
+        storeInterleaved_3(out0 + (x * 3), E0, E1, E2);
+        storeInterleaved_3(out1 + (x * 3), E3, E, E5);
+        storeInterleaved_3(out2 + (x * 3), E6, E7, E8);
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t A = above[x], B = above[x + 1], C = above[x + 2];
+        uint32_t D = current[x], E = current[x + 1], F = current[x + 2];
+        uint32_t G = below[x], H = below[x + 1], I = below[x + 2];
+
+        bool edgeDB = D == B && B != F && D != H;
+        bool edgeBF = B == F && B != D && F != H;
+        bool edgeDH = D == H && D != B && H != F;
+        bool edgeHF = H == F && D != H && B != F;
+
+        out0[x * 3] = edgeDB ? D : E;
+        out0[(x * 3) + 1] = (edgeDB && E != C) || (edgeBF && E != A) ? B : E;
+        out0[(x * 3) + 2] = edgeBF ? F : E;
+        out1[x * 3] = (edgeDB && E != G) || (edgeDH && E != A) ? D : E;
+        out1[(x * 3) + 1] = E;
+        out1[(x * 3) + 2] = (edgeBF && E != I) || (edgeHF && E != C) ? F : E;
+        out2[x * 3] = edgeDH ? D : E;
+        out2[(x * 3) + 1] = (edgeDH && E != I) || (edgeHF && E != G) ? H : E;
+        out2[(x * 3) + 2] = edgeHF ? F : E;
+    }
+}
+
+void scale3x(const uint32_t* in, int width, int height, uint32_t* out, int outPitch) {
+    uint32_t padded[3][FILTER_MAX_INPUT_WIDTH + 2];
+    if (width > FILTER_MAX_INPUT_WIDTH) return;
+
+    for (int y = 0; y < height; y++) {
+        padRow(in + ((y > 0 ? y - 1 : 0) * width), width, padded[0]);
+        padRow(in + (y * width), width, padded[1]);
+        padRow(in + ((y + 1 < height ? y + 1 : y) * width), width, padded[2]);
+
+        scale3xRow(padded[0], padded[1], padded[2], width, out + ((y * 3) * outPitch),
+                   out + (((y * 3) + 1) * outPitch), out + (((y * 3) + 2) * outPitch));
+    }
+}
@@ -7,6 +7,7 @@
 #include <gb/gui.h>
 
 #include <stdint.h>
+#include <limits.h>
 #include <time.h>
 #include <string.h>
 #include <SDL2/SDL.h>
@@ -16,23 +17,62 @@ static void initGB(GB* gb) {
     gb->cartridge = NULL;
     gb->emuMode = EMU_DMG;
 	memset(&gb->settings, 0, sizeof(GBSettings));
+	gb->settings.renderer = PPU_RENDERER_FIFO;
+#ifdef DEBUG_UNLOCK_FRAMERATE
+	gb->settings.frameSync = FRAME_SYNC_FREE_RUN;
+#else
+	gb->settings.frameSync = FRAME_SYNC_TIMER;
+#endif
+	gb->settings.frameskip = false;
+	gb->settings.maxFrameskip = 4;
+	gb->settings.scaleFilter = SCALE_FILTER_NEAREST;
+	gb->settings.integerScaling = true;
+	gb->settings.lcdGhosting = false;
+	gb->settings.colorCorrection = false;
+	gb->settings.jit = false;
+	gb->settings.jitLockstep = false;
+	gb->settings.idleLoopSkip = true;
+	gb->settings.timing = TIMING_CATCH_UP;
     gb->wram = NULL;
     gb->vram = NULL;
+    memset(gb->readMap, 0, sizeof(gb->readMap));
+    memset(gb->writeMap, 0, sizeof(gb->writeMap));
+    gb->tileCache = NULL;
+    /* VRAM starts out with garbage, every tile is decoded on first use */
+    memset(&gb->dirtyTiles, true, sizeof(gb->dirtyTiles));
     gb->selectedVRAMBank = 0;
     gb->selectedWRAMBank = 0;
     gb->memController = NULL;
     gb->memControllerType = MBC_NONE;
+    gb->memControllerInterface = NULL;
+    gb->rom0Bank = NULL;
+    gb->romNNBank = NULL;
+    gb->externalRAMBank = NULL;
+    memset(&gb->save, 0, sizeof(gb->save));
     gb->run = false;
     gb->paused = false;
 
     gb->scheduleInterruptEnable = false;
 	gb->dispatchedAddressesStart = 0;
 	memset(&gb->dispatchedAddresses, 0, 11*sizeof(uint16_t));
+    gb->blockCache.blocks = NULL;
+    gb->blockCache.codeMap = NULL;
+    gb->nextInstruction = &blockcache_noInstruction;
+    gb->operandCursor = NULL;
+    gb->lazyFlags.op = FLAG_OP_NONE;
+    memset(&gb->idleLoop, 0, sizeof(IdleLoopState));
+    gb->jit.code = NULL;
+    gb->interruptsDispatched = 0;
     gb->haltMode = false;
     gb->scheduleHaltBug = false;
+    gb->cpuEventPending = true;
     gb->scheduleDMA = false;
 
     gb->clock = 0;
+    gb->hardwareClock = 0;
+    gb->syncDeadline = 0;
+    gb->speedSwitchClock = 0;
+    gb->realCyclesAtSpeedSwitch = 0;
     gb->lastTIMASync = 0;
     gb->lastDIVSync = 0;
 
@@ -56,13 +96,42 @@ static void initGB(GB* gb) {
 
     gb->sdl_window = NULL;
     gb->sdl_renderer = NULL;
-    gb->ticksAtLastRender = 0;
+    gb->sdl_texture = NULL;
     gb->ticksAtStartup = 0;
+    pacer_init(&gb->pacer, T_CYCLES_PER_FRAME, T_CYCLES_PER_SEC);
+    gb->vsyncEnabled = false;
 
     gb->ppuMode = PPU_MODE_2;
     gb->hblankDuration = 0;
     gb->ppuEnabled = true;
     gb->skipFrame = false;
+    gb->skipFrameRender = false;
+    gb->framesSkipped = 0;
+    memset(&gb->frameBuffers, 0xFF, sizeof(gb->frameBuffers));
+    gb->backFrameBuffer = 0;
+    gb->readyFrameBuffer = 1;
+    gb->frontFrameBuffer = 2;
+    gb->framebuffer = gb->frameBuffers[gb->backFrameBuffer];
+    gb->coreThread = NULL;
+    gb->joypadUpdatePending = false;
+    gb->joypadInterruptPending = false;
+    gb->settingsChanged = false;
+    gb->debuggerVisible = false;
+    memset(&gb->debugSnapshot, 0, sizeof(DebugSnapshot));
+    gb->frontendLock = NULL;
+    gb->framesPublished = 0;
+    gb->framesPresented = 0;
+    gb->ghostingPrimed = false;
+    gb->filteredFrame = gb->frameBuffers[gb->frontFrameBuffer];
+    gb->scaledFrame = NULL;
+    gb->outputWidth = WIDTH_PX * DISPLAY_SCALING;
+    gb->outputHeight = HEIGHT_PX * DISPLAY_SCALING;
+    gb->outputStale = true;
+    gb->postProcessTime = 0;
+    gb->scanlineRendered = false;
+    gb->scanlineMode3Duration = 0;
+    memset(&gb->mode3WriteLines, 0, sizeof(gb->mode3WriteLines));
+    memset(&gb->fifoFallbackLines, 0, sizeof(gb->fifoFallbackLines));
     gb->firstTileInScanline = true;
     gb->doOptionalPush = false;
     gb->currentFetcherTask = 0;
@@ -77,6 +146,8 @@ static void initGB(GB* gb) {
     gb->pauseDotClock = 0;
     gb->pixelsToDiscard = 0;
     gb->currentBackgroundCRAMIndex = 0;
+    memset(&gb->dmgPaletteColors, 0, sizeof(gb->dmgPaletteColors));
+    memset(&gb->cgbPaletteColors, 0, sizeof(gb->cgbPaletteColors));
     gb->currentSpriteCRAMIndex = 0;
     gb->windowYCounter = 0;
     gb->lyWasWY = false;
@@ -108,6 +179,8 @@ static void initGB(GB* gb) {
     gb->joypadSelectedMode = JOYPAD_SELECT_DIRECTION_ACTION;
     gb->joypadActionBuffer = 0xF;
     gb->joypadDirectionBuffer = 0xF;
+    gb->pendingJoypadAction = 0xF;
+    gb->pendingJoypadDirection = 0xF;
 }
 
 static void initGBCartridge(GB* gb, Cartridge* cartridge) {
@@ -142,10 +215,11 @@ static void initGBCartridge(GB* gb, Cartridge* cartridge) {
         /* CGB needs WRAM, VRAM and CRAM banks allocated */
         gb->wram = (uint8_t*)malloc(0x1000 * 8);            /* 8 WRAM banks */
         gb->vram = (uint8_t*)malloc(0x2000 * 2);            /* 2 VRAM banks */
+        gb->tileCache = (uint8_t*)malloc(TILES_PER_VRAM_BANK * 2 * 64);
         gb->bgColorRAM = (uint8_t*)malloc(64);
         gb->spriteColorRAM = (uint8_t*)malloc(64);
 
-        if (gb->wram == NULL || gb->vram == NULL || gb->bgColorRAM == NULL ||
+        if (gb->wram == NULL || gb->vram == NULL || gb->tileCache == NULL || gb->bgColorRAM == NULL ||
                 gb->spriteColorRAM == NULL) {
 
             log_fatal(gb, "[FATAL] Could not allocate space for CGB WRAM/VRAM/CRAM\n");
@@ -164,12 +238,13 @@ static void initGBCartridge(GB* gb, Cartridge* cartridge) {
     } else if (gb->emuMode == EMU_DMG) {
         gb->wram = (uint8_t*)malloc(0x1000 * 2);        /* 2 WRAM banks */
         gb->vram = (uint8_t*)malloc(0x2000 * 1);        /* 1 VRAM bank */
+        gb->tileCache = (uint8_t*)malloc(TILES_PER_VRAM_BANK * 64);
 
         /* These values are constant throughout */
         gb->selectedVRAMBank = 0;
         gb->selectedWRAMBank = 1;
 
-        if (gb->wram == NULL || gb->vram == NULL) {
+        if (gb->wram == NULL || gb->vram == NULL || gb->tileCache == NULL) {
             log_fatal(gb, "[FATAL] Could not allocate space for DMG WRAM/VRAM\n");
             return;
         }
@@ -191,6 +266,10 @@ static void initGBCartridge(GB* gb, Cartridge* cartridge) {
 		gb->settings.shade3_rgb = 0x000000;
 
         resetGB(gb);
+
+        updatePaletteColors_DMG(gb, DMG_PALETTE_BGP);
+        updatePaletteColors_DMG(gb, DMG_PALETTE_OBP0);
+        updatePaletteColors_DMG(gb, DMG_PALETTE_OBP1);
     }
 }
 
@@ -239,6 +318,14 @@ unsigned long clock_u() {
 
 /* Timer */
 
+/* Number of cycles per increment for each TIMA frequency (as per single speed mode) */
+static const unsigned int timerCycleTable[] = {
+    1024,		// 4096 Hz
+    16,			// 262144 Hz
+    64,			// 65536 Hz
+    256			// 16384 Hz
+};
+
 void incrementTIMA(GB* gb) {
     uint8_t old = gb->IO[R_TIMA];
 
@@ -290,15 +377,7 @@ void syncTimer(GB* gb) {
     uint8_t timerFrequency  =  timerControl & 0b00000011;
 
     if (timerEnabled) {
-        /* Cycle table contains number of cycles per increment for its corresponding freq
-		 * (as per single speed mode) */
-        int cycleTable[] = {
-            1024,		// 4096 Hz
-            16,			// 262144 Hz
-            64,			// 65536 Hz
-            256			// 16384 Hz
-        };
-        unsigned int cyc = cycleTable[timerFrequency];
+        unsigned int cyc = timerCycleTable[timerFrequency];
 
         if (cyclesElapsedTIMA >= cyc) {
             /* The least amount of cycles per increment for the timer
@@ -323,6 +402,19 @@ void syncTimer(GB* gb) {
     }
 }
 
+static unsigned int getIdleTimerCycles(GB* gb) {
+    /* M cycles before TIMA overflows */
+    if (!GET_BIT(gb->IO[R_TAC], 2)) return UINT_MAX;
+
+    /* Wraps the same way as in syncTimer */
+    unsigned int cycles = gb->clock;
+    unsigned int elapsed = cycles - gb->lastTIMASync;
+    unsigned int overflow = (0x100 - gb->IO[R_TIMA]) * timerCycleTable[gb->IO[R_TAC] & 0b00000011];
+    if (elapsed >= overflow) return 0;
+
+    return (overflow - elapsed - 1) / 4;
+}
+
 /* DMA Transfers */
 void scheduleDMATransfer(GB* gb, uint8_t byte) {
     if (byte > 0xDF) {
@@ -519,25 +611,22 @@ void cancelHDMATransfer(GB* gb) {
 /* ------------------ */
 
 static void run(GB* gb) {
-    /* We do input polling every 1000 cpu ticks */
     gb->ticksAtStartup = clock_u();
+    pacer_reset(&gb->pacer);
 
-    for (;gb->run;) {
-        /* Handle Events */
-        dispatch(gb);
-    }
+    /* Runs until the emulator is stopped */
+    dispatch(gb);
 }
 
-void cyclesSync_4(GB* gb) {
-    /* This function is called millions of times by the CPU
-     * in a second and therefore it needs to be optimised
-     *
-     * So we dont update all hardware but only the ones that need to
-     * always be upto date like the display and DMA/HDMA
-     *
-     */
-    gb->clock += 4;
+static int runCoreThread(void* data) {
+    /* Input is polled by the presentation thread and applied at the end of every frame */
+    run((GB*)data);
+    return 0;
+}
 
+static void stepHardware(GB* gb) {
+    /* Runs 4 tcycles of the display and DMA/HDMA, the timer is synced separately
+     * because only reads and interrupts depend on it */
     syncDisplay(gb);
 
     if (gb->doingDMA) syncDMA(gb);
@@ -558,14 +647,94 @@ void cyclesSync_4(GB* gb) {
 	}
 }
 
+static void updateSyncDeadline(GB* gb) {
+    /* In catch up timing the hardware only has to run before the CPU could notice that it
+     * didnt, the CPU syncs it before touching VRAM, OAM or IO itself. Anything which moves
+     * data every cycle or changes the speed keeps it eager */
+    if (gb->settings.timing == TIMING_EAGER || gb->doingDMA || gb->scheduleDMA ||
+        gb->scheduleGDMA || gb->scheduleHDMA || gb->doingHDMA || gb->doingSpeedSwitch) {
+        gb->syncDeadline = 0;
+        return;
+    }
+
+    gb->syncDeadline = gb->clock + (getQuietDisplayCycles(gb) + 1) * 4;
+}
+
+void syncHardware(GB* gb) {
+    /* GDMA runs the cycles it takes from inside stepHardware, those sync themselves through
+     * cyclesSync_4 so the loop ends with the hardware at the CPU's clock */
+    while (gb->hardwareClock < gb->clock) {
+        gb->hardwareClock += 4;
+        stepHardware(gb);
+    }
+
+    updateSyncDeadline(gb);
+}
+
+void cyclesSync_4(GB* gb) {
+    /* This function is called millions of times by the CPU
+     * in a second and therefore it needs to be optimised
+     *
+     * So we dont update all hardware but only the ones that need to
+     * always be upto date like the display and DMA/HDMA, in catch up timing
+     * not even those until the deadline
+     *
+     */
+    gb->clock += 4;
+    if (gb->clock < gb->syncDeadline) return;
+
+    syncHardware(gb);
+}
+
+unsigned int getIdleCycles(GB* gb) {
+    syncHardware(gb);
+    /* DMA transfers need every cycle */
+    if (gb->doingDMA || gb->scheduleDMA || gb->scheduleGDMA || gb->scheduleHDMA || gb->stepHDMA) return 0;
+    /* DIV is behind by more than one step (after a speed switch) and catches up one step
+     * per sync */
+    unsigned int cycles = gb->clock;
+    if (cycles - gb->lastDIVSync >= T_CYCLES_PER_DIV) return 0;
+
+    unsigned int idle = getIdleDisplayCycles(gb);
+    unsigned int timer = getIdleTimerCycles(gb);
+    return timer < idle ? timer : idle;
+}
+
+void skipCycles(GB* gb, unsigned int mCycles) {
+    /* The timer is synced at least once per DIV step, so DIV counts the same as when it is
+     * synced every cycle. TIMA doesnt overflow within idle cycles */
+    const unsigned int maxStep = T_CYCLES_PER_DIV / 4;
+
+    while (mCycles > 0) {
+        unsigned int step = mCycles < maxStep ? mCycles : maxStep;
+
+        gb->clock += step * 4;
+        gb->hardwareClock += step * 4;
+        skipDisplay(gb, step);
+        syncTimer(gb);
+        mCycles -= step;
+    }
+}
+
 /* SDL */
 
 int initSDL(GB* gb) {
     SDL_Init(SDL_INIT_EVERYTHING);
-    SDL_CreateWindowAndRenderer(WIDTH_PX * DISPLAY_SCALING, HEIGHT_PX * DISPLAY_SCALING + MENU_HEIGHT_PX, SDL_WINDOW_SHOWN,
-            &gb->sdl_window, &gb->sdl_renderer);
+    SDL_CreateWindowAndRenderer(WIDTH_PX * DISPLAY_SCALING, HEIGHT_PX * DISPLAY_SCALING + MENU_HEIGHT_PX,
+            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE, &gb->sdl_window, &gb->sdl_renderer);
 
     if (!gb->sdl_window) return 1;          /* Failed to create screen */
+    SDL_SetWindowMinimumSize(gb->sdl_window, WIDTH_PX, HEIGHT_PX + MENU_HEIGHT_PX);
+
+    /* Post processed frames are written straight into this texture by the presentation
+     * thread, it always has the output size so it is copied without scaling */
+    gb->sdl_texture = SDL_CreateTexture(gb->sdl_renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, gb->outputWidth, gb->outputHeight);
+
+    if (!gb->sdl_texture) return 2;         /* Failed to create framebuffer texture */
+
+    gb->scaledFrame = (uint32_t*)malloc(WIDTH_PX * HEIGHT_PX * 9 * sizeof(uint32_t));
+    if (!gb->scaledFrame) return 3;
 	SDL_SetWindowPosition(gb->sdl_window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
 
     SDL_SetWindowTitle(gb->sdl_window, "MegaGB");
@@ -575,6 +744,11 @@ int initSDL(GB* gb) {
 void handleSDLEvents(GB* gb) {
     /* We listen for events like keystrokes and window closing */
     SDL_Event event;
+    /* Only this thread writes the pending buffers, the core thread picks them up at the end
+     * of its frame */
+    uint8_t direction = gb->pendingJoypadDirection;
+    uint8_t action = gb->pendingJoypadAction;
+
     while (SDL_PollEvent(&event)) {
 		processEventsIMGUI(gb, &event);
         if (event.type == SDL_KEYDOWN && event.key.repeat == 0) {
@@ -583,96 +757,157 @@ void handleSDLEvents(GB* gb) {
             switch (event.key.keysym.scancode) {
                 case SDL_SCANCODE_UP:
                     /* Joypad Up */
-                    CLEAR_BIT(gb->joypadDirectionBuffer, 2);
+                    CLEAR_BIT(direction, 2);
                     break;
                 case SDL_SCANCODE_LEFT:
                     /* Joypad Left */
-                    CLEAR_BIT(gb->joypadDirectionBuffer, 1);
+                    CLEAR_BIT(direction, 1);
                     break;
                 case SDL_SCANCODE_DOWN:
                     /* Joypad Down */
-                    CLEAR_BIT(gb->joypadDirectionBuffer, 3);
+                    CLEAR_BIT(direction, 3);
                     break;
                 case SDL_SCANCODE_RIGHT:
                     /* Joypad Right */
-                    CLEAR_BIT(gb->joypadDirectionBuffer, 0);
+                    CLEAR_BIT(direction, 0);
                     break;
                 case SDL_SCANCODE_Z:
                     /* B */
-                    CLEAR_BIT(gb->joypadActionBuffer, 1);
+                    CLEAR_BIT(action, 1);
                     break;
                 case SDL_SCANCODE_X:
                     /* A */
-                    CLEAR_BIT(gb->joypadActionBuffer, 0);
+                    CLEAR_BIT(action, 0);
                     break;
                 case SDL_SCANCODE_RETURN:
                     /* Start */
-                    CLEAR_BIT(gb->joypadActionBuffer, 3);
+                    CLEAR_BIT(action, 3);
                     break;
                 case SDL_SCANCODE_TAB:
                     /* Select */
-                    CLEAR_BIT(gb->joypadActionBuffer, 2);
+                    CLEAR_BIT(action, 2);
                     break;
                 default: return;
             }
 
-            updateJoypadRegBuffer(gb, gb->joypadSelectedMode);
-
-            if (gb->joypadSelectedMode != JOYPAD_SELECT_NONE) {
-                /* Request joypad interrupt if atleast 1 of the modes are selected */
-                requestInterrupt(gb, INTERRUPT_JOYPAD);
-            }
+            /* The core thread updates the register and requests the interrupt */
+            __atomic_store_n(&gb->pendingJoypadDirection, direction, __ATOMIC_RELAXED);
+            __atomic_store_n(&gb->pendingJoypadAction, action, __ATOMIC_RELAXED);
+            __atomic_store_n(&gb->joypadUpdatePending, true, __ATOMIC_RELEASE);
+            __atomic_store_n(&gb->joypadInterruptPending, true, __ATOMIC_RELEASE);
         } else if (event.type == SDL_KEYUP && event.key.repeat == 0) {
             switch (event.key.keysym.scancode) {
                 case SDL_SCANCODE_UP:
                     /* Joypad Up */
-                    SET_BIT(gb->joypadDirectionBuffer, 2);
+                    SET_BIT(direction, 2);
                     break;
                 case SDL_SCANCODE_LEFT:
                     /* Joypad Left */
-                    SET_BIT(gb->joypadDirectionBuffer, 1);
+                    SET_BIT(direction, 1);
                     break;
                 case SDL_SCANCODE_DOWN:
                     /* Joypad Down */
-                    SET_BIT(gb->joypadDirectionBuffer, 3);
+                    SET_BIT(direction, 3);
                     break;
                 case SDL_SCANCODE_RIGHT:
                     /* Joypad Right */
-                    SET_BIT(gb->joypadDirectionBuffer, 0);
+                    SET_BIT(direction, 0);
                     break;
                 case SDL_SCANCODE_Z:
                     /* B */
-                    SET_BIT(gb->joypadActionBuffer, 1);
+                    SET_BIT(action, 1);
                     break;
                 case SDL_SCANCODE_X:
                     /* A */
-                    SET_BIT(gb->joypadActionBuffer, 0);
+                    SET_BIT(action, 0);
                     break;
                 case SDL_SCANCODE_RETURN:
                     /* Start */
-                    SET_BIT(gb->joypadActionBuffer, 3);
+                    SET_BIT(action, 3);
                     break;
                 case SDL_SCANCODE_TAB:
                     /* Select */
-                    SET_BIT(gb->joypadActionBuffer, 2);
+                    SET_BIT(action, 2);
                     break;
                 default: return;
             }
-            updateJoypadRegBuffer(gb, gb->joypadSelectedMode);
+            __atomic_store_n(&gb->pendingJoypadDirection, direction, __ATOMIC_RELAXED);
+            __atomic_store_n(&gb->pendingJoypadAction, action, __ATOMIC_RELAXED);
+            __atomic_store_n(&gb->joypadUpdatePending, true, __ATOMIC_RELEASE);
 
         } else if (event.type == SDL_QUIT) {
-            gb->run = false;
+            __atomic_store_n(&gb->run, false, __ATOMIC_RELEASE);
         } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE && event.window.windowID == SDL_GetWindowID(gb->sdl_window)) {
-			gb->run = false;
+			__atomic_store_n(&gb->run, false, __ATOMIC_RELEASE);
 		}
     }
 }
 
 void freeSDL(GB* gb) {
+    free(gb->scaledFrame);
+    SDL_DestroyTexture(gb->sdl_texture);
     SDL_DestroyRenderer(gb->sdl_renderer);
     SDL_DestroyWindow(gb->sdl_window);
     SDL_Quit();
 }
+static void applySettings(GB* gb) {
+    SDL_LockMutex(gb->frontendLock);
+    GBSettings settings = gb->pendingSettings;
+    SDL_UnlockMutex(gb->frontendLock);
+
+    /* Shade tables are only rebuilt when a shade actually changed */
+    bool shadesChanged = settings.shade0_rgb != gb->settings.shade0_rgb ||
+        settings.shade1_rgb != gb->settings.shade1_rgb ||
+        settings.shade2_rgb != gb->settings.shade2_rgb ||
+        settings.shade3_rgb != gb->settings.shade3_rgb;
+
+    gb->settings = settings;
+
+    if (shadesChanged) {
+        updatePaletteColors_DMG(gb, DMG_PALETTE_BGP);
+        updatePaletteColors_DMG(gb, DMG_PALETTE_OBP0);
+        updatePaletteColors_DMG(gb, DMG_PALETTE_OBP1);
+    }
+}
+
+static void publishDebugSnapshot(GB* gb) {
+    /* Built outside of the lock, the GUI only waits for the copy */
+    DebugSnapshot snapshot;
+    updateDebugSnapshot(gb, &snapshot);
+
+    SDL_LockMutex(gb->frontendLock);
+    gb->debugSnapshot = snapshot;
+    SDL_UnlockMutex(gb->frontendLock);
+}
+
+void syncFrontend(GB* gb) {
+    if (__atomic_exchange_n(&gb->joypadUpdatePending, false, __ATOMIC_ACQUIRE)) {
+        gb->joypadDirectionBuffer = __atomic_load_n(&gb->pendingJoypadDirection, __ATOMIC_RELAXED);
+        gb->joypadActionBuffer = __atomic_load_n(&gb->pendingJoypadAction, __ATOMIC_RELAXED);
+        updateJoypadRegBuffer(gb, gb->joypadSelectedMode);
+    }
+
+    if (__atomic_exchange_n(&gb->joypadInterruptPending, false, __ATOMIC_ACQUIRE) &&
+            gb->joypadSelectedMode != JOYPAD_SELECT_NONE) {
+        /* Request joypad interrupt if atleast 1 of the modes are selected */
+        requestInterrupt(gb, INTERRUPT_JOYPAD);
+    }
+
+    if (__atomic_exchange_n(&gb->settingsChanged, false, __ATOMIC_ACQUIRE)) applySettings(gb);
+
+    save_endFrame(gb);
+
+    if (__atomic_load_n(&gb->debuggerVisible, __ATOMIC_RELAXED)) publishDebugSnapshot(gb);
+
+    if (__atomic_load_n(&gb->paused, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&gb->paused, __ATOMIC_ACQUIRE) && __atomic_load_n(&gb->run, __ATOMIC_ACQUIRE)) {
+            SDL_Delay(10);
+        }
+
+        /* Dont try to catch up on the time spent paused */
+        pacer_reset(&gb->pacer);
+    }
+}
 /* ---------------------------------------- */
 
 /* Joypad */
@@ -744,29 +979,45 @@ void startGBEmulator(Cartridge* cartridge) {
     printf("Setting up Memory Bank Controller\n");
 #endif
     mbc_allocate(&gb);
+    blockcache_init(&gb);
+    blockcache_syncBanks(&gb);
+    for (int i = 0; i < MEMORY_REGION_COUNT; i++) updateMemoryMap(&gb, (MEMORY_REGION)i);
+    jit_init(&gb);
+
+    /* The presentation thread edits its own copy of the settings */
+    gb.pendingSettings = gb.settings;
+    gb.frontendLock = SDL_CreateMutex();
+    if (gb.frontendLock == NULL) {
+        log_fatal(&gb, "Error creating the frontend lock");
+        return;
+    }
 
     /* We are now ready to run */
     gb.run = true;
 
-    run(&gb);
+    /* Emulation runs on its own thread so it never waits on the GPU or IMGUI,
+     * this thread owns SDL and presents the frames */
+    gb.coreThread = SDL_CreateThread(runCoreThread, "MegaGB Core", &gb);
+    if (gb.coreThread == NULL) {
+        log_fatal(&gb, "Error starting emulation thread");
+        return;
+    }
+
+    runPresentation(&gb);
+
+    SDL_WaitThread(gb.coreThread, NULL);
+    gb.coreThread = NULL;
     stopGBEmulator(&gb);
 }
 
 void pauseGBEmulator(GB* gb) {
-    if (gb->paused) return;
-    gb->paused = true;
-
-    while (true) {
-        handleSDLEvents(gb);
-		renderFrameIMGUI(gb);
-        if (!gb->paused || !gb->run) break;
-    }
+    /* The core thread waits at the end of the current frame until unpaused, the
+     * presentation thread keeps running the GUI meanwhile */
+    __atomic_store_n(&gb->paused, true, __ATOMIC_RELEASE);
 }
 
 void unpauseGBEmulator(GB* gb) {
-    if (!gb->paused) return;
-
-    gb->paused = false;
+    __atomic_store_n(&gb->paused, false, __ATOMIC_RELEASE);
 }
 
 void stopGBEmulator(GB* gb) {
@@ -776,6 +1027,9 @@ void stopGBEmulator(GB* gb) {
 
     printf("Ticks Per Second : %llu, x%g faster than normal speed\n", ticksPerSec, (double)ticksPerSec/(double)T_CYCLES_PER_SEC);
     printf("Time Elapsed : %g\n", totalElapsed);
+    pacer_printStats(&gb->pacer);
+    blockcache_printStats(gb);
+    jit_printStats(gb);
     printf("Stopping Emulator Now\n");
     printf("Cleaning allocations\n");
 #endif
@@ -784,11 +1038,16 @@ void stopGBEmulator(GB* gb) {
 	freeIMGUI(gb);
     /* Free up all SDL allocations and stop it */
     freeSDL(gb);
+    SDL_DestroyMutex(gb->frontendLock);
+    gb->frontendLock = NULL;
     /* Free up MBC allocations */
     mbc_free(gb);
+    blockcache_free(gb);
+    jit_free(gb);
 
     free(gb->wram);
     free(gb->vram);
+    free(gb->tileCache);
 
     if (gb->emuMode == EMU_CGB) {
         /* Free memory allocated specifically for CGB */
@@ -18,6 +18,18 @@ public:
 
 	/* Settings */
 	bool pause;
+	bool fastRenderer;
+	bool frameskip;
+	int maxFrameskip;
+	int frameSync;
+	int timing;
+	int scaleFilter;
+	bool integerScaling;
+	bool lcdGhosting;
+	bool colorCorrection;
+	bool jit;
+	bool jitLockstep;
+	bool idleLoopSkip;
 	float shade0_rgb[3] = {1, 1, 1};
 	float shade1_rgb[3] = {0.666, 0.666, 0.666};
 	float shade2_rgb[3] = {0.333, 0.333, 0.333};
@@ -28,6 +40,18 @@ public:
 GuiState::GuiState() {
 	this->showInternals = false;
 	this->pause = false;
+	this->fastRenderer = false;
+	this->frameskip = false;
+	this->maxFrameskip = 4;
+	this->frameSync = FRAME_SYNC_TIMER;
+	this->timing = TIMING_CATCH_UP;
+	this->scaleFilter = SCALE_FILTER_NEAREST;
+	this->integerScaling = true;
+	this->lcdGhosting = false;
+	this->colorCorrection = false;
+	this->jit = false;
+	this->jitLockstep = false;
+	this->idleLoopSkip = true;
 }
 
 /* Define Colors */
@@ -37,20 +61,7 @@ namespace Color {
 	unsigned TraceHighlightColor = IM_COL32(153, 78, 89, 255);
 }
 
-static std::string disassemble(GB* gb, uint16_t address, int* insLength) {
-	char disasm[30];
-	uint8_t opcode = readAddr(gb, address);
-	if (opcode == 0xCB) {
-		disassembleCBInstruction(gb, address+1, (char*)&disasm);
-		*insLength = 2;
-	} else {
-		*insLength = disassembleInstruction(gb, address, (char*)&disasm);
-	}
-
-	return std::string(disasm);
-}
-
-static void renderInstructionTraceTable(GB* gb) {
+static void renderInstructionTraceTable(const DebugSnapshot* snapshot) {
 	if (ImGui::BeginTable(
 				"Instructions", 2, 
 				ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_BordersV)) {
@@ -63,56 +74,18 @@ static void renderInstructionTraceTable(GB* gb) {
 		ImGui::TableSetColumnIndex(1);
 		ImGui::Text("Disassambly");
 
-		std::vector<std::string> disassembly;
-		std::vector<uint16_t> disassemblyAddr;
-
-		/* Insert preceding instructions */
-		int currentIndex = gb->dispatchedAddressesStart;
-		for (int i=0; i<10; i++) {
-			int currentInsLength;
-			std::string currentDisasm = disassemble(gb, gb->dispatchedAddresses[currentIndex], &currentInsLength);
-			disassembly.push_back(std::string(currentDisasm));
-			disassemblyAddr.push_back(gb->dispatchedAddresses[currentIndex]);
-
-			currentIndex++;
-			if (currentIndex > 10) currentIndex = 0;
-		}
-
-		/* Insert current instruction */
-		int currentInsLength;
-		uint16_t currentDispatchAddress = gb->dispatchedAddresses[gb->dispatchedAddressesStart > 0 ? gb->dispatchedAddressesStart-1 : 10];
-		std::string currentDisasm = disassemble(gb, currentDispatchAddress, &currentInsLength);
-
-		disassembly.push_back(std::string(currentDisasm));
-		disassemblyAddr.push_back(currentDispatchAddress);
-
-		/* We are left with 11 instructions, and 2 vectors that give the corresponding disassembly 
-		 * and address, we can build forward 9 instructions from this point onwards */
-		int relativeIndex = currentInsLength;
-
-		for (int i = 0; i < 9; i++) {
-			uint16_t addr = currentDispatchAddress+relativeIndex;
-			int insLength = 1;
-			std::string disasm = disassemble(gb, addr, (int*)&insLength);
-
-			disassembly.push_back(disasm);
-			disassemblyAddr.push_back(addr);
-
-			relativeIndex += insLength;
-		}
-
-		/* Disassembly data gathering complete, we can output it now */
-
-		for (int i = 0; i < disassembly.size(); i++) {
+		/* The core thread disassembled the preceding instructions, the current one and the
+		 * ones following it */
+		for (int i = 0; i < DEBUG_TRACE_LENGTH; i++) {
 			ImGui::TableNextRow();
 		
 			ImGui::TableSetColumnIndex(0);
-			ImGui::Text("0x%04x", disassemblyAddr[i]);
+			ImGui::Text("0x%04x", snapshot->traceAddresses[i]);
 
 			ImGui::TableSetColumnIndex(1);
-			ImGui::Text("%s", disassembly[i].c_str());
+			ImGui::Text("%s", snapshot->trace[i]);
 
-			if (i==10) {
+			if (i==DEBUG_TRACE_CURRENT) {
 				ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, Color::TraceHighlightColor);
 			}
 		}
@@ -207,7 +180,9 @@ void renderFrameIMGUI(GB* gb) {
 	ImGui_ImplSDL2_NewFrame();
 	ImGui::NewFrame();
 
-	ImGui::SetNextWindowSize(ImVec2(WIDTH_PX*DISPLAY_SCALING, MENU_HEIGHT_PX));
+	int windowWidth, windowHeight;
+	SDL_GetWindowSize(gb->sdl_window, &windowWidth, &windowHeight);
+	ImGui::SetNextWindowSize(ImVec2(windowWidth, MENU_HEIGHT_PX));
 	ImGui::SetNextWindowPos(ImVec2(0, 0));
 
 	ImGuiWindowFlags windowFlags1 = ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_MenuBar | ImGuiWindowFlags_NoResize;
@@ -225,6 +200,8 @@ void renderFrameIMGUI(GB* gb) {
 		}
 		if (ImGui::BeginMenu("Internal")) {
 				if (ImGui::Checkbox("Show Internal", &state->showInternals)) {
+					/* The core thread only builds the debugger snapshot while it is shown */
+					__atomic_store_n(&gb->debuggerVisible, state->showInternals, __ATOMIC_RELAXED);
 					if (state->showInternals) {
 						SDL_ShowWindow(gb->imgui_secondary_sdl_window);
 					} else {
@@ -253,6 +230,13 @@ void renderFrameIMGUI(GB* gb) {
 	int w, h;
 	SDL_GetWindowSize(gb->imgui_secondary_sdl_window, &w, &h);
 
+	/* Everything shown about the running emulator comes from the snapshot the core thread
+	 * published at the end of its last frame */
+	DebugSnapshot snapshot;
+	SDL_LockMutex(gb->frontendLock);
+	snapshot = gb->debugSnapshot;
+	SDL_UnlockMutex(gb->frontendLock);
+
 	ImGui::SetCurrentContext((ImGuiContext*)gb->imgui_secondary_context);
 	ImGuiIO io = ImGui::GetIO();
 	ImGuiWindowFlags windowFlags2 = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoFocusOnAppearing;
@@ -286,21 +270,22 @@ void renderFrameIMGUI(GB* gb) {
 		ImGui::TableSetColumnIndex(3);
 		ImGui::Text("Value");
 
-		std::string RegName[8] = {"A","B","C","D","E","F","H","L"};
+		const char* RegName[8] = {"A","F","B","C","D","E","H","L"};
+		const GP_REG Regs[8] = {R8_A, R8_F, R8_B, R8_C, R8_D, R8_E, R8_H, R8_L};
 
 		for (int row = 0; row < 4; row++) {
 			ImGui::TableNextRow();
 			
 			ImGui::TableSetColumnIndex(0);
-			ImGui::Text("%s", RegName[row*2].c_str());
+			ImGui::Text("%s", RegName[row*2]);
 
 			ImGui::TableSetColumnIndex(1);
-			ImGui::Text("0x%02x", gb->GPR[row*2]);
+			ImGui::Text("0x%02x", snapshot.GPR[Regs[row*2]]);
 
 			ImGui::TableSetColumnIndex(2);
-			ImGui::Text("%s", RegName[row*2+1].c_str());
+			ImGui::Text("%s", RegName[row*2+1]);
 			ImGui::TableSetColumnIndex(3);
-			ImGui::Text("0x%02x", gb->GPR[row*2+1]);
+			ImGui::Text("0x%02x", snapshot.GPR[Regs[row*2+1]]);
 		}
 
 		ImGui::TableNextRow();
@@ -309,12 +294,12 @@ void renderFrameIMGUI(GB* gb) {
 		ImGui::Text("PC");
 
 		ImGui::TableSetColumnIndex(1);
-		ImGui::Text("0x%04x", gb->PC);
+		ImGui::Text("0x%04x", snapshot.PC);
 
 		ImGui::TableSetColumnIndex(2);
 		ImGui::Text("SP");
 		ImGui::TableSetColumnIndex(3);
-		ImGui::Text("0x%04x", (gb->GPR[R16_SP]<<8) | gb->GPR[R16_SP+1]);
+		ImGui::Text("0x%04x", snapshot.SP);
 
 
 		ImGui::EndTable();
@@ -336,33 +321,108 @@ void renderFrameIMGUI(GB* gb) {
 		ImGui::EndMenu();
 	}
 
-	ImGui::ColorEdit3("Shade 0", (float*)&state->shade0_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
-	ImGui::ColorEdit3("Shade 1", (float*)&state->shade1_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
-	ImGui::ColorEdit3("Shade 2", (float*)&state->shade2_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
-	ImGui::ColorEdit3("Shade 3", (float*)&state->shade3_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
-
-	gb->settings.shade0_rgb = (((uint32_t)(state->shade0_rgb[0]*255))<<16)|(((uint32_t)(state->shade0_rgb[1]*255))<<8)|(((uint32_t)(state->shade0_rgb[2]*255)));
-
-	gb->settings.shade1_rgb = (((uint32_t)(state->shade1_rgb[0]*255))<<16)|(((uint32_t)(state->shade1_rgb[1]*255))<<8)|(((uint32_t)(state->shade1_rgb[2]*255)));
-	gb->settings.shade2_rgb = (((uint32_t)(state->shade2_rgb[0]*255))<<16)|(((uint32_t)(state->shade2_rgb[1]*255))<<8)|(((uint32_t)(state->shade2_rgb[2]*255)));
-	gb->settings.shade3_rgb = (((uint32_t)(state->shade3_rgb[0]*255))<<16)|(((uint32_t)(state->shade3_rgb[1]*255))<<8)|(((uint32_t)(state->shade3_rgb[2]*255)));
+	/* Options are edited on a copy, the core thread picks it up at the end of its frame */
+	GBSettings settings = gb->pendingSettings;
+	bool settingsChanged = false;
+
+	bool shadesChanged = false;
+	shadesChanged |= ImGui::ColorEdit3("Shade 0", (float*)&state->shade0_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
+	shadesChanged |= ImGui::ColorEdit3("Shade 1", (float*)&state->shade1_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
+	shadesChanged |= ImGui::ColorEdit3("Shade 2", (float*)&state->shade2_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
+	shadesChanged |= ImGui::ColorEdit3("Shade 3", (float*)&state->shade3_rgb, gb->emuMode == EMU_CGB ? ImGuiColorEditFlags_NoInputs : 0);
+
+	if (shadesChanged) {
+		settings.shade0_rgb = (((uint32_t)(state->shade0_rgb[0]*255))<<16)|(((uint32_t)(state->shade0_rgb[1]*255))<<8)|(((uint32_t)(state->shade0_rgb[2]*255)));
+		settings.shade1_rgb = (((uint32_t)(state->shade1_rgb[0]*255))<<16)|(((uint32_t)(state->shade1_rgb[1]*255))<<8)|(((uint32_t)(state->shade1_rgb[2]*255)));
+		settings.shade2_rgb = (((uint32_t)(state->shade2_rgb[0]*255))<<16)|(((uint32_t)(state->shade2_rgb[1]*255))<<8)|(((uint32_t)(state->shade2_rgb[2]*255)));
+		settings.shade3_rgb = (((uint32_t)(state->shade3_rgb[0]*255))<<16)|(((uint32_t)(state->shade3_rgb[1]*255))<<8)|(((uint32_t)(state->shade3_rgb[2]*255)));
+		settingsChanged = true;
+	}
 
 	/* ----- Pausing ------ */
 	if (ImGui::BeginMenu("Emulator")) {
 		ImGui::EndMenu();
 	}
 	if (ImGui::Checkbox("Pause", &state->pause)) {
-		if (state->pause) {
-			/* Prematurely terminate current frame rendering as emulator enters pause mode,
-			 * after we exit we just return */
-			ImGui::End();
-			ImGui::SetCurrentContext(initialCtx);
-			ImGui::EndFrame();
-			pauseGBEmulator(gb);
-			return;
-		}
+		/* The core thread stops at the end of its current frame, the GUI keeps running */
+		if (state->pause) pauseGBEmulator(gb);
 		else unpauseGBEmulator(gb);
 	}
+	/* Scanline renderer is faster but less accurate than the FIFO renderer */
+	if (ImGui::Checkbox("Fast Renderer", &state->fastRenderer)) {
+		settings.renderer = state->fastRenderer ? PPU_RENDERER_SCANLINE : PPU_RENDERER_FIFO;
+		settingsChanged = true;
+	}
+	/* Frames are skipped only while the emulator is behind real time */
+	if (ImGui::Checkbox("Auto Frameskip", &state->frameskip)) {
+		settings.frameskip = state->frameskip;
+		settingsChanged = true;
+	}
+	if (ImGui::SliderInt("Max Frameskip", &state->maxFrameskip, 1, 9)) {
+		settings.maxFrameskip = state->maxFrameskip;
+		settingsChanged = true;
+	}
+	/* Order matches FRAME_SYNC */
+	state->frameSync = settings.frameSync;
+	if (ImGui::Combo("Sync", &state->frameSync, "Timer\0VSync\0Free Run\0")) {
+		settings.frameSync = (FRAME_SYNC)state->frameSync;
+		settingsChanged = true;
+	}
+	ImGui::Text("Jitter: %.1fus avg, %.1fus dev, %.1fus max, %llu missed",
+			snapshot.jitterMean / 1e3, snapshot.jitterDeviation / 1e3,
+			snapshot.jitterMax / 1e3, (unsigned long long)snapshot.deadlinesMissed);
+	/* Hot code in ROM is compiled, lockstep checks every compiled block against the interpreter */
+	if (ImGui::Checkbox("JIT", &state->jit)) {
+		settings.jit = state->jit;
+		settingsChanged = true;
+	}
+	if (ImGui::Checkbox("JIT Lockstep", &state->jitLockstep)) {
+		settings.jitLockstep = state->jitLockstep;
+		settingsChanged = true;
+	}
+	ImGui::Text("JIT: %llu compiled, %llu mismatches",
+			(unsigned long long)snapshot.jitBlocksCompiled, (unsigned long long)snapshot.jitLockstepMismatches);
+	/* Polling loops are skipped to the next hardware event, can be turned off for ROMs
+	 * which misbehave with it */
+	if (ImGui::Checkbox("Skip Idle Loops", &state->idleLoopSkip)) {
+		settings.idleLoopSkip = state->idleLoopSkip;
+		settingsChanged = true;
+	}
+	/* Order matches TIMING_MODE, eager keeps every M cycle in sync for accuracy tests */
+	state->timing = settings.timing;
+	if (ImGui::Combo("Timing", &state->timing, "Eager\0Catch Up\0")) {
+		settings.timing = (TIMING_MODE)state->timing;
+		settingsChanged = true;
+	}
+
+	/* ----- Post Processing ------ */
+	if (ImGui::BeginMenu("Display")) {
+		ImGui::EndMenu();
+	}
+	/* Post processing runs on this thread, changes only need the output rendered again */
+	bool outputChanged = false;
+	/* Order matches SCALE_FILTER */
+	outputChanged |= ImGui::Combo("Filter", &state->scaleFilter, "Nearest\0Scale2x\0Scale3x\0Bilinear\0");
+	outputChanged |= ImGui::Checkbox("Integer Scaling", &state->integerScaling);
+	outputChanged |= ImGui::Checkbox("LCD Ghosting", &state->lcdGhosting);
+	outputChanged |= ImGui::Checkbox("Color Correction (CGB)", &state->colorCorrection);
+
+	if (outputChanged) {
+		settings.scaleFilter = (SCALE_FILTER)state->scaleFilter;
+		settings.integerScaling = state->integerScaling;
+		settings.lcdGhosting = state->lcdGhosting;
+		settings.colorCorrection = state->colorCorrection;
+		gb->outputStale = true;
+		settingsChanged = true;
+	}
+
+	if (settingsChanged) {
+		SDL_LockMutex(gb->frontendLock);
+		gb->pendingSettings = settings;
+		SDL_UnlockMutex(gb->frontendLock);
+		__atomic_store_n(&gb->settingsChanged, true, __ATOMIC_RELEASE);
+	}
+	ImGui::Text("Output: %dx%d, %.3fms", gb->outputWidth, gb->outputHeight, gb->postProcessTime / 1e6);
 	/* ------------------------------------- */
 	ImGui::End();
 
@@ -375,7 +435,8 @@ void renderFrameIMGUI(GB* gb) {
 	ImGui::SetWindowPos(ImVec2(REL_X(0.5), REL_Y(0)));
 	ImGui::SetWindowFontScale(1.25);
 
-	renderInstructionTraceTable(gb);
+	/* The trace is from the end of the last frame the core thread finished */
+	renderInstructionTraceTable(&snapshot);
 
 	ImGui::End();
 
@@ -402,6 +463,7 @@ void processEventsIMGUI(GB* gb, SDL_Event* event) {
 			/* Requested secondary window to close, hide it */
 			GuiState* state = (GuiState*)gb->imgui_gui_state;
 			state->showInternals = false;
+			__atomic_store_n(&gb->debuggerVisible, false, __ATOMIC_RELAXED);
 			SDL_HideWindow(gb->imgui_secondary_sdl_window);
 		} else if (event->window.event == SDL_WINDOWEVENT_FOCUS_GAINED) {
 			/* Whichever window gains focus, set current imgui context to it, for
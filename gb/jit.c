@@ -0,0 +1,967 @@
+#include <gb/jit.h>
+#include <gb/gb.h>
+#include <gb/cpu.h>
+#include <gb/debug.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef JIT_SUPPORTED
+#include <sys/mman.h>
+
+/* Compiled blocks are called with the GB in rdi and keep the CPU state in callee saved
+ * registers, so helpers can be called without saving anything
+ *
+ *  rbx  gb          r12d  A           r13d  F
+ *  r14d BC          r15d  DE          ebp   HL
+ *
+ * All of them hold zero extended values, eax ecx edx esi and edi are scratch */
+
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+#define HOST_A R12
+#define HOST_F R13
+#define HOST_BC R14
+#define HOST_DE R15
+#define HOST_HL RBP
+
+/* Conditions for jcc and setcc */
+#define CC_C 0x2
+#define CC_Z 0x4
+#define CC_NZ 0x5
+
+/* Space left in the buffer before a block is compiled, no instruction comes close to
+ * 256 bytes */
+#define JIT_MAX_BLOCK_CODE ((BLOCK_MAX_INSTRUCTIONS + 2) * 256)
+/* Compiled instructions run per lockstep check */
+#define JIT_LOCKSTEP_MAX_INSTRUCTIONS (BLOCK_MAX_INSTRUCTIONS * 2)
+
+typedef void (*JITBlockFunction)(GB* gb);
+
+typedef struct {
+    uint8_t* cursor;
+    uint8_t* exitLabel;
+    uint8_t* labels[BLOCK_MAX_INSTRUCTIONS];
+    uint8_t* fixupSites[BLOCK_MAX_INSTRUCTIONS * 2 + 1];
+    int fixupTargets[BLOCK_MAX_INSTRUCTIONS * 2 + 1];
+    int fixupCount;
+    int compiled;                       /* Instructions of the block which are compiled */
+    CachedBlock* block;
+} Emitter;
+
+/* Helpers called by compiled code */
+
+static int jitEndInstruction(GB* gb, int cycles) {
+    /* Runs the remaining cycles of an instruction and handles interrupts like the
+     * interpreter does after every instruction, compiled code returns if this returns
+     * true. gb->PC is already the address of the next instruction */
+    JITState* jit = &gb->jit;
+    if (jit->sandboxed) {
+        jit->sandboxCycles += cycles;
+        return ++jit->sandboxInstructions >= jit->sandboxLimit || jit->uncomparable;
+    }
+
+    uint16_t pc = gb->PC;
+    for (int i = 0; i < cycles; i++) cyclesSync_4(gb);
+    endInstruction(gb);
+
+    /* An interrupt was dispatched, the emulator has to stop or a bank was switched */
+    return gb->PC != pc || gb->cpuEventPending || jit->exitBlock;
+}
+
+static inline bool isSandboxMemory(uint16_t address) {
+    /* Memory which doesnt depend on timing or have side effects, so the sandbox can
+     * read it ahead of the interpreter */
+    return (address >= WRAM_N0_4KB && address <= WRAM_NN_4KB_END) ||
+           (address >= HRAM_N0 && address <= HRAM_N0_END);
+}
+
+static uint8_t jitRead(GB* gb, uint16_t address, int cycles) {
+    /* Runs the cycles before the access, the rest run at the end of the instruction */
+    JITState* jit = &gb->jit;
+    if (jit->sandboxed) {
+        jit->sandboxCycles += cycles;
+        if (address > ROM_NN_16KB_END && !isSandboxMemory(address)) {
+            jit->uncomparable = true;
+            return 0xFF;
+        }
+
+        /* Writes arent done in the sandbox, the latest one to the address is read back */
+        for (int i = jit->sandboxWriteCount - 1; i >= 0; i--) {
+            if (jit->sandboxWrites[i].address == address) return jit->sandboxWrites[i].value;
+        }
+        return readAddr(gb, address);
+    }
+
+    for (int i = 0; i < cycles; i++) cyclesSync_4(gb);
+    syncHardwareForAccess(gb, address);
+    return readAddr(gb, address);
+}
+
+static void jitWrite(GB* gb, uint16_t address, uint8_t byte, int cycles) {
+    JITState* jit = &gb->jit;
+    if (jit->sandboxed) {
+        jit->sandboxCycles += cycles;
+        if (!isSandboxMemory(address) || jit->sandboxWriteCount == JIT_LOCKSTEP_MAX_WRITES) {
+            jit->uncomparable = true;
+            return;
+        }
+
+        jit->sandboxWrites[jit->sandboxWriteCount].address = address;
+        jit->sandboxWrites[jit->sandboxWriteCount].value = byte;
+        jit->sandboxWriteCount++;
+        return;
+    }
+
+    for (int i = 0; i < cycles; i++) cyclesSync_4(gb);
+    syncHardwareForAccess(gb, address);
+    writeAddr(gb, address, byte);
+
+    /* Writes to ROM go to the MBC, the rest of the block may not be mapped anymore */
+    if (address <= ROM_NN_16KB_END) jit->exitBlock = true;
+}
+
+/* x86-64 encoding */
+
+static inline void emit8(Emitter* e, uint8_t byte) {
+    *e->cursor++ = byte;
+}
+
+static inline void emit32(Emitter* e, uint32_t value) {
+    memcpy(e->cursor, &value, 4);
+    e->cursor += 4;
+}
+
+static inline void emit64(Emitter* e, uint64_t value) {
+    memcpy(e->cursor, &value, 8);
+    e->cursor += 8;
+}
+
+static void emitRex(Emitter* e, bool wide, int reg, int base, bool force) {
+    /* Byte sized operands always get a REX prefix so spl bpl sil and dil can be used
+     * instead of ah ch dh and bh */
+    uint8_t rex = 0x40 | (wide << 3) | ((reg >= 8) << 2) | (base >= 8);
+    if (rex != 0x40 || force) emit8(e, rex);
+}
+
+static void emitOpRR(Emitter* e, uint8_t op, int dst, int src, bool byteSized) {
+    /* op dst, src with a register destination, op is the 32 bit form (mov 0x89, add 0x01 ...),
+     * byte sized forms are one less */
+    emitRex(e, false, src, dst, byteSized);
+    emit8(e, byteSized ? op - 1 : op);
+    emit8(e, 0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+static void emitOpRI(Emitter* e, int digit, int dst, uint32_t imm, bool byteSized) {
+    /* Group 1 with an immediate, digit is add 0, or 1, adc 2, sbb 3, and 4, sub 5, xor 6, cmp 7 */
+    emitRex(e, false, 0, dst, byteSized);
+    emit8(e, byteSized ? 0x80 : 0x81);
+    emit8(e, 0xC0 | (digit << 3) | (dst & 7));
+    if (byteSized) emit8(e, imm);
+    else emit32(e, imm);
+}
+
+static void emitShiftRI(Emitter* e, int digit, int dst, uint8_t count, bool byteSized) {
+    /* Group 2, digit is rol 0, ror 1, rcl 2, rcr 3, shl 4, shr 5, sar 7 */
+    emitRex(e, false, 0, dst, byteSized);
+    emit8(e, byteSized ? 0xC0 : 0xC1);
+    emit8(e, 0xC0 | (digit << 3) | (dst & 7));
+    emit8(e, count);
+}
+
+static void emitMovRI(Emitter* e, int dst, uint32_t imm) {
+    emitRex(e, false, 0, dst, false);
+    emit8(e, 0xB8 + (dst & 7));
+    emit32(e, imm);
+}
+
+static void emitMovzx8(Emitter* e, int dst, int src) {
+    /* movzx dst32, src8 */
+    emitRex(e, false, dst, src, true);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+static void emitTestRI(Emitter* e, int reg, uint32_t imm) {
+    emitRex(e, false, 0, reg, false);
+    emit8(e, 0xF7);
+    emit8(e, 0xC0 | (reg & 7));
+    emit32(e, imm);
+}
+
+static void emitSetcc(Emitter* e, uint8_t cc, int dst) {
+    emitRex(e, false, 0, dst, true);
+    emit8(e, 0x0F);
+    emit8(e, 0x90 + cc);
+    emit8(e, 0xC0 | (dst & 7));
+}
+
+static void emitLoadCarry(Emitter* e) {
+    /* bt r13d, 4 puts the carry flag in CF for adc sbb rcl and rcr */
+    emitRex(e, false, 0, HOST_F, false);
+    emit8(e, 0x0F);
+    emit8(e, 0xBA);
+    emit8(e, 0xC0 | (4 << 3) | (HOST_F & 7));
+    emit8(e, 4);
+}
+
+static void emitLoadGB8(Emitter* e, int dst, int32_t offset) {
+    /* movzx dst32, byte [rbx + offset] */
+    emitRex(e, false, dst, RBX, false);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0x80 | ((dst & 7) << 3) | RBX);
+    emit32(e, offset);
+}
+
+static void emitStoreGB8(Emitter* e, int32_t offset, int src) {
+    /* mov byte [rbx + offset], src8 */
+    emitRex(e, false, src, RBX, true);
+    emit8(e, 0x88);
+    emit8(e, 0x80 | ((src & 7) << 3) | RBX);
+    emit32(e, offset);
+}
+
+static void emitLoadGB16(Emitter* e, int dst, int32_t offset) {
+    /* movzx dst32, word [rbx + offset] */
+    emitRex(e, false, dst, RBX, false);
+    emit8(e, 0x0F);
+    emit8(e, 0xB7);
+    emit8(e, 0x80 | ((dst & 7) << 3) | RBX);
+    emit32(e, offset);
+}
+
+static void emitStoreGB16(Emitter* e, int32_t offset, int src) {
+    /* mov word [rbx + offset], src16 */
+    emit8(e, 0x66);
+    emitRex(e, false, src, RBX, false);
+    emit8(e, 0x89);
+    emit8(e, 0x80 | ((src & 7) << 3) | RBX);
+    emit32(e, offset);
+}
+
+static void emitStorePC(Emitter* e, uint16_t pc) {
+    /* mov word [rbx + PC], imm16 */
+    emit8(e, 0x66);
+    emit8(e, 0xC7);
+    emit8(e, 0x83);
+    emit32(e, offsetof(GB, PC));
+    emit8(e, pc & 0xFF);
+    emit8(e, pc >> 8);
+}
+
+static void emitFlagLookup(Emitter* e, int dst) {
+    /* Turns the host flags into SM83 flags, lahf puts SF ZF AF PF and CF in ah
+     *
+     * lahf, movzx edx, ah, movzx dst, byte [rbx + rdx + flagTable] */
+    emit8(e, 0x9F);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0xD4);
+
+    emitRex(e, false, dst, 0, false);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0x80 | ((dst & 7) << 3) | 4);
+    emit8(e, (RDX << 3) | RBX);
+    emit32(e, offsetof(GB, jit.flagTable));
+}
+
+static void emitCall(Emitter* e, void* function) {
+    /* mov rdi, rbx, mov rax, function, call rax */
+    emit8(e, 0x48);
+    emit8(e, 0x89);
+    emit8(e, 0xDF);
+    emit8(e, 0x48);
+    emit8(e, 0xB8);
+    emit64(e, (uint64_t)(uintptr_t)function);
+    emit8(e, 0xFF);
+    emit8(e, 0xD0);
+}
+
+static void emitJump(Emitter* e, int cc, int target) {
+    /* Jumps to the code of an instruction of the block, or leaves the block if it isnt
+     * compiled. cc is -1 for an unconditional jump */
+    if (cc < 0) {
+        emit8(e, 0xE9);
+    } else {
+        emit8(e, 0x0F);
+        emit8(e, 0x80 + cc);
+    }
+
+    if (target < 0 || target >= e->compiled) {
+        emit32(e, (uint32_t)(e->exitLabel - (e->cursor + 4)));
+        return;
+    }
+
+    e->fixupSites[e->fixupCount] = e->cursor;
+    e->fixupTargets[e->fixupCount++] = target;
+    emit32(e, 0);
+}
+
+static void emitEndInstruction(Emitter* e, uint16_t nextPC, int cycles) {
+    /* Every instruction stores the PC it continues at and runs its cycles, the block
+     * is left if the helper says so */
+    emitStorePC(e, nextPC);
+    emitMovRI(e, RSI, cycles);
+    emitCall(e, (void*)jitEndInstruction);
+    emit8(e, 0x85);                     /* test eax, eax */
+    emit8(e, 0xC0);
+    emitJump(e, CC_NZ, -1);
+}
+
+/* SM83 registers */
+
+static int getHostRegister(GP_REG r) {
+    switch (r) {
+        case R8_A: return HOST_A;
+        case R8_B: case R8_C: return HOST_BC;
+        case R8_D: case R8_E: return HOST_DE;
+        default: return HOST_HL;
+    }
+}
+
+static inline bool isHighByte(GP_REG r) {
+    return r == R8_B || r == R8_D || r == R8_H;
+}
+
+static void emitLoadR8(Emitter* e, int dst, GP_REG r) {
+    int host = getHostRegister(r);
+    if (r == R8_A) {
+        emitOpRR(e, 0x89, dst, host, false);
+    } else if (isHighByte(r)) {
+        emitOpRR(e, 0x89, dst, host, false);
+        emitShiftRI(e, 5, dst, 8, false);
+    } else {
+        emitMovzx8(e, dst, host);
+    }
+}
+
+static void emitStoreR8(Emitter* e, GP_REG r, int src) {
+    /* Only the low byte of src is used, src is overwritten for B D and H */
+    int host = getHostRegister(r);
+    if (r == R8_A) {
+        emitMovzx8(e, host, src);
+    } else if (isHighByte(r)) {
+        emitMovzx8(e, src, src);
+        emitShiftRI(e, 4, src, 8, false);
+        emitOpRI(e, 4, host, 0xFF, false);
+        emitOpRR(e, 0x09, host, src, false);
+    } else {
+        emitOpRR(e, 0x89, host, src, true);
+    }
+}
+
+static int getHostRegister16(uint8_t opcode) {
+    /* BC DE and HL in bits 4 and 5 of the opcode, SP isnt compiled */
+    switch ((opcode >> 4) & 3) {
+        case 0: return HOST_BC;
+        case 1: return HOST_DE;
+        default: return HOST_HL;
+    }
+}
+
+static const GP_REG operandRegisters[8] = {
+    R8_B, R8_C, R8_D, R8_E, R8_H, R8_L, GP_COUNT, R8_A
+};
+
+/* Opcodes */
+
+static bool isCompilable(const CachedInstruction* instruction) {
+    uint8_t opcode = instruction->opcode;
+    if (opcode == 0xCB) return (instruction->operands[0] & 7) != 6;
+    if (opcode >= 0x40 && opcode <= 0xBF) return opcode != 0x76;
+
+    switch (opcode) {
+        case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x05: case 0x06: case 0x07:
+        case 0x09: case 0x0A: case 0x0B: case 0x0C: case 0x0D: case 0x0E: case 0x0F:
+        case 0x11: case 0x12: case 0x13: case 0x14: case 0x15: case 0x16: case 0x17:
+        case 0x18: case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E: case 0x1F:
+        case 0x20: case 0x21: case 0x22: case 0x23: case 0x24: case 0x25: case 0x26:
+        case 0x28: case 0x29: case 0x2A: case 0x2B: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+        case 0x30: case 0x32: case 0x36: case 0x37:
+        case 0x38: case 0x3A: case 0x3C: case 0x3D: case 0x3E: case 0x3F:
+        case 0xC2: case 0xC3: case 0xC6: case 0xCA: case 0xCE:
+        case 0xD2: case 0xD6: case 0xDA: case 0xDE:
+        case 0xE0: case 0xE2: case 0xE6: case 0xEA: case 0xEE:
+        case 0xF0: case 0xF2: case 0xF6: case 0xFA: case 0xFE: return true;
+        default: return false;
+    }
+}
+
+static int findInstruction(Emitter* e, uint16_t address) {
+    for (int i = 0; i < e->compiled; i++) {
+        if (e->block->instructions[i].address == address) return i;
+    }
+    return -1;
+}
+
+static void emitALU(Emitter* e, int operation) {
+    /* A = A op cl, operation is bits 3-5 of the opcode (add adc sub sbc and xor or cp) */
+    static const uint8_t hostOps[8] = { 0x01, 0x11, 0x29, 0x19, 0x21, 0x31, 0x09, 0x39 };
+
+    emitOpRR(e, 0x89, RAX, HOST_A, false);
+    if (operation == 1 || operation == 3) emitLoadCarry(e);
+    emitOpRR(e, hostOps[operation], RAX, RCX, true);
+    emitFlagLookup(e, HOST_F);
+    if (operation != 7) emitMovzx8(e, HOST_A, RAX);
+
+    switch (operation) {
+        case 2: case 3: case 7: emitOpRI(e, 1, HOST_F, 0x40, false); break;     /* N */
+        case 4:
+            emitOpRI(e, 4, HOST_F, 0x80, false);
+            emitOpRI(e, 1, HOST_F, 0x20, false);
+            break;
+        case 5: case 6: emitOpRI(e, 4, HOST_F, 0x80, false); break;
+        default: break;
+    }
+}
+
+static void emitIncDec(Emitter* e, GP_REG r, bool decrement) {
+    /* Carry is kept */
+    emitLoadR8(e, RAX, r);
+    emitOpRI(e, decrement ? 5 : 0, RAX, 1, true);
+    emitFlagLookup(e, RCX);
+    emitStoreR8(e, r, RAX);
+    emitOpRI(e, 4, RCX, 0xA0, false);
+    if (decrement) emitOpRI(e, 1, RCX, 0x40, false);
+    emitOpRI(e, 4, HOST_F, 0x10, false);
+    emitOpRR(e, 0x09, HOST_F, RCX, false);
+}
+
+static void emitRotate(Emitter* e, GP_REG r, int kind, bool setZFlag) {
+    /* kind is bits 3-5 of the CB opcode, rlc rrc rl rr sla sra swap srl */
+    static const int hostShifts[8] = { 0, 1, 2, 3, 4, 7, 0, 5 };
+
+    emitLoadR8(e, RAX, r);
+    if (kind == 2 || kind == 3) emitLoadCarry(e);
+    emitShiftRI(e, hostShifts[kind], RAX, kind == 6 ? 4 : 1, true);
+    emitSetcc(e, CC_C, RDX);
+
+    /* Rotates dont set ZF, the result is tested */
+    emitOpRR(e, 0x85, RAX, RAX, true);
+    emitSetcc(e, CC_Z, RCX);
+    emitStoreR8(e, r, RAX);
+
+    if (kind == 6) {
+        emitMovzx8(e, HOST_F, RCX);
+        emitShiftRI(e, 4, HOST_F, 7, false);
+        return;
+    }
+
+    emitMovzx8(e, HOST_F, RDX);
+    emitShiftRI(e, 4, HOST_F, 4, false);
+    if (setZFlag) {
+        emitMovzx8(e, RCX, RCX);
+        emitShiftRI(e, 4, RCX, 7, false);
+        emitOpRR(e, 0x09, HOST_F, RCX, false);
+    }
+}
+
+static void emitCB(Emitter* e, uint8_t cbOpcode) {
+    GP_REG r = operandRegisters[cbOpcode & 7];
+    int bit = (cbOpcode >> 3) & 7;
+    int host = getHostRegister(r);
+    uint32_t mask = (1u << bit) << (isHighByte(r) ? 8 : 0);
+
+    switch (cbOpcode >> 6) {
+        case 0: emitRotate(e, r, bit, true); break;
+        case 1:
+            /* BIT, Z is set if the bit is 0, H is set and C is kept */
+            emitTestRI(e, host, mask);
+            emitSetcc(e, CC_Z, RCX);
+            emitMovzx8(e, RCX, RCX);
+            emitShiftRI(e, 4, RCX, 7, false);
+            emitOpRI(e, 4, HOST_F, 0x10, false);
+            emitOpRI(e, 1, HOST_F, 0x20, false);
+            emitOpRR(e, 0x09, HOST_F, RCX, false);
+            break;
+        case 2: emitOpRI(e, 4, host, ~mask, false); break;
+        case 3: emitOpRI(e, 1, host, mask, false); break;
+    }
+}
+
+static void emitAddHL(Emitter* e, int source) {
+    /* H is the carry out of bit 11, C out of bit 15 and Z is kept */
+    emitOpRR(e, 0x89, RAX, HOST_HL, false);
+    emitOpRR(e, 0x89, RCX, source, false);
+    emitOpRR(e, 0x89, RDX, RAX, false);
+    emitOpRI(e, 4, RDX, 0xFFF, false);
+    emitOpRR(e, 0x89, RSI, RCX, false);
+    emitOpRI(e, 4, RSI, 0xFFF, false);
+    emitOpRR(e, 0x01, RDX, RSI, false);
+    emitShiftRI(e, 5, RDX, 12, false);
+    emitOpRR(e, 0x01, RAX, RCX, false);
+    emitOpRR(e, 0x89, RCX, RAX, false);
+    emitShiftRI(e, 5, RCX, 16, false);
+    emitOpRI(e, 4, RAX, 0xFFFF, false);
+    emitOpRR(e, 0x89, HOST_HL, RAX, false);
+
+    emitOpRI(e, 4, HOST_F, 0x80, false);
+    emitShiftRI(e, 4, RDX, 5, false);
+    emitOpRR(e, 0x09, HOST_F, RDX, false);
+    emitShiftRI(e, 4, RCX, 4, false);
+    emitOpRR(e, 0x09, HOST_F, RCX, false);
+}
+
+static void emitStepHL(Emitter* e, bool decrement) {
+    emitOpRI(e, decrement ? 5 : 0, HOST_HL, 1, false);
+    emitOpRI(e, 4, HOST_HL, 0xFFFF, false);
+}
+
+static void emitRead(Emitter* e, int cycles) {
+    /* Address is in esi, the byte ends up in eax */
+    emitMovRI(e, RDX, cycles);
+    emitCall(e, (void*)jitRead);
+    emitMovzx8(e, RAX, RAX);
+}
+
+static void emitWrite(Emitter* e, int cycles) {
+    /* Address is in esi and the byte in edx */
+    emitMovRI(e, RCX, cycles);
+    emitCall(e, (void*)jitWrite);
+}
+
+static void emitPortAddress(Emitter* e, const CachedInstruction* instruction) {
+    /* 0xFF00 + d8 or 0xFF00 + C */
+    if (instruction->opcode == 0xE0 || instruction->opcode == 0xF0) {
+        emitMovRI(e, RSI, 0xFF00 + instruction->operands[0]);
+    } else {
+        emitMovzx8(e, RSI, HOST_BC);
+        emitOpRI(e, 1, RSI, 0xFF00, false);
+    }
+}
+
+static void emitBranch(Emitter* e, const CachedInstruction* instruction, int index) {
+    uint8_t opcode = instruction->opcode;
+    bool relative = opcode < 0x40;
+    uint16_t nextPC = instruction->address + instruction->length;
+    uint16_t target = relative ? nextPC + (int8_t)instruction->operands[0] :
+                                 instruction->operands[0] | (instruction->operands[1] << 8);
+    int takenCycles = relative ? 3 : 4;
+
+    if (opcode != 0x18 && opcode != 0xC3) {
+        /* Conditions are NZ Z NC C in bits 3 and 4 */
+        int condition = (opcode >> 3) & 3;
+        uint8_t* skip;
+
+        emitTestRI(e, HOST_F, condition < 2 ? 0x80 : 0x10);
+        /* Jump over the taken path if the condition is false */
+        emit8(e, 0x0F);
+        emit8(e, 0x80 + ((condition & 1) ? CC_Z : CC_NZ));
+        skip = e->cursor;
+        emit32(e, 0);
+
+        emitEndInstruction(e, target, takenCycles);
+        emitJump(e, -1, findInstruction(e, target));
+
+        uint32_t distance = (uint32_t)(e->cursor - (skip + 4));
+        memcpy(skip, &distance, 4);
+        emitEndInstruction(e, nextPC, takenCycles - 1);
+        emitJump(e, -1, index + 1);
+        return;
+    }
+
+    emitEndInstruction(e, target, takenCycles);
+    emitJump(e, -1, findInstruction(e, target));
+}
+
+static void emitInstruction(Emitter* e, const CachedInstruction* instruction, int index) {
+    uint8_t opcode = instruction->opcode;
+    uint8_t d8 = instruction->operands[0];
+    uint16_t d16 = instruction->operands[0] | (instruction->operands[1] << 8);
+    uint16_t nextPC = instruction->address + instruction->length;
+    int cycles = instruction->cycles;
+    /* Memory accesses happen after the fetch cycles, the last cycle runs at the end */
+    int preCycles = instruction->length;
+
+    if (opcode >= 0x40 && opcode <= 0x7F) {
+        GP_REG dst = operandRegisters[(opcode >> 3) & 7];
+        GP_REG src = operandRegisters[opcode & 7];
+
+        if (src == GP_COUNT) {
+            emitOpRR(e, 0x89, RSI, HOST_HL, false);
+            emitRead(e, preCycles);
+            emitStoreR8(e, dst, RAX);
+            cycles -= preCycles;
+        } else if (dst == GP_COUNT) {
+            emitOpRR(e, 0x89, RSI, HOST_HL, false);
+            emitLoadR8(e, RDX, src);
+            emitWrite(e, preCycles);
+            cycles -= preCycles;
+        } else {
+            emitLoadR8(e, RAX, src);
+            emitStoreR8(e, dst, RAX);
+        }
+    } else if (opcode >= 0x80 && opcode <= 0xBF) {
+        GP_REG src = operandRegisters[opcode & 7];
+        if (src == GP_COUNT) {
+            emitOpRR(e, 0x89, RSI, HOST_HL, false);
+            emitRead(e, preCycles);
+            emitOpRR(e, 0x89, RCX, RAX, false);
+            cycles -= preCycles;
+        } else {
+            emitLoadR8(e, RCX, src);
+        }
+        emitALU(e, (opcode >> 3) & 7);
+    } else if (opcode == 0xCB) {
+        emitCB(e, d8);
+    } else if ((opcode & 0xC7) == 0xC6) {
+        emitMovRI(e, RCX, d8);
+        emitALU(e, (opcode >> 3) & 7);
+    } else if (opcode < 0x40 && (opcode & 7) >= 4 && (opcode & 7) <= 6 && opcode != 0x36) {
+        /* INC r, DEC r and LD r, d8 */
+        GP_REG r = operandRegisters[(opcode >> 3) & 7];
+        if ((opcode & 7) == 6) {
+            emitMovRI(e, RAX, d8);
+            emitStoreR8(e, r, RAX);
+        } else {
+            emitIncDec(e, r, (opcode & 7) == 5);
+        }
+    } else {
+        switch (opcode) {
+            case 0x00: break;
+            case 0x01: case 0x11: case 0x21: emitMovRI(e, getHostRegister16(opcode), d16); break;
+            case 0x03: case 0x13: case 0x23:
+            case 0x0B: case 0x1B: case 0x2B: {
+                int host = getHostRegister16(opcode);
+                emitOpRI(e, (opcode & 8) ? 5 : 0, host, 1, false);
+                emitOpRI(e, 4, host, 0xFFFF, false);
+                break;
+            }
+            case 0x09: case 0x19: case 0x29: emitAddHL(e, getHostRegister16(opcode)); break;
+            case 0x07: case 0x0F: case 0x17: case 0x1F:
+                /* RLCA RRCA RLA and RRA always clear Z */
+                emitRotate(e, R8_A, opcode >> 3, false);
+                break;
+            case 0x2F:
+                emitOpRI(e, 6, HOST_A, 0xFF, false);
+                emitOpRI(e, 1, HOST_F, 0x60, false);
+                break;
+            case 0x37:
+                emitOpRI(e, 4, HOST_F, 0x80, false);
+                emitOpRI(e, 1, HOST_F, 0x10, false);
+                break;
+            case 0x3F:
+                emitOpRI(e, 4, HOST_F, 0x90, false);
+                emitOpRI(e, 6, HOST_F, 0x10, false);
+                break;
+
+            case 0x0A: case 0x1A:
+                emitOpRR(e, 0x89, RSI, getHostRegister16(opcode), false);
+                emitRead(e, preCycles);
+                emitMovzx8(e, HOST_A, RAX);
+                cycles -= preCycles;
+                break;
+            case 0x2A: case 0x3A:
+                emitOpRR(e, 0x89, RSI, HOST_HL, false);
+                emitRead(e, preCycles);
+                emitMovzx8(e, HOST_A, RAX);
+                emitStepHL(e, opcode == 0x3A);
+                cycles -= preCycles;
+                break;
+            case 0xF0: case 0xF2:
+                emitPortAddress(e, instruction);
+                emitRead(e, preCycles);
+                emitMovzx8(e, HOST_A, RAX);
+                cycles -= preCycles;
+                break;
+            case 0xFA:
+                emitMovRI(e, RSI, d16);
+                emitRead(e, preCycles);
+                emitMovzx8(e, HOST_A, RAX);
+                cycles -= preCycles;
+                break;
+
+            case 0x02: case 0x12:
+                emitOpRR(e, 0x89, RSI, getHostRegister16(opcode), false);
+                emitOpRR(e, 0x89, RDX, HOST_A, false);
+                emitWrite(e, preCycles);
+                cycles -= preCycles;
+                break;
+            case 0x22: case 0x32:
+                emitOpRR(e, 0x89, RSI, HOST_HL, false);
+                emitOpRR(e, 0x89, RDX, HOST_A, false);
+                emitWrite(e, preCycles);
+                emitStepHL(e, opcode == 0x32);
+                cycles -= preCycles;
+                break;
+            case 0x36:
+                emitOpRR(e, 0x89, RSI, HOST_HL, false);
+                emitMovRI(e, RDX, d8);
+                emitWrite(e, preCycles);
+                cycles -= preCycles;
+                break;
+            case 0xE0: case 0xE2:
+                emitPortAddress(e, instruction);
+                emitOpRR(e, 0x89, RDX, HOST_A, false);
+                emitWrite(e, preCycles);
+                cycles -= preCycles;
+                break;
+            case 0xEA:
+                emitMovRI(e, RSI, d16);
+                emitOpRR(e, 0x89, RDX, HOST_A, false);
+                emitWrite(e, preCycles);
+                cycles -= preCycles;
+                break;
+
+            default:
+                emitBranch(e, instruction, index);
+                return;
+        }
+    }
+
+    emitEndInstruction(e, nextPC, cycles);
+}
+
+static bool protectCode(GB* gb, bool writable) {
+    /* The buffer is never writable and executable at the same time, it is only writable
+     * while a block is emitted */
+    int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC;
+    if (mprotect(gb->jit.code, JIT_CODE_BUFFER_SIZE, protection) != 0) {
+        log_warning(gb, "Could not change the protection of the JIT code buffer");
+        return false;
+    }
+
+    return true;
+}
+
+static bool compileBlock(GB* gb, CachedBlock* block) {
+    JITState* jit = &gb->jit;
+    Emitter e;
+    e.block = block;
+    e.fixupCount = 0;
+    e.compiled = 0;
+
+    /* Only the instructions up to the first one which cant be compiled, the interpreter
+     * continues from there */
+    while (e.compiled < block->count && isCompilable(&block->instructions[e.compiled])) e.compiled++;
+    if (e.compiled == 0) return false;
+
+    if (JIT_CODE_BUFFER_SIZE - jit->codeUsed < JIT_MAX_BLOCK_CODE) {
+        /* Out of space, everything is compiled again when it gets hot */
+        for (int i = 0; i < BLOCK_CACHE_SIZE; i++) gb->blockCache.blocks[i].jitCode = NULL;
+        jit->codeUsed = 0;
+        jit->flushes++;
+    }
+
+    if (!protectCode(gb, true)) return false;
+
+    uint8_t* start = jit->code + jit->codeUsed;
+    e.cursor = start;
+
+    /* Prologue, push rbx rbp r12 r13 r14 r15 and keep the stack aligned for calls */
+    emit8(&e, 0x53);
+    emit8(&e, 0x55);
+    emit8(&e, 0x41); emit8(&e, 0x54);
+    emit8(&e, 0x41); emit8(&e, 0x55);
+    emit8(&e, 0x41); emit8(&e, 0x56);
+    emit8(&e, 0x41); emit8(&e, 0x57);
+    emit8(&e, 0x48); emit8(&e, 0x83); emit8(&e, 0xEC); emit8(&e, 0x08);
+    emit8(&e, 0x48); emit8(&e, 0x89); emit8(&e, 0xFB);  /* mov rbx, rdi */
+
+    int32_t gpr = offsetof(GB, GPR);
+    int32_t gpr16 = offsetof(GB, GPR16);
+    emitLoadGB8(&e, HOST_A, gpr + R8_A);
+    emitLoadGB8(&e, HOST_F, gpr + R8_F);
+    emitLoadGB16(&e, HOST_BC, gpr16 + R16_BC * 2);
+    emitLoadGB16(&e, HOST_DE, gpr16 + R16_DE * 2);
+    emitLoadGB16(&e, HOST_HL, gpr16 + R16_HL * 2);
+
+    /* jmp over the exit to the first instruction */
+    emit8(&e, 0xE9);
+    uint8_t* skipExit = e.cursor;
+    emit32(&e, 0);
+
+    /* Exit, the registers are written back and the pushes undone */
+    e.exitLabel = e.cursor;
+    emitStoreGB8(&e, gpr + R8_A, HOST_A);
+    emitStoreGB8(&e, gpr + R8_F, HOST_F);
+    emitStoreGB16(&e, gpr16 + R16_BC * 2, HOST_BC);
+    emitStoreGB16(&e, gpr16 + R16_DE * 2, HOST_DE);
+    emitStoreGB16(&e, gpr16 + R16_HL * 2, HOST_HL);
+    emit8(&e, 0x48); emit8(&e, 0x83); emit8(&e, 0xC4); emit8(&e, 0x08);
+    emit8(&e, 0x41); emit8(&e, 0x5F);
+    emit8(&e, 0x41); emit8(&e, 0x5E);
+    emit8(&e, 0x41); emit8(&e, 0x5D);
+    emit8(&e, 0x41); emit8(&e, 0x5C);
+    emit8(&e, 0x5D);
+    emit8(&e, 0x5B);
+    emit8(&e, 0xC3);
+
+    uint32_t distance = (uint32_t)(e.cursor - (skipExit + 4));
+    memcpy(skipExit, &distance, 4);
+
+    for (int i = 0; i < e.compiled; i++) {
+        e.labels[i] = e.cursor;
+        emitInstruction(&e, &block->instructions[i], i);
+    }
+    /* The PC was stored by the last instruction */
+    emitJump(&e, -1, -1);
+
+    for (int i = 0; i < e.fixupCount; i++) {
+        uint8_t* site = e.fixupSites[i];
+        distance = (uint32_t)(e.labels[e.fixupTargets[i]] - (site + 4));
+        memcpy(site, &distance, 4);
+    }
+
+    /* The emitted code still takes up its space, it is only not run */
+    jit->codeUsed += e.cursor - start;
+    if (!protectCode(gb, false)) return false;
+
+    block->jitCode = start;
+    jit->blocksCompiled++;
+    return true;
+}
+
+static bool runLockstep(GB* gb, CachedBlock* block) {
+    /* Runs the block in the sandbox, then the same number of instructions in the
+     * interpreter and compares what both did. The interpreter's result is kept */
+    JITState* jit = &gb->jit;
+    uint32_t key = block->key;
+    uint16_t startPC = gb->PC;
+    uint8_t startGPR[GP_COUNT];
+    memcpy(startGPR, gb->GPR, GP_COUNT);
+
+    jit->sandboxed = true;
+    jit->uncomparable = false;
+    jit->sandboxInstructions = 0;
+    jit->sandboxLimit = JIT_LOCKSTEP_MAX_INSTRUCTIONS;
+    jit->sandboxCycles = 0;
+    jit->sandboxWriteCount = 0;
+    jit->exitBlock = false;
+    ((JITBlockFunction)block->jitCode)(gb);
+    jit->sandboxed = false;
+
+    uint8_t jitGPR[GP_COUNT];
+    uint16_t jitPC = gb->PC;
+    memcpy(jitGPR, gb->GPR, GP_COUNT);
+    memcpy(gb->GPR, startGPR, GP_COUNT);
+    gb->PC = startPC;
+
+    /* The memory the sandbox could write, as it should be after the block */
+    uint8_t expectedWRAM[0x2000];
+    uint8_t expectedHRAM[0x7F];
+    uint8_t* wramNN = &gb->wram[gb->selectedWRAMBank * 0x1000];
+    memcpy(expectedWRAM, gb->wram, 0x1000);
+    memcpy(expectedWRAM + 0x1000, wramNN, 0x1000);
+    memcpy(expectedHRAM, gb->hram, sizeof(expectedHRAM));
+    for (int i = 0; i < jit->sandboxWriteCount; i++) {
+        uint16_t address = jit->sandboxWrites[i].address;
+        if (address >= HRAM_N0) expectedHRAM[address - HRAM_N0] = jit->sandboxWrites[i].value;
+        else expectedWRAM[address - WRAM_N0_4KB] = jit->sandboxWrites[i].value;
+    }
+
+    unsigned long startClock = gb->clock;
+    uint64_t startInterrupts = gb->interruptsDispatched;
+    bool stopped = false;
+
+    jit->busy = true;
+    for (int i = 0; i < jit->sandboxInstructions && !stopped; i++) stopped = !stepInstruction(gb);
+    jit->busy = false;
+    syncFlags(gb);
+
+    /* Interrupts and memory with side effects make the runs differ for good reasons */
+    if (stopped || jit->uncomparable || gb->interruptsDispatched != startInterrupts) return true;
+    jit->lockstepChecks++;
+
+    bool registersMatch = memcmp(jitGPR, gb->GPR, GP_COUNT) == 0 && jitPC == gb->PC;
+    bool cyclesMatch = gb->clock - startClock == jit->sandboxCycles * 4;
+    bool memoryMatches = memcmp(expectedWRAM, gb->wram, 0x1000) == 0 &&
+                         memcmp(expectedWRAM + 0x1000, wramNN, 0x1000) == 0 &&
+                         memcmp(expectedHRAM, gb->hram, sizeof(expectedHRAM)) == 0;
+    if (registersMatch && cyclesMatch && memoryMatches) return true;
+
+    jit->lockstepMismatches++;
+    printf("[JIT] Mismatch in block at 0x%04x (ROM offset 0x%x) after %d instructions\n",
+            startPC, key, jit->sandboxInstructions);
+    printf("[JIT]   JIT         : A %02x F %02x B %02x C %02x D %02x E %02x H %02x L %02x PC %04x, %llu cycles\n",
+            jitGPR[R8_A], jitGPR[R8_F], jitGPR[R8_B], jitGPR[R8_C], jitGPR[R8_D], jitGPR[R8_E],
+            jitGPR[R8_H], jitGPR[R8_L], jitPC, (unsigned long long)jit->sandboxCycles);
+    printf("[JIT]   Interpreter : A %02x F %02x B %02x C %02x D %02x E %02x H %02x L %02x PC %04x, %lu cycles\n",
+            gb->GPR[R8_A], gb->GPR[R8_F], gb->GPR[R8_B], gb->GPR[R8_C], gb->GPR[R8_D], gb->GPR[R8_E],
+            gb->GPR[R8_H], gb->GPR[R8_L], gb->PC, (gb->clock - startClock) / 4);
+    if (!memoryMatches) printf("[JIT]   Memory writes differ\n");
+
+    /* The interpreter may have replaced the block while running */
+    if (block->valid && block->key == key) {
+        block->jitCode = NULL;
+        block->jitFailed = true;
+    }
+    return true;
+}
+
+void jit_init(GB* gb) {
+    JITState* jit = &gb->jit;
+    memset(jit, 0, sizeof(JITState));
+
+    for (int i = 0; i < 256; i++) {
+        /* ZF is bit 6, AF bit 4 and CF bit 0 of ah after lahf */
+        jit->flagTable[i] = (((i >> 6) & 1) << 7) | (((i >> 4) & 1) << 5) | ((i & 1) << 4);
+    }
+
+    /* Mapped executable once the first block is emitted, see protectCode */
+    void* code = mmap(NULL, JIT_CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        log_warning(gb, "Could not allocate the JIT code buffer, the JIT is disabled");
+        return;
+    }
+
+    jit->code = (uint8_t*)code;
+}
+
+void jit_free(GB* gb) {
+    if (gb->jit.code != NULL) munmap(gb->jit.code, JIT_CODE_BUFFER_SIZE);
+    gb->jit.code = NULL;
+}
+
+bool jit_run(GB* gb, CachedBlock* block) {
+    JITState* jit = &gb->jit;
+    if (jit->code == NULL || jit->busy || block->jitFailed || (block->key & BLOCK_KEY_RAM)) return false;
+
+    if (block->jitCode == NULL) {
+        /* Code in RAM can change, only ROM is compiled */
+        if (++block->executions < JIT_HOT_THRESHOLD) return false;
+        if (!compileBlock(gb, block)) {
+            block->jitFailed = true;
+            return false;
+        }
+    }
+
+    jit->blocksRun++;
+    /* Compiled code keeps F in a register */
+    syncFlags(gb);
+    if (gb->settings.jitLockstep) return runLockstep(gb, block);
+
+    jit->exitBlock = false;
+    ((JITBlockFunction)block->jitCode)(gb);
+    return true;
+}
+
+#else
+
+void jit_init(GB* gb) {
+    memset(&gb->jit, 0, sizeof(JITState));
+}
+
+void jit_free(GB* gb) {}
+
+bool jit_run(GB* gb, CachedBlock* block) {
+    return false;
+}
+
+#endif
+
+void jit_printStats(GB* gb) {
+    JITState* jit = &gb->jit;
+    printf("JIT Blocks Compiled : %llu, Blocks Run : %llu, Flushes : %llu\n",
+            (unsigned long long)jit->blocksCompiled, (unsigned long long)jit->blocksRun,
+            (unsigned long long)jit->flushes);
+    if (jit->lockstepChecks > 0) {
+        printf("JIT Lockstep Checks : %llu, Mismatches : %llu\n",
+                (unsigned long long)jit->lockstepChecks, (unsigned long long)jit->lockstepMismatches);
+    }
+}
@@ -10,21 +10,87 @@
 #include <stdint.h>
 
 /* Bank Switching */
+static uint8_t* getROMBank(GB* gb, unsigned int bankNumber) {
+    /* Only as many bank bits as the ROM size needs are wired, the file can still be
+     * smaller than the header says. The header isnt verified, so its size code is limited
+     * to the largest valid one before it is used as a shift */
+    Cartridge* cartridge = gb->cartridge;
+    unsigned int fileBanks = cartridge->size / 0x4000;
+    unsigned int romSize = (unsigned int)cartridge->romSize;
+    if (romSize > ROM_8MB) romSize = ROM_8MB;
+
+    bankNumber &= (2u << romSize) - 1;
+    if (bankNumber >= fileBanks) bankNumber %= fileBanks;
+
+    return &cartridge->allocated[bankNumber * 0x4000];    /* Size of each bank is 16 KiB */
+}
+
 void switchROMBank(GB* gb, int bankNumber) {
     /* This function only does the switching part, the checking
      * and decoding is done by MBCs separately */
-
-    uint8_t* allocated = gb->cartridge->allocated;
-    uint8_t* bank = &allocated[bankNumber * 0x4000];    /* Size of each bank is 16 KiB */
+    gb->romNNBank = getROMBank(gb, bankNumber);
 
 #ifdef DEBUG_LOGGING
     printf("MBC : Switched ROM Bank to 0x%x\n", bankNumber);
 #endif
 }
 
+void switchRestrictedROMBank(GB* gb, int bankNumber) {
+    gb->rom0Bank = getROMBank(gb, bankNumber);
+}
+
+void switchRAMBank(GB* gb, uint8_t* ramBanks, int bankNumber) {
+    if (ramBanks == NULL) {
+        gb->externalRAMBank = NULL;
+        return;
+    }
+
+    int banks;
+    switch (gb->cartridge->extRamSize) {
+        case EXT_RAM_32KB: banks = 4; break;
+        case EXT_RAM_64KB: banks = 8; break;
+        case EXT_RAM_128KB: banks = 16; break;
+        default: banks = 1; break;
+    }
+
+    gb->externalRAMBank = &ramBanks[(bankNumber % banks) * 0x2000];
+}
+
+/* Cartridges without an MBC only have 32 KiB of ROM */
+static void noneFree(GB* gb) {
+    (void)gb;
+}
+
+static void noneWriteExternalRAM(GB* gb, uint16_t addr, uint8_t byte) {
+    (void)addr;
+    (void)byte;
+    log_warning(gb, "Attempt to write to external RAM without MBC");
+}
+
+static uint8_t noneReadExternalRAM(GB* gb, uint16_t addr) {
+    (void)addr;
+    log_warning(gb, "Attempt to read from external RAM without MBC");
+    return 0xFF;
+}
+
+static void noneInterceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
+    (void)addr;
+    (void)byte;
+    log_warning(gb, "No MBC exists and write to ROM address doesn't make sense");
+}
+
+static const MBCInterface noneInterface = {
+    noneFree, noneWriteExternalRAM, noneReadExternalRAM, noneInterceptROMWrite
+};
+
 void mbc_allocate(GB* gb) {
     /* Detect the correct MBC that needs to be used and allocate it */
     CARTRIDGE_TYPE type = gb->cartridge->cType;
+    gb->memControllerInterface = &noneInterface;
+    switchRestrictedROMBank(gb, 0);
+    switchROMBank(gb, 1);
+    switchRAMBank(gb, NULL, 0);
+
     switch (type) {
         case CARTRIDGE_NONE: break;         /* No MBC */
 
@@ -38,8 +104,8 @@ void mbc_allocate(GB* gb) {
 		case CARTRIDGE_MBC3:	mbc3_allocate(gb, false, false); break;
 		case CARTRIDGE_MBC3_RAM:
 		case CARTRIDGE_MBC3_RAM_BATTERY:	mbc3_allocate(gb, true, false); break;
-		case CARTRIDGE_MBC3_TIMER_BATTERY:  mbc3_allocate(gb, false, false); break;
-		case CARTRIDGE_MBC3_TIMER_RAM_BATTERY:	mbc3_allocate(gb, true, false); break;
+		case CARTRIDGE_MBC3_TIMER_BATTERY:  mbc3_allocate(gb, false, true); break;
+		case CARTRIDGE_MBC3_TIMER_RAM_BATTERY:	mbc3_allocate(gb, true, true); break;
 
 		case CARTRIDGE_MBC5:
 		case CARTRIDGE_MBC5_RUMBLE:		mbc5_allocate(gb, false); break;
@@ -53,72 +119,29 @@ void mbc_allocate(GB* gb) {
 }
 
 void mbc_free(GB* gb) {
-    switch (gb->memControllerType) {
-        case MBC_NONE: break;
-        case MBC_TYPE_1: mbc1_free(gb); break;
-        // case MBC_TYPE_2: mbc2_free(gb); break;
-		case MBC_TYPE_3: mbc3_free(gb); break;
-		case MBC_TYPE_5: mbc5_free(gb); break;
-        default: break;
-    }
-}
-
-uint8_t mbc_readROM_N0(GB* gb, uint16_t addr) {
-    /* This is used only when an MBC has been identified */
-    switch (gb->memControllerType) {
-        case MBC_TYPE_1: return mbc1_readROM_N0(gb, addr);
-        // case MBC_TYPE_2: return mbc2_readROM(gb, addr);
-		case MBC_TYPE_3: return mbc3_readROM_N0(gb, addr);
-		case MBC_TYPE_5: return mbc5_readROM_N0(gb, addr);
-        default: return 0xFF;
-    }
-}
-
-uint8_t mbc_readROM_NN(GB* gb, uint16_t addr) {
-    switch (gb->memControllerType) {
-        case MBC_TYPE_1: return mbc1_readROM_NN(gb, addr);
-		case MBC_TYPE_3: return mbc3_readROM_NN(gb, addr);
-		case MBC_TYPE_5: return mbc5_readROM_NN(gb, addr);
-        default: return 0xFF;
-    }
+    /* The emulator can be stopped before the MBC is allocated */
+    if (gb->memControllerInterface == NULL) return;
+    gb->memControllerInterface->free(gb);
 }
 
 void mbc_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte) {
     /* The address has already been identified as an external ram address
      * so we dont have to check */
-    switch (gb->memControllerType) {
-        case MBC_NONE: log_warning(gb, "Attempt to write to external RAM without MBC"); break;
-        case MBC_TYPE_1: mbc1_writeExternalRAM(gb, addr, byte); break;
-//        case MBC_TYPE_2: mbc2_writeBuiltInRAM(gb, addr, byte); break;
-		case MBC_TYPE_3: mbc3_writeExternalRAM(gb, addr, byte); break;
-		case MBC_TYPE_5: mbc5_writeExternalRAM(gb, addr, byte); break;
-        default: break;
-    }
+    gb->memControllerInterface->writeExternalRAM(gb, addr, byte);
 }
 
 uint8_t mbc_readExternalRAM(GB* gb, uint16_t addr) {
-    switch (gb->memControllerType) {
-        case MBC_NONE: log_warning(gb, "Attempt to read from external RAM without MBC"); break;
-        case MBC_TYPE_1: return mbc1_readExternalRAM(gb, addr);
-//        case MBC_TYPE_2: return mbc2_readBuiltInRAM(gb, addr);
-		case MBC_TYPE_3: return mbc3_readExternalRAM(gb, addr);
-		case MBC_TYPE_5: return mbc5_readExternalRAM(gb, addr);
-        default: return 0xFF;
-    }
-
-    return 0xFF;
+    return gb->memControllerInterface->readExternalRAM(gb, addr);
 }
 
 void mbc_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
-    switch (gb->memControllerType) {
-        case MBC_NONE:
-            log_warning(gb, "No MBC exists and write to ROM address doesn't make sense"); break;
-
-        case MBC_TYPE_1: mbc1_interceptROMWrite(gb, addr, byte); break;
-//        case MBC_TYPE_2: mbc2_interceptROMWrite(gb, addr, byte); break;
-		case MBC_TYPE_3: mbc3_interceptROMWrite(gb, addr, byte); break;
-		case MBC_TYPE_5: mbc5_interceptROMWrite(gb, addr, byte); break;
-        default: break;
-    }
+    gb->memControllerInterface->interceptROMWrite(gb, addr, byte);
+}
+
+int mbc_getSelectedROM0Bank(GB* gb) {
+    return (gb->rom0Bank - gb->cartridge->allocated) / 0x4000;
+}
 
+int mbc_getSelectedROMBank(GB* gb) {
+    return (gb->romNNBank - gb->cartridge->allocated) / 0x4000;
 }
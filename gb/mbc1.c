@@ -25,8 +25,8 @@ void mbc1_allocate(GB* gb, bool externalRam) {
     if (externalRam) {
         switch (gb->cartridge->extRamSize) {
             case EXT_RAM_0: break;          /* Dont allocate */
-            case EXT_RAM_8KB: mbc->ramBanks = (uint8_t*)malloc(0x2000); break;  /* Allocate 1 bank */
-            case EXT_RAM_32KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 4); break;  /* 4 banks */
+            case EXT_RAM_8KB: mbc->ramBanks = save_allocate(gb, 0x2000, 0); break;  /* Allocate 1 bank */
+            case EXT_RAM_32KB: mbc->ramBanks = save_allocate(gb, 0x2000 * 4, 0); break;  /* 4 banks */
             default: log_fatal(gb, "External banks not supported with MBC1"); break;
         }
 
@@ -38,13 +38,14 @@ void mbc1_allocate(GB* gb, bool externalRam) {
 
     gb->memController = (void*)mbc;
     gb->memControllerType = MBC_TYPE_1;
+    gb->memControllerInterface = &mbc1_interface;
 }
 
 void mbc1_free(GB* gb) {
     MBC_1* mbc = (MBC_1*)gb->memController;
 
     if (mbc->ramBanks != NULL) {
-        free(mbc->ramBanks);
+        save_free(gb);
         mbc->ramBanks = NULL;
     }
 
@@ -122,24 +123,13 @@ static void syncMBC1(GB* gb, MBC_1* mbc) {
     }
 }
 
-uint8_t mbc1_readROM_N0(GB *gb, uint16_t addr) {
-    MBC_1* mbc = (MBC_1*)gb->memController;
-
-    return gb->cartridge->allocated[mbc->selectedROM0Bank * 0x4000 + addr];
-}
-
-uint8_t mbc1_readROM_NN(GB* gb, uint16_t addr) {
-    MBC_1* mbc = (MBC_1*)gb->memController;
-
-    return gb->cartridge->allocated[mbc->selectedROMBank * 0x4000 + addr];
-}
-
 void mbc1_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte) {
     MBC_1* mbc = (MBC_1*)gb->memController;
 
     if (!mbc->ramEnabled) return;
     if (mbc->ramBanks == NULL) return;
     mbc->ramBanks[(0x2000 * mbc->selectedRAMBank) + addr] = byte;
+    save_markDirty(&gb->save, (0x2000 * mbc->selectedRAMBank) + addr);
 }
 
 uint8_t mbc1_readExternalRAM(GB* gb, uint16_t addr) {
@@ -155,8 +145,9 @@ void mbc1_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
 
     /* Register writes */
     if (addr >= 0x0000 && addr <= 0x1FFF) {
-        /* RAM Enable/Disable */
+        /* RAM Enable/Disable, games disable RAM after saving */
         mbc->ramEnabled = (byte & 0xF) == 0xA;
+        if (!mbc->ramEnabled) save_requestFlush(gb);
     } else if (addr >= 0x2000 && addr <= 0x3FFF) {
         /* 5 bit register */
         mbc->romBankNumber = byte & 0x1F;
@@ -170,4 +161,13 @@ void mbc1_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
         mbc->bankMode = byte & 0x1;
         syncMBC1(gb, mbc);
     }
+
+    /* Map what the registers select now */
+    switchRestrictedROMBank(gb, mbc->selectedROM0Bank);
+    switchROMBank(gb, mbc->selectedROMBank);
+    switchRAMBank(gb, mbc->ramEnabled ? mbc->ramBanks : NULL, mbc->selectedRAMBank);
 }
+
+const MBCInterface mbc1_interface = {
+    mbc1_free, mbc1_writeExternalRAM, mbc1_readExternalRAM, mbc1_interceptROMWrite
+};
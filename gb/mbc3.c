@@ -3,6 +3,112 @@
 #include <gb/mbc3.h>
 #include <time.h>
 
+/* Bits of the RTC registers that exist */
+static const uint8_t rtcMasks[RTC_REGISTER_COUNT] = { 0x3F, 0x3F, 0x1F, 0xFF, 0xC1 };
+
+static void addRTCDays(uint8_t* rtc, uint64_t days) {
+    uint64_t counter = (((rtc[RTC_DAYS_HIGH] & 0x1) << 8) | rtc[RTC_DAYS_LOW]) + days;
+
+    /* The carry stays set until the game clears it */
+    if (counter > 0x1FF) rtc[RTC_DAYS_HIGH] |= 0x80;
+    counter &= 0x1FF;
+
+    rtc[RTC_DAYS_LOW] = counter & 0xFF;
+    rtc[RTC_DAYS_HIGH] = (rtc[RTC_DAYS_HIGH] & 0xFE) | (counter >> 8);
+}
+
+static void tickRTCSecond(uint8_t* rtc) {
+    /* Registers count up to their bit width, a value written out of range wraps to 0 without
+     * incrementing the next register */
+    rtc[RTC_SECONDS] = (rtc[RTC_SECONDS] + 1) & 0x3F;
+    if (rtc[RTC_SECONDS] != 60) return;
+    rtc[RTC_SECONDS] = 0;
+
+    rtc[RTC_MINUTES] = (rtc[RTC_MINUTES] + 1) & 0x3F;
+    if (rtc[RTC_MINUTES] != 60) return;
+    rtc[RTC_MINUTES] = 0;
+
+    rtc[RTC_HOURS] = (rtc[RTC_HOURS] + 1) & 0x1F;
+    if (rtc[RTC_HOURS] != 24) return;
+    rtc[RTC_HOURS] = 0;
+
+    addRTCDays(rtc, 1);
+}
+
+static void advanceRTC(uint8_t* rtc, uint64_t seconds) {
+    /* Out of range values are rare, they are ticked one second at a time until they wrap */
+    while (seconds > 0 && (rtc[RTC_SECONDS] >= 60 || rtc[RTC_MINUTES] >= 60 || rtc[RTC_HOURS] >= 24)) {
+        tickRTCSecond(rtc);
+        seconds--;
+    }
+
+    if (seconds == 0) return;
+
+    uint64_t time = rtc[RTC_SECONDS] + rtc[RTC_MINUTES] * 60 + rtc[RTC_HOURS] * 3600 + seconds;
+    rtc[RTC_SECONDS] = time % 60;
+    rtc[RTC_MINUTES] = (time / 60) % 60;
+    rtc[RTC_HOURS] = (time / 3600) % 24;
+    addRTCDays(rtc, time / 86400);
+}
+
+static void updateRTC(GB* gb, MBC_3* mbc) {
+    /* Adds the whole seconds elapsed since the last update, the rest is kept for the next one */
+    unsigned long now = getRealTimeCycles(gb);
+
+    if (mbc->rtc[RTC_DAYS_HIGH] & 0x40 || now < mbc->rtcBaseCycles) {
+        /* Halted, or the clock was put back without the registers, which then keep their
+         * time and count on from here */
+        mbc->rtcBaseCycles = now;
+        return;
+    }
+
+    unsigned long seconds = (now - mbc->rtcBaseCycles) / T_CYCLES_PER_SEC;
+    advanceRTC(mbc->rtc, seconds);
+    mbc->rtcBaseCycles += seconds * T_CYCLES_PER_SEC;
+}
+
+static void saveRTC(GB* gb, MBC_3* mbc) {
+    /* The save file couldnt be opened, the clock still runs for this session */
+    if (gb->save.data == NULL) return;
+
+    uint8_t* footer = gb->save.data + gb->save.size;
+    uint64_t now = (uint64_t)time(NULL);
+
+    updateRTC(gb, mbc);
+    memset(footer, 0, MBC3_RTC_FOOTER_SIZE);
+
+    for (int i = 0; i < RTC_REGISTER_COUNT; i++) {
+        footer[i * 4] = mbc->rtc[i];
+        footer[(RTC_REGISTER_COUNT + i) * 4] = mbc->rtcLatched[i];
+    }
+
+    for (int i = 0; i < 8; i++) footer[40 + i] = (now >> (i * 8)) & 0xFF;
+
+    save_markDirty(&gb->save, gb->save.size);
+    save_markDirty(&gb->save, gb->save.size + MBC3_RTC_FOOTER_SIZE - 1);
+}
+
+static void loadRTC(GB* gb, MBC_3* mbc) {
+    uint8_t* footer = gb->save.data + gb->save.size;
+    uint64_t savedAt = 0;
+
+    for (int i = 0; i < 8; i++) savedAt |= (uint64_t)footer[40 + i] << (i * 8);
+
+    for (int i = 0; i < RTC_REGISTER_COUNT; i++) {
+        /* A save without an RTC has a zeroed footer and starts at 0 */
+        mbc->rtc[i] = footer[i * 4] & rtcMasks[i];
+        mbc->rtcLatched[i] = footer[(RTC_REGISTER_COUNT + i) * 4] & rtcMasks[i];
+    }
+
+    mbc->rtcBaseCycles = getRealTimeCycles(gb);
+
+    /* The clock kept running while the emulator was closed */
+    uint64_t now = (uint64_t)time(NULL);
+    if (savedAt != 0 && now > savedAt && !(mbc->rtc[RTC_DAYS_HIGH] & 0x40)) {
+        advanceRTC(mbc->rtc, now - savedAt);
+    }
+}
+
 void mbc3_allocate(GB* gb, bool externalRam, bool rtc) {
     MBC_3* mbc = (MBC_3*)malloc(sizeof(MBC_3));
 
@@ -20,31 +126,41 @@ void mbc3_allocate(GB* gb, bool externalRam, bool rtc) {
     mbc->selectedROMBank = 1;
 
     mbc->ramBanks = NULL;
-    mbc->rtcSupported = false;
+    mbc->rtcSupported = rtc;
+    memset(mbc->rtc, 0, sizeof(mbc->rtc));
+    memset(mbc->rtcLatched, 0, sizeof(mbc->rtcLatched));
+    mbc->rtcBaseCycles = 0;
+
+    size_t ramSize = 0;
    
     if (externalRam) {
         switch (gb->cartridge->extRamSize) {
             case EXT_RAM_0: break;
-            case EXT_RAM_8KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 1); break;
-            case EXT_RAM_32KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 4); break;
+            case EXT_RAM_8KB: ramSize = 0x2000 * 1; break;
+            case EXT_RAM_32KB: ramSize = 0x2000 * 4; break;
             default: log_fatal(gb, "External RAM Banks not supported with MBC3\n");
         }
     }
 
-    if (rtc) {
-        /* The counting will happen when this flag is set */
-        mbc->rtcSupported = true;
+    if (ramSize != 0 || rtc) {
+        /* The RTC is saved after the RAM, even on cartridges that only have the RTC */
+        uint8_t* data = save_allocate(gb, ramSize, rtc ? MBC3_RTC_FOOTER_SIZE : 0);
+        if (ramSize != 0) mbc->ramBanks = data;
+        if (rtc && data != NULL) loadRTC(gb, mbc);
     }
 
     gb->memController = (void*)mbc;
     gb->memControllerType = MBC_TYPE_3;
+    gb->memControllerInterface = &mbc3_interface;
+    switchRAMBank(gb, mbc->ramBanks, 0);
 }
 
 void mbc3_free(GB* gb) {
     MBC_3* mbc = (MBC_3*)gb->memController;
 
-    if (mbc->ramBanks != NULL) {
-        free(mbc->ramBanks);
+    if (gb->save.data != NULL) {
+        if (mbc->rtcSupported) saveRTC(gb, mbc);
+        save_free(gb);
         mbc->ramBanks = NULL;
     }
 
@@ -62,6 +178,9 @@ void mbc3_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
         /* RAM and RTC reading and writing enable/disable */
         if ((byte & 0xF) == 0xA) mbc->ram_rtcEnabled = true;
         else mbc->ram_rtcEnabled = false;
+
+        /* Games disable RAM after saving */
+        if (!mbc->ram_rtcEnabled) save_requestFlush(gb);
     } else if (addr >= 0x2000 && addr <= 0x3FFF) {
 		/* Mask unused bits depending on rom size -> Supported upto 2 MB */
 		uint8_t bankNumber = byte & ((1 << (gb->cartridge->romSize + 1)) - 1);
@@ -85,12 +204,19 @@ void mbc3_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
 		/* All other writes are ignored and do nothing */
     } else if (addr >= 0x6000 && addr <= 0x7FFF) {
 		/* Used to latch time onto registers */
-		if (mbc->latchRegister == 0 && byte == 1) {
-			/* Latch */
+		if (mbc->latchRegister == 0 && byte == 1 && mbc->rtcSupported) {
+			/* The time is only calculated here, the game reads what was latched */
+			updateRTC(gb, mbc);
+			memcpy(mbc->rtcLatched, mbc->rtc, sizeof(mbc->rtc));
+			saveRTC(gb, mbc);
 		}
 
 		mbc->latchRegister = byte;
     }
+
+    /* Map what the registers select now, RTC registers go through the MBC */
+    switchROMBank(gb, mbc->selectedROMBank);
+    switchRAMBank(gb, mbc->ram_rtcBankNumber < 0x04 ? mbc->ramBanks : NULL, mbc->selectedRAMBank);
 }
 
 uint8_t mbc3_readExternalRAM(GB* gb, uint16_t addr) {
@@ -104,7 +230,7 @@ uint8_t mbc3_readExternalRAM(GB* gb, uint16_t addr) {
 	} else {
 		/* RTC */
 		if (!mbc->rtcSupported) return 0;
-		return 0;
+		return mbc->rtcLatched[mbc->selectedRTCRegister - 0x08];
 	}
 }
 
@@ -116,19 +242,23 @@ void mbc3_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte) {
 		if (mbc->ramBanks == NULL) return;
 
 		mbc->ramBanks[mbc->selectedRAMBank * 0x2000 + addr] = byte;
+		save_markDirty(&gb->save, mbc->selectedRAMBank * 0x2000 + addr);
 	} else {
 		/* RTC */
 		if (!mbc->rtcSupported) return;
 
-	}
-}
+		RTC_REGISTER reg = mbc->selectedRTCRegister - 0x08;
+		updateRTC(gb, mbc);
 
-uint8_t mbc3_readROM_N0(GB* gb, uint16_t addr) {
-	return gb->cartridge->allocated[addr];
-}
-
-uint8_t mbc3_readROM_NN(GB* gb, uint16_t addr) {
-	MBC_3* mbc = (MBC_3*)gb->memController;
+		/* Writing the seconds resets the part of the second counted so far */
+		if (reg == RTC_SECONDS) mbc->rtcBaseCycles = getRealTimeCycles(gb);
 
-    return gb->cartridge->allocated[mbc->selectedROMBank * 0x4000 + addr];
+		mbc->rtc[reg] = byte & rtcMasks[reg];
+		mbc->rtcLatched[reg] = mbc->rtc[reg];
+		saveRTC(gb, mbc);
+	}
 }
+
+const MBCInterface mbc3_interface = {
+    mbc3_free, mbc3_writeExternalRAM, mbc3_readExternalRAM, mbc3_interceptROMWrite
+};
@@ -20,9 +20,9 @@ void mbc5_allocate(GB* gb, bool externalRam) {
     if (externalRam) {
         switch (gb->cartridge->extRamSize) {
             case EXT_RAM_0: break;
-            case EXT_RAM_8KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 1); break;
-            case EXT_RAM_32KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 4); break;
-			case EXT_RAM_128KB: mbc->ramBanks = (uint8_t*)malloc(0x2000 * 16); break;
+            case EXT_RAM_8KB: mbc->ramBanks = save_allocate(gb, 0x2000 * 1, 0); break;
+            case EXT_RAM_32KB: mbc->ramBanks = save_allocate(gb, 0x2000 * 4, 0); break;
+			case EXT_RAM_128KB: mbc->ramBanks = save_allocate(gb, 0x2000 * 16, 0); break;
             default: log_fatal(gb, "External RAM Banks not supported with MBC5\n");
         }
     }
@@ -30,13 +30,14 @@ void mbc5_allocate(GB* gb, bool externalRam) {
 
     gb->memController = (void*)mbc;
     gb->memControllerType = MBC_TYPE_5;
+    gb->memControllerInterface = &mbc5_interface;
 }
 
 void mbc5_free(GB* gb) {
     MBC_5* mbc = (MBC_5*)gb->memController;
 
     if (mbc->ramBanks != NULL) {
-        free(mbc->ramBanks);
+        save_free(gb);
         mbc->ramBanks = NULL;
     }
 
@@ -54,14 +55,15 @@ void mbc5_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
         /* RAM reading and writing enable/disable */
         if ((byte & 0xF) == 0xA) mbc->ramEnabled = true;
         else mbc->ramEnabled = false;
+
+        /* Games disable RAM after saving */
+        if (!mbc->ramEnabled) save_requestFlush(gb);
     } else if (addr >= 0x2000 && addr <= 0x2FFF) {
-		/* Mask unused bits depending on rom size -> Supported upto 8 MB */
-		uint8_t bankNumber = byte & ((1 << (gb->cartridge->romSize + 1)) - 1);
-		mbc->selectedROMBank = bankNumber;
+		/* Lower 8 bits of ROM bank number, switchROMBank masks the bits the ROM doesnt use */
+		mbc->selectedROMBank = (mbc->selectedROMBank & 0x100) | byte;
     } else if (addr >= 0x3000 && addr <= 0x3FFF) {
 		/* 9th bit of ROM bank number */
-		if (gb->cartridge->romSize != ROM_8MB) return;
-		mbc->selectedROMBank |= (byte & 1) << 8;
+		mbc->selectedROMBank = (mbc->selectedROMBank & 0xFF) | ((byte & 1) << 8);
     } else if (addr >= 0x4000 && addr <= 0x5FFF) {
 		/* Selecting RAM Bank from 0x00-0x0F */
 		uint8_t mask = 0;
@@ -79,6 +81,10 @@ void mbc5_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte) {
 
 		mbc->selectedRAMBank = byte & mask;
     }
+
+    /* Map what the registers select now */
+    switchROMBank(gb, mbc->selectedROMBank);
+    switchRAMBank(gb, mbc->ramEnabled ? mbc->ramBanks : NULL, mbc->selectedRAMBank);
 }
 
 uint8_t mbc5_readExternalRAM(GB* gb, uint16_t addr) {
@@ -96,15 +102,10 @@ void mbc5_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte) {
 	if (mbc->ramEnabled && mbc->ramBanks != NULL) {
 		/* RAM */
 		mbc->ramBanks[mbc->selectedRAMBank * 0x2000 + addr] = byte;
+		save_markDirty(&gb->save, mbc->selectedRAMBank * 0x2000 + addr);
 	} else return;
 }
 
-uint8_t mbc5_readROM_N0(GB* gb, uint16_t addr) {
-	return gb->cartridge->allocated[addr];
-}
-
-uint8_t mbc5_readROM_NN(GB* gb, uint16_t addr) {
-	MBC_5* mbc = (MBC_5*)gb->memController;
-
-    return gb->cartridge->allocated[mbc->selectedROMBank * 0x4000 + addr];
-}
+const MBCInterface mbc5_interface = {
+    mbc5_free, mbc5_writeExternalRAM, mbc5_readExternalRAM, mbc5_interceptROMWrite
+};
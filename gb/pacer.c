@@ -0,0 +1,150 @@
+#include <gb/pacer.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Bounds for the spin part of a wait */
+#define PACER_MIN_SPIN_NS 100000
+#define PACER_MAX_SPIN_NS 2000000
+
+uint64_t pacer_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return ((uint64_t)t.tv_sec * 1000000000) + t.tv_nsec;
+}
+
+#ifdef __APPLE__
+static void sleepUntil(uint64_t time) {
+    /* No clock_nanosleep, sleep for what is left until the deadline again after a signal */
+    uint64_t now = pacer_now();
+    while (now < time) {
+        struct timespec t;
+        t.tv_sec = (time - now) / 1000000000;
+        t.tv_nsec = (time - now) % 1000000000;
+
+        if (nanosleep(&t, NULL) != 0 && errno != EINTR) {
+            printf("[WARNING] nanosleep failed: %s\n", strerror(errno));
+            return;
+        }
+        now = pacer_now();
+    }
+}
+#else
+static void sleepUntil(uint64_t time) {
+    struct timespec t;
+    t.tv_sec = time / 1000000000;
+    t.tv_nsec = time % 1000000000;
+
+    /* Absolute sleeps dont add up the error of early wakeups after a signal */
+    int error;
+    while ((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL)) == EINTR);
+
+    /* Anything else wont go away by retrying, the caller spins out the rest of the wait */
+    if (error != 0) printf("[WARNING] clock_nanosleep failed: %s\n", strerror(error));
+}
+#endif
+
+void pacer_sleep(uint64_t nanoseconds) {
+    sleepUntil(pacer_now() + nanoseconds);
+}
+
+static inline uint64_t cyclesToNanoseconds(FramePacer* pacer, uint64_t cycles) {
+    /* Whole seconds and the remainder are converted separately so this doesnt overflow */
+    return ((cycles / pacer->cyclesPerSecond) * 1000000000) +
+        (((cycles % pacer->cyclesPerSecond) * 1000000000) / pacer->cyclesPerSecond);
+}
+
+static inline uint64_t getDeadline(FramePacer* pacer, uint64_t frameIndex) {
+    /* Deadlines are calculated from the epoch each time so rounding errors dont accumulate,
+     * a frame is 70224 / 4194304 seconds which isnt a whole number of nanoseconds */
+    return pacer->epoch + cyclesToNanoseconds(pacer, frameIndex * pacer->cyclesPerFrame);
+}
+
+void pacer_init(FramePacer* pacer, uint64_t cyclesPerFrame, uint64_t cyclesPerSecond) {
+    pacer->cyclesPerFrame = cyclesPerFrame;
+    pacer->cyclesPerSecond = cyclesPerSecond;
+    pacer->spinThreshold = PACER_MIN_SPIN_NS * 5;
+    pacer->framesPaced = 0;
+    pacer->deadlinesMissed = 0;
+    pacer->resyncs = 0;
+    pacer->jitterMean = 0;
+    pacer->jitterM2 = 0;
+    pacer->jitterMax = 0;
+
+    pacer_reset(pacer);
+}
+
+void pacer_reset(FramePacer* pacer) {
+    pacer->epoch = pacer_now();
+    pacer->frameIndex = 1;
+    pacer->nextDeadline = getDeadline(pacer, 1);
+}
+
+int64_t pacer_getLateness(FramePacer* pacer) {
+    return (int64_t)(pacer_now() - pacer->nextDeadline);
+}
+
+static void recordJitter(FramePacer* pacer, uint64_t jitter) {
+    /* Running mean and variance (Welford's algorithm) */
+    pacer->framesPaced++;
+    double delta = jitter - pacer->jitterMean;
+    pacer->jitterMean += delta / pacer->framesPaced;
+    pacer->jitterM2 += delta * (jitter - pacer->jitterMean);
+
+    if (jitter > pacer->jitterMax) pacer->jitterMax = jitter;
+}
+
+void pacer_waitFrame(FramePacer* pacer) {
+    uint64_t deadline = pacer->nextDeadline;
+    uint64_t now = pacer_now();
+
+    if (now < deadline) {
+        if (deadline - now > pacer->spinThreshold) {
+            /* Sleep through most of the wait */
+            uint64_t sleepTarget = deadline - pacer->spinThreshold;
+            sleepUntil(sleepTarget);
+
+            /* Keep the spin part about twice as long as the sleep overshoot, moving slowly
+             * so a single late wakeup doesnt make it spin for long */
+            uint64_t overshoot = pacer_now() - sleepTarget;
+            int64_t target = overshoot * 2;
+            if (target < PACER_MIN_SPIN_NS) target = PACER_MIN_SPIN_NS;
+            if (target > PACER_MAX_SPIN_NS) target = PACER_MAX_SPIN_NS;
+            pacer->spinThreshold += (target - (int64_t)pacer->spinThreshold) / 8;
+        }
+
+        /* Spin for the rest */
+        while ((now = pacer_now()) < deadline);
+
+        recordJitter(pacer, now - deadline);
+    } else {
+        /* The frame took longer than it should have */
+        pacer->deadlinesMissed++;
+    }
+
+    pacer->frameIndex++;
+    pacer->nextDeadline = getDeadline(pacer, pacer->frameIndex);
+
+    if (now > pacer->nextDeadline + cyclesToNanoseconds(pacer, PACER_MAX_FRAMES_BEHIND * pacer->cyclesPerFrame)) {
+        pacer_reset(pacer);
+        pacer->resyncs++;
+    }
+}
+
+double pacer_getJitterDeviation(FramePacer* pacer) {
+    if (pacer->framesPaced < 2) return 0;
+    return sqrt(pacer->jitterM2 / (pacer->framesPaced - 1));
+}
+
+void pacer_printStats(FramePacer* pacer) {
+    printf("Frames Paced : %llu, Deadlines Missed : %llu, Resyncs : %llu\n",
+            (unsigned long long)pacer->framesPaced, (unsigned long long)pacer->deadlinesMissed,
+            (unsigned long long)pacer->resyncs);
+    printf("Jitter : mean %.1fus, deviation %.1fus, max %.1fus\n", pacer->jitterMean / 1e3,
+            pacer_getJitterDeviation(pacer) / 1e3, pacer->jitterMax / 1e3);
+}
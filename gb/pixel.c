@@ -0,0 +1,203 @@
+#include <gb/pixel.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Index of a pixel's color in the colors table passed to mixPixels
+ *
+ * DMG : BGP colors 0-3, OBP0 colors 4-7, OBP1 colors 8-11
+ * CGB : BG palettes 0-31, sprite palettes 32-63, palette * 4 + color ID */
+static inline uint8_t mixPixel(uint8_t bgColorID, uint8_t bgAttributes, uint8_t spriteColorID,
+                               uint8_t spriteAttributes, bool isCGB, bool bgPriority) {
+    uint8_t bgIndex = isCGB ? ((bgAttributes & 0b00000111) << 2) | bgColorID : bgColorID;
+
+    if (spriteColorID == 0) return bgIndex;
+
+    bool spritePriority = spriteAttributes & 0x80;
+    bool spriteWins;
+
+    if (!isCGB) {
+        /* Sprite is drawn over BG/Window unless the OAM priority bit is set,
+         * in that case it is only drawn over BG color 0 */
+        spriteWins = !spritePriority || bgColorID == 0;
+    } else {
+        /* If LCDC bit 0 is clear, sprites are always on top. Otherwise BG color 0 is always
+         * covered and color 1-3 are only covered when both the BG attribute and
+         * OAM priority bits are clear */
+        spriteWins = !bgPriority || bgColorID == 0 || (!(bgAttributes & 0x80) && !spritePriority);
+    }
+
+    if (!spriteWins) return bgIndex;
+    if (isCGB) return 32 | ((spriteAttributes & 0b00000111) << 2) | spriteColorID;
+    return 4 + ((spriteAttributes & 0x10) >> 2) + spriteColorID;
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+
+static inline __m128i decodeTileRowsSSE2(__m128i low, __m128i high, __m128i bitMasks) {
+    /* Every byte lane holds the whole tile row byte, masking it with the bit of the lane
+     * and comparing gives 0xFF for set bits */
+    __m128i lowBits = _mm_cmpeq_epi8(_mm_and_si128(low, bitMasks), bitMasks);
+    __m128i highBits = _mm_cmpeq_epi8(_mm_and_si128(high, bitMasks), bitMasks);
+
+    return _mm_or_si128(_mm_and_si128(lowBits, _mm_set1_epi8(1)), _mm_and_si128(highBits, _mm_set1_epi8(2)));
+}
+
+static inline __m128i getBitMasks(bool flipped) {
+    /* Leftmost pixel is bit 7, or bit 0 when flipped */
+    if (flipped) return _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    return _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+}
+
+void decodeTileRow(uint8_t low, uint8_t high, bool flipped, uint8_t* colorIDs) {
+    __m128i colors = decodeTileRowsSSE2(_mm_set1_epi8(low), _mm_set1_epi8(high), getBitMasks(flipped));
+    _mm_storel_epi64((__m128i*)colorIDs, colors);
+}
+
+void decodeTileRows_2(const uint8_t* low, const uint8_t* high, const bool* flipped, uint8_t* colorIDs) {
+    /* Lower 8 lanes hold the first tile, upper 8 lanes the second */
+    __m128i lowRows = _mm_unpacklo_epi64(_mm_set1_epi8(low[0]), _mm_set1_epi8(low[1]));
+    __m128i highRows = _mm_unpacklo_epi64(_mm_set1_epi8(high[0]), _mm_set1_epi8(high[1]));
+    __m128i bitMasks = _mm_unpacklo_epi64(getBitMasks(flipped[0]), getBitMasks(flipped[1]));
+
+    _mm_storeu_si128((__m128i*)colorIDs, decodeTileRowsSSE2(lowRows, highRows, bitMasks));
+}
+
+#else
+
+void decodeTileRow(uint8_t low, uint8_t high, bool flipped, uint8_t* colorIDs) {
+    for (int i = 0; i < 8; i++) {
+        uint8_t bit = flipped ? i : 7 - i;
+        colorIDs[i] = (((high >> bit) & 1) << 1) | ((low >> bit) & 1);
+    }
+}
+
+void decodeTileRows_2(const uint8_t* low, const uint8_t* high, const bool* flipped, uint8_t* colorIDs) {
+    decodeTileRow(low[0], high[0], flipped[0], colorIDs);
+    decodeTileRow(low[1], high[1], flipped[1], colorIDs + 8);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+void mixPixels(const uint8_t* bgColorIDs, const uint8_t* bgAttributes,
+               const uint8_t* spriteColorIDs, const uint8_t* spriteAttributes,
+               bool isCGB, bool bgPriority, const uint32_t* colors, uint32_t* out, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+    int x = 0;
+
+    for (; x + 32 <= count; x += 32) {
+        __m256i bgColor = _mm256_loadu_si256((const __m256i*)&bgColorIDs[x]);
+        __m256i bgAttr = _mm256_loadu_si256((const __m256i*)&bgAttributes[x]);
+        __m256i spriteColor = _mm256_loadu_si256((const __m256i*)&spriteColorIDs[x]);
+        __m256i spriteAttr = _mm256_loadu_si256((const __m256i*)&spriteAttributes[x]);
+
+        __m256i bgColorZero = _mm256_cmpeq_epi8(bgColor, zero);
+        __m256i spriteOpaque = _mm256_xor_si256(_mm256_cmpeq_epi8(spriteColor, zero), ones);
+        __m256i noSpritePriority = _mm256_cmpeq_epi8(_mm256_and_si256(spriteAttr, _mm256_set1_epi8(-128)), zero);
+        __m256i bgIndex, spriteIndex, spriteWins;
+
+        /* Palette numbers are at most 7, so shifting 16 bit lanes never carries into the next byte */
+        if (isCGB) {
+            bgIndex = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(bgAttr, _mm256_set1_epi8(7)), 2), bgColor);
+            spriteIndex = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(spriteAttr, _mm256_set1_epi8(7)), 2),
+                    _mm256_or_si256(spriteColor, _mm256_set1_epi8(32)));
+
+            if (bgPriority) {
+                __m256i noBgPriority = _mm256_cmpeq_epi8(_mm256_and_si256(bgAttr, _mm256_set1_epi8(-128)), zero);
+                spriteWins = _mm256_or_si256(bgColorZero, _mm256_and_si256(noBgPriority, noSpritePriority));
+                spriteWins = _mm256_and_si256(spriteWins, spriteOpaque);
+            } else spriteWins = spriteOpaque;
+        } else {
+            bgIndex = bgColor;
+            spriteIndex = _mm256_add_epi8(_mm256_srli_epi16(_mm256_and_si256(spriteAttr, _mm256_set1_epi8(0x10)), 2),
+                    _mm256_add_epi8(spriteColor, _mm256_set1_epi8(4)));
+            spriteWins = _mm256_and_si256(spriteOpaque, _mm256_or_si256(noSpritePriority, bgColorZero));
+        }
+
+        __m256i indices = _mm256_blendv_epi8(bgIndex, spriteIndex, spriteWins);
+
+        /* Look the colors up 8 pixels at a time */
+        __m128i lowIndices = _mm256_castsi256_si128(indices);
+        __m128i highIndices = _mm256_extracti128_si256(indices, 1);
+        _mm256_storeu_si256((__m256i*)&out[x], _mm256_i32gather_epi32((const int*)colors, _mm256_cvtepu8_epi32(lowIndices), 4));
+        _mm256_storeu_si256((__m256i*)&out[x + 8], _mm256_i32gather_epi32((const int*)colors, _mm256_cvtepu8_epi32(_mm_srli_si128(lowIndices, 8)), 4));
+        _mm256_storeu_si256((__m256i*)&out[x + 16], _mm256_i32gather_epi32((const int*)colors, _mm256_cvtepu8_epi32(highIndices), 4));
+        _mm256_storeu_si256((__m256i*)&out[x + 24], _mm256_i32gather_epi32((const int*)colors, _mm256_cvtepu8_epi32(_mm_srli_si128(highIndices, 8)), 4));
+    }
+
+    for (; x < count; x++) {
+        out[x] = colors[mixPixel(bgColorIDs[x], bgAttributes[x], spriteColorIDs[x], spriteAttributes[x], isCGB, bgPriority)];
+    }
+}
+
+#elif defined(__SSE2__)
+
+void mixPixels(const uint8_t* bgColorIDs, const uint8_t* bgAttributes,
+               const uint8_t* spriteColorIDs, const uint8_t* spriteAttributes,
+               bool isCGB, bool bgPriority, const uint32_t* colors, uint32_t* out, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    int x = 0;
+
+    for (; x + 16 <= count; x += 16) {
+        __m128i bgColor = _mm_loadu_si128((const __m128i*)&bgColorIDs[x]);
+        __m128i bgAttr = _mm_loadu_si128((const __m128i*)&bgAttributes[x]);
+        __m128i spriteColor = _mm_loadu_si128((const __m128i*)&spriteColorIDs[x]);
+        __m128i spriteAttr = _mm_loadu_si128((const __m128i*)&spriteAttributes[x]);
+
+        __m128i bgColorZero = _mm_cmpeq_epi8(bgColor, zero);
+        __m128i spriteOpaque = _mm_xor_si128(_mm_cmpeq_epi8(spriteColor, zero), ones);
+        __m128i noSpritePriority = _mm_cmpeq_epi8(_mm_and_si128(spriteAttr, _mm_set1_epi8(-128)), zero);
+        __m128i bgIndex, spriteIndex, spriteWins;
+
+        /* Palette numbers are at most 7, so shifting 16 bit lanes never carries into the next byte */
+        if (isCGB) {
+            bgIndex = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(bgAttr, _mm_set1_epi8(7)), 2), bgColor);
+            spriteIndex = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(spriteAttr, _mm_set1_epi8(7)), 2),
+                    _mm_or_si128(spriteColor, _mm_set1_epi8(32)));
+
+            if (bgPriority) {
+                __m128i noBgPriority = _mm_cmpeq_epi8(_mm_and_si128(bgAttr, _mm_set1_epi8(-128)), zero);
+                spriteWins = _mm_or_si128(bgColorZero, _mm_and_si128(noBgPriority, noSpritePriority));
+                spriteWins = _mm_and_si128(spriteWins, spriteOpaque);
+            } else spriteWins = spriteOpaque;
+        } else {
+            bgIndex = bgColor;
+            spriteIndex = _mm_add_epi8(_mm_srli_epi16(_mm_and_si128(spriteAttr, _mm_set1_epi8(0x10)), 2),
+                    _mm_add_epi8(spriteColor, _mm_set1_epi8(4)));
+            spriteWins = _mm_and_si128(spriteOpaque, _mm_or_si128(noSpritePriority, bgColorZero));
+        }
+
+        /* SSE2 has no byte blend */
+        __m128i indices = _mm_or_si128(_mm_and_si128(spriteWins, spriteIndex), _mm_andnot_si128(spriteWins, bgIndex));
+
+        /* No gather either, the lookup is done from memory */
+        uint8_t colorIndices[16];
+        _mm_storeu_si128((__m128i*)colorIndices, indices);
+        for (int i = 0; i < 16; i++) out[x + i] = colors[colorIndices[i]];
+    }
+
+    for (; x < count; x++) {
+        out[x] = colors[mixPixel(bgColorIDs[x], bgAttributes[x], spriteColorIDs[x], spriteAttributes[x], isCGB, bgPriority)];
+    }
+}
+
+#else
+
+void mixPixels(const uint8_t* bgColorIDs, const uint8_t* bgAttributes,
+               const uint8_t* spriteColorIDs, const uint8_t* spriteAttributes,
+               bool isCGB, bool bgPriority, const uint32_t* colors, uint32_t* out, int count) {
+    for (int x = 0; x < count; x++) {
+        out[x] = colors[mixPixel(bgColorIDs[x], bgAttributes[x], spriteColorIDs[x], spriteAttributes[x], isCGB, bgPriority)];
+    }
+}
+
+#endif
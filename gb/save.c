@@ -0,0 +1,163 @@
+#include <gb/save.h>
+#include <gb/gb.h>
+#include <gb/debug.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static bool hasBattery(CARTRIDGE_TYPE type) {
+    switch (type) {
+        case CARTRIDGE_MBC1_RAM_BATTERY:
+        case CARTRIDGE_MBC3_TIMER_BATTERY:
+        case CARTRIDGE_MBC3_RAM_BATTERY:
+        case CARTRIDGE_MBC3_TIMER_RAM_BATTERY:
+        case CARTRIDGE_MBC5_RAM_BATTERY:
+        case CARTRIDGE_MBC5_RUMBLE_RAM_BATTERY: return true;
+        default: return false;
+    }
+}
+
+static uint8_t* mapSaveFile(const char* path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    /* A new or short save file is extended with zeros */
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t* data = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return data == MAP_FAILED ? NULL : data;
+}
+
+static void flushDirtyPages(SaveRAM* save) {
+    /* msync works on whole host pages, so every host page with a dirty page in it is written.
+     * Pages are cleared before they are written, a write meanwhile marks them again */
+    size_t hostPageSize = sysconf(_SC_PAGESIZE);
+    size_t size = save->size + save->footerSize;
+
+    for (size_t start = 0; start < size; start += hostPageSize) {
+        size_t length = size - start < hostPageSize ? size - start : hostPageSize;
+        bool dirty = false;
+
+        for (size_t offset = start; offset < start + length; offset += SAVE_PAGE_SIZE) {
+            dirty |= __atomic_exchange_n(&save->dirtyPages[offset / SAVE_PAGE_SIZE], false, __ATOMIC_ACQ_REL);
+        }
+
+        if (dirty) msync(save->data + start, length, MS_SYNC);
+    }
+}
+
+static int runFlusher(void* data) {
+    SaveRAM* save = (SaveRAM*)data;
+
+    SDL_LockMutex(save->lock);
+    while (save->running) {
+        while (!save->flushRequested && save->running) SDL_CondWait(save->wake, save->lock);
+        save->flushRequested = false;
+
+        /* The core thread can request the next flush while this one writes */
+        SDL_UnlockMutex(save->lock);
+        flushDirtyPages(save);
+        SDL_LockMutex(save->lock);
+    }
+    SDL_UnlockMutex(save->lock);
+
+    return 0;
+}
+
+uint8_t* save_allocate(GB* gb, size_t size, size_t footerSize) {
+    SaveRAM* save = &gb->save;
+    const char* path = gb->cartridge->savePath;
+
+    save->size = size;
+    save->footerSize = footerSize;
+    save->mapped = false;
+    save->data = NULL;
+
+    if (path != NULL && hasBattery(gb->cartridge->cType) && size + footerSize <= SAVE_MAX_SIZE) {
+        save->data = mapSaveFile(path, size + footerSize);
+        if (save->data == NULL) log_warning(gb, "Could not open the save file, the game wont be saved");
+    }
+
+    if (save->data != NULL) {
+        save->lock = SDL_CreateMutex();
+        save->wake = SDL_CreateCond();
+        save->running = true;
+        save->flushRequested = false;
+        save->flusher = SDL_CreateThread(runFlusher, "MegaGB Save", save);
+        save->mapped = true;
+
+        if (save->flusher == NULL) {
+            /* Everything is written back at shutdown instead */
+            save->running = false;
+            log_warning(gb, "Could not start the save thread");
+        }
+    } else {
+        save->data = (uint8_t*)malloc(size + footerSize);
+        if (save->data != NULL) memset(save->data + size, 0, footerSize);
+    }
+
+    return save->data;
+}
+
+static void wakeFlusher(SaveRAM* save) {
+    save->dirty = false;
+    save->flushPending = false;
+    save->framesSinceFlush = 0;
+    if (save->flusher == NULL) return;
+
+    SDL_LockMutex(save->lock);
+    save->flushRequested = true;
+    SDL_CondSignal(save->wake);
+    SDL_UnlockMutex(save->lock);
+}
+
+void save_requestFlush(GB* gb) {
+    /* Some games disable RAM after every access, so requests are batched until the end of
+     * the frame */
+    if (gb->save.dirty) gb->save.flushPending = true;
+}
+
+void save_endFrame(GB* gb) {
+    SaveRAM* save = &gb->save;
+    if (!save->dirty) return;
+
+    if (save->flushPending || ++save->framesSinceFlush >= SAVE_FLUSH_FRAMES) wakeFlusher(save);
+}
+
+void save_free(GB* gb) {
+    SaveRAM* save = &gb->save;
+    if (save->data == NULL) return;
+
+    if (!save->mapped) {
+        free(save->data);
+        save->data = NULL;
+        return;
+    }
+
+    if (save->flusher != NULL) {
+        SDL_LockMutex(save->lock);
+        save->running = false;
+        SDL_CondSignal(save->wake);
+        SDL_UnlockMutex(save->lock);
+        SDL_WaitThread(save->flusher, NULL);
+        save->flusher = NULL;
+    }
+
+    /* The last writes are waited for */
+    msync(save->data, save->size + save->footerSize, MS_SYNC);
+    munmap(save->data, save->size + save->footerSize);
+    SDL_DestroyCond(save->wake);
+    SDL_DestroyMutex(save->lock);
+
+    save->data = NULL;
+    save->mapped = false;
+}
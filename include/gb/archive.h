@@ -0,0 +1,36 @@
+#ifndef gb_archive_h
+#define gb_archive_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ROMs can be loaded from gzip, zip and zstd archives. They are decompressed straight into the
+ * cartridge buffer, which is allocated with the size the archive header gives, so nothing is
+ * copied or written to a temporary file */
+
+/* Largest ROM the header can describe, anything bigger is not a ROM */
+#define ARCHIVE_MAX_ROM_SIZE 0x800000
+
+typedef enum {
+    ARCHIVE_NONE,                       /* Raw ROM */
+    ARCHIVE_GZIP,
+    ARCHIVE_ZIP,                        /* Stored or deflated, the first .gb/.gbc file is used */
+    ARCHIVE_ZSTD
+} ARCHIVE_FORMAT;
+
+/* Detects the format from the magic number */
+ARCHIVE_FORMAT archive_detect(const uint8_t* data, size_t size);
+/* Decompresses the ROM into a new heap buffer and stores its size, returns NULL on errors */
+uint8_t* archive_extract(const uint8_t* data, size_t size, ARCHIVE_FORMAT format, size_t* romSize);
+/* Whether the file extension is one of an archive, like .gz */
+bool archive_isArchiveExtension(const char* extension);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef gb_blockcache_h
+#define gb_blockcache_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <gb/cpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Forward Declare GB instead of including gb.h
+ * to avoid a circular include */
+
+struct GB;
+
+/* Cache of decoded basic blocks, so the CPU doesnt go through the memory map and the MBC
+ * for every opcode and operand it fetches
+ *
+ * Blocks are keyed by where their code physically is, the offset in the cartridge ROM
+ * (which includes the selected bank) or the offset in WRAM/HRAM. ROM never changes, blocks
+ * in RAM are invalidated by writeAddr when something writes over them */
+
+/* Blocks end after this many instructions or at a jump, call, return, halt or stop */
+#define BLOCK_MAX_INSTRUCTIONS 32
+#define BLOCK_MAX_BYTES (BLOCK_MAX_INSTRUCTIONS * 3)
+/* Number of slots in the cache, a new block replaces the block which was in its slot */
+#define BLOCK_CACHE_BITS 12
+#define BLOCK_CACHE_SIZE (1 << BLOCK_CACHE_BITS)
+
+/* Keys of blocks in RAM have this bit set, the rest is the offset of the block in the
+ * code map, which is WRAM (all banks) followed by HRAM */
+#define BLOCK_KEY_RAM 0x80000000
+#define BLOCK_CODE_MAP_HRAM 0x8000
+#define BLOCK_CODE_MAP_SIZE (BLOCK_CODE_MAP_HRAM + 0x80)
+
+typedef struct {
+    uint16_t address;
+    uint8_t opcode;
+    uint8_t operands[2];                /* CB prefixed instructions have the CB opcode here */
+    uint8_t length;                     /* In bytes, 0 marks the end of a block */
+    uint8_t cycles;                     /* Static cost in M cycles, with branches not taken */
+} CachedInstruction;
+
+typedef enum {
+    IDLE_LOOP_UNKNOWN,                  /* Not checked yet */
+    IDLE_LOOP_NO,
+    IDLE_LOOP_YES
+} IDLE_LOOP;
+
+typedef struct {
+    uint32_t key;
+    bool valid;
+    uint8_t count;                      /* Instructions in the block */
+    uint8_t size;                       /* Bytes covered by the block */
+    uint16_t cycles;                    /* Static cost of the whole block */
+    CachedInstruction instructions[BLOCK_MAX_INSTRUCTIONS + 1];
+
+    /* Used by the JIT */
+    uint16_t executions;
+    bool jitFailed;                     /* Couldnt be compiled or failed a lockstep check */
+    void* jitCode;
+
+    /* The block starts with a loop which only reads memory and writes A and F, so it does
+     * the same thing every time until something it reads changes */
+    uint8_t idleLoop;                   /* IDLE_LOOP */
+    uint8_t idleLoopLength;             /* Instructions in the loop, the last one branches back */
+    uint8_t idleLoopCycles;             /* M cycles of an iteration */
+} CachedBlock;
+
+typedef struct {
+    CachedBlock* blocks;
+    uint8_t* codeMap;                   /* Number of blocks covering every byte of WRAM and HRAM,
+                                           writes to bytes with a count invalidate blocks */
+    uint16_t codePages[BLOCK_CODE_MAP_SIZE / MEMORY_PAGE_SIZE + 1]; /* Number of blocks in every
+                                           page of the code map, pages of WRAM with code arent
+                                           mapped for writing */
+    uint32_t rom0Offset;                /* ROM offsets of the banks mapped at 0x0000 and 0x4000 */
+    uint32_t romNNOffset;
+
+    /* Statistics */
+    uint64_t blocksDecoded;
+    uint64_t blocksInvalidated;
+} BlockCache;
+
+/* Returned for code which isnt cached, its length is 0 like the end of a block */
+extern const CachedInstruction blockcache_noInstruction;
+
+void blockcache_init(struct GB* gb);
+void blockcache_free(struct GB* gb);
+/* Drops every block */
+void blockcache_flush(struct GB* gb);
+/* Updates the ROM offsets after the MBC switches banks */
+void blockcache_syncBanks(struct GB* gb);
+/* Returns the block at the address, decoding it if it isnt cached. NULL if the code there
+ * cant be cached */
+CachedBlock* blockcache_lookupBlock(struct GB* gb, uint16_t address);
+/* Same, but returns the first instruction of the block */
+const CachedInstruction* blockcache_lookup(struct GB* gb, uint16_t address);
+/* Invalidates every block covering the byte at the code map offset, used by writeAddr when
+ * the byte has a count */
+void blockcache_invalidate(struct GB* gb, uint32_t codeMapOffset);
+void blockcache_printStats(struct GB* gb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,10 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+/* Asks the kernel to back the mapped ROM with huge pages, which only works on file systems
+ * that support them */
+// #define CARTRIDGE_HUGE_PAGES
+
 typedef enum {
     LC_NONE = 0x0,
     LC_NINTENDO_R_AND_D1 = 0x1,
@@ -98,6 +102,11 @@ typedef enum {
 
 typedef struct {
     uint8_t* allocated;
+    size_t size;                             /* Size of the ROM file, can be less than the header
+                                                claims */
+    bool mapped;                             /* Allocated is a read only mapping of the file
+                                                instead of a heap buffer */
+    char* savePath;                          /* .sav file next to the ROM, NULL if unknown */
     uint8_t logoChecksum[0x30];              /* 0x30 bytes long logo checksum in the cartridge */
     char title[11];                          /* 11 character long title */
     char mfcCode[4];                         /* 4 character long manufacturer code */
@@ -123,6 +132,9 @@ typedef struct {
  * success or not */
 
 bool initCartridge(Cartridge* c, uint8_t* data, size_t size);
+/* Maps the ROM file and inits the cartridge with it, gzip, zip and zstd archives are
+ * decompressed instead */
+bool loadCartridge(Cartridge* c, const char* path);
 void printCartridge(Cartridge* c);
 void freeCartridge(Cartridge* c);
 #endif
@@ -1,6 +1,7 @@
 #ifndef gb_cpu_h
 #define gb_cpu_h
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -9,17 +10,38 @@ extern "C" {
 
 struct GB;
 
+/* The registers are stored as 16 bit pairs which the 8 bit registers alias, so the
+ * order of the halves follows the byte order of the host */
 typedef enum {
     /* General purpose Registers */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
     R8_A, R8_F,
     R8_B, R8_C,
     R8_D, R8_E,
     R8_H, R8_L,
 
     R8_SP_HIGH, R8_SP_LOW,
+#else
+    R8_F, R8_A,
+    R8_C, R8_B,
+    R8_E, R8_D,
+    R8_L, R8_H,
+
+    R8_SP_LOW, R8_SP_HIGH,
+#endif
     GP_COUNT
 } GP_REG;
 
+/* 16 bit registers, indices of the pairs */
+typedef enum {
+    R16_AF,
+    R16_BC,
+    R16_DE,
+    R16_HL,
+    R16_SP,
+    R16_COUNT
+} GP_REG16;
+
 typedef enum {
     FLAG_C,
     FLAG_H,
@@ -27,6 +49,43 @@ typedef enum {
     FLAG_Z
 } FLAG;
 
+/* ALU instructions record what they did instead of computing flags, F is only computed
+ * when something reads it */
+typedef enum {
+    FLAG_OP_NONE,                       /* F is up to date */
+    FLAG_OP_ADD,
+    FLAG_OP_ADC,
+    FLAG_OP_SUB,                        /* SUB and CP */
+    FLAG_OP_SBC,
+    FLAG_OP_AND,
+    FLAG_OP_LOGIC,                      /* OR, XOR and SWAP, only Z can be set */
+    FLAG_OP_INC,
+    FLAG_OP_DEC,
+    FLAG_OP_BIT,
+    FLAG_OP_SHIFT,                      /* Rotates and shifts */
+    FLAG_OP_SHIFT_A                     /* RLCA, RRCA, RLA and RRA, Z is always reset */
+} FLAG_OP;
+
+typedef struct {
+    uint8_t op;                         /* FLAG_OP */
+    uint8_t x;                          /* Operands */
+    uint8_t y;
+    uint8_t carry;                      /* Carry in for ADC and SBC, the new C for the rest */
+    uint8_t result;
+} LazyFlags;
+
+/* State of the CPU the last time it entered an idle loop, an iteration which starts and ends
+ * with the same state while nothing it reads changes runs the same way until the hardware
+ * next does something */
+typedef struct {
+    uint16_t address;                   /* Start of the loop */
+    unsigned long clock;                /* When it was entered */
+    unsigned int idleCycles;            /* Idle M cycles the hardware had then */
+    uint8_t GPR[GP_COUNT];
+    bool IME;
+    uint64_t skippedCycles;             /* Statistics, M cycles */
+} IdleLoopState;
+
 typedef enum {
     INTERRUPT_VBLANK,
     INTERRUPT_LCD_STAT,
@@ -37,23 +96,47 @@ typedef enum {
     INTERRUPT_COUNT
 } INTERRUPT;
 
-/* Defining macros for 16 bit registers, only for readability purposes */
-#define R16_AF R8_A
-#define R16_BC R8_B
-#define R16_DE R8_D
-#define R16_HL R8_H
-#define R16_SP R8_SP_HIGH
+/* The bus is split into 256 byte pages, each has a pointer to the memory it maps or NULL
+ * if accesses need to be handled (IO, MBC registers, locked VRAM, code in RAM) */
+#define MEMORY_PAGE_SIZE 0x100
+#define MEMORY_PAGE_COUNT 0x100
+
+typedef enum {
+    MEMORY_REGION_ROM,                  /* Both ROM banks */
+    MEMORY_REGION_VRAM,
+    MEMORY_REGION_EXTERNAL_RAM,
+    MEMORY_REGION_WRAM,                 /* Both WRAM banks and echo RAM */
+    MEMORY_REGION_WRAM_BANK,            /* Only the switchable WRAM bank */
+
+    MEMORY_REGION_COUNT
+} MEMORY_REGION;
 
 /* Resets the registers in the GBC */
 void resetGBC(struct GB* gb);
 /* Resets the registers in the GB */
 void resetGB(struct GB* gb);
-/* This function is invoked to run the CPU thread */
+/* Runs the CPU until gb->run is cleared, which is checked at the end of every frame */
 void dispatch(struct GB* gb);
+/* Runs a single instruction, returns false if the emulator was stopped */
+bool stepInstruction(struct GB* gb);
+/* Syncs the timer and handles interrupts, done after every instruction */
+void endInstruction(struct GB* gb);
+
+/* Computes F from the last ALU instruction */
+void syncFlags(struct GB* gb);
+/* Same without changing any state, for the debugger and the GUI */
+uint8_t getFlagRegister(struct GB* gb);
 
 /* Reading and Writing bus routines (instant) */
 void writeAddr(struct GB* gb, uint16_t addr, uint8_t byte);
 uint8_t readAddr(struct GB* gb, uint16_t addr);
+/* Same as readAddr without syncing or touching the MBC, for the debugger */
+uint8_t peekAddr(struct GB* gb, uint16_t addr);
+/* Updates the pages of a region after its banks or locks change */
+void updateMemoryMap(struct GB* gb, MEMORY_REGION region);
+/* Updates the write mapping of the bus pages that show a page of WRAM, after blocks were added
+ * to it or the last one was dropped */
+void updateWRAMPageMapping(struct GB* gb, uint32_t wramOffset);
 
 /* Function to request an interrupt when necessary */
 void requestInterrupt(struct GB* gb, INTERRUPT interrupt);
@@ -23,18 +23,23 @@ extern "C" {
 // #define DEBUG_MEM_LOGGING
 // #define DEBUG_GHDMA_LOGGING
 // #define DEBUG_PRINT_SERIAL_OUTPUT
-#define DEBUG_SUPPORT_SLOW_EMULATION
+/* Uses the function table CPU dispatcher even where computed goto is available */
+// #define DEBUG_NO_THREADED_DISPATCH
+/* Fetches every instruction from memory instead of the block cache */
+// #define DEBUG_NO_BLOCK_CACHE
+/* Runs a halted CPU one cycle at a time instead of skipping to the next hardware event */
+// #define DEBUG_NO_HALT_SKIP
+
+/* Defaults the frame sync target to free run */
 // #define DEBUG_UNLOCK_FRAMERATE
 
 /* Stops running when encounters opcode 0x40, LD B, B */
 // #define DEBUG_LDBB_BREAKPOINT
 
-#ifdef DEBUG_REALTIME_PRINTING
-#define DEBUG_SUPPORT_SLOW_EMULATION
-#endif
-
 int disassembleInstruction(GB* gb, uint16_t addr, char* output);
 int disassembleCBInstruction(GB* gb, uint8_t byte, char* output);
+/* Fills the registers, trace and statistics shown by the debugger, from the core thread */
+void updateDebugSnapshot(GB* gb, DebugSnapshot* snapshot);
 void printInstruction(GB* gb);
 void printRegisters(GB* gb);
 void printCBInstruction(GB* gb, uint8_t byte);
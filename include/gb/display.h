@@ -1,17 +1,27 @@
 #ifndef gb_display_h
 #define gb_display_h
 #include <SDL2/SDL.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define DISPLAY_SCALING 4
+#define DISPLAY_SCALING 4                   /* Initial window scale, the window can be resized */
 #define HEIGHT_PX 144
 #define WIDTH_PX  160
 
 #define FIFO_MAX_COUNT 8
 
+/* Frames are handed from the core thread to the presentation thread through a
+ * triple buffer, the shared index has this bit set while it holds a frame that has
+ * not been presented yet */
+#define FRAME_BUFFER_COUNT 3
+#define FRAME_BUFFER_FRESH 0x80
+
+/* 0x1800 bytes of tile data per VRAM bank, 16 bytes each */
+#define TILES_PER_VRAM_BANK 384
+
 #define T_CYCLES_PER_SEC 4194304
 #define T_CYCLES_PER_FRAME 70224
 #define T_CYCLES_PER_SCANLINE 456
@@ -41,6 +51,23 @@ typedef enum {
     FETCHER_OPTIONAL_PUSH
 } FETCHER_STATE;
 
+/* Renderer tiers, the FIFO renderer is dot accurate while the scanline renderer draws
+ * a whole line at once at the start of mode 3 and is much cheaper. Lines where the
+ * CPU changes PPU state during mode 3 are handed back to the FIFO renderer */
+
+typedef enum {
+    PPU_RENDERER_FIFO,
+    PPU_RENDERER_SCANLINE
+} PPU_RENDERER;
+
+/* DMG palette registers, used to index the cached shade tables */
+
+typedef enum {
+    DMG_PALETTE_BGP,
+    DMG_PALETTE_OBP0,
+    DMG_PALETTE_OBP1
+} DMG_PALETTE;
+
 /* Different types of STAT updates */
 
 typedef enum {
@@ -78,7 +105,32 @@ FIFO_Pixel peekFIFO(FIFO* fifo, uint8_t index);
 void insertFIFO(FIFO* fifo, FIFO_Pixel pixel, uint8_t index);
 void clearFIFO(FIFO* fifo);
 
+/* Re-decodes one entry of the cached CGB palette colors after a color ram write */
+void updatePaletteColor_CGB(struct GB* gb, bool isSprite, uint8_t colorIndex);
+
+/* Rebuilds the cached colors of a DMG palette after a palette register or shade change */
+void updatePaletteColors_DMG(struct GB* gb, DMG_PALETTE palette);
+
+/* Marks the decoded tile cache entry of a tile data byte as dirty, vramAddress is the offset
+ * in VRAM including the bank */
+void markTileDirty(struct GB* gb, uint16_t vramAddress);
+
+/* Called when the CPU writes to a register or memory that affects the scanline being drawn
+ * while the PPU is in mode 3 */
+void handleMode3Write(struct GB* gb);
+
 void syncDisplay(struct GB* gb);
+/* M cycles the PPU can run next without doing anything but counting dots, used to fast
+ * forward while the CPU is halted */
+unsigned int getIdleDisplayCycles(struct GB* gb);
+/* Runs that many idle M cycles in one step */
+void skipDisplay(struct GB* gb, unsigned int mCycles);
+/* M cycles before the PPU can next request an interrupt or end the frame, it may still
+ * have work to do in between. Used by catch up timing */
+unsigned int getQuietDisplayCycles(struct GB* gb);
+/* Presentation thread loop, handles SDL events and presents the newest frame along with the
+ * GUI until the emulator stops */
+void runPresentation(struct GB* gb);
 void enablePPU(struct GB* gb);
 void disablePPU(struct GB* gb);
 
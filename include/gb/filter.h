@@ -0,0 +1,49 @@
+#ifndef gb_filter_h
+#define gb_filter_h
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Post processing filters which turn finished ARGB8888 frames into the window output, like
+ * the pixel kernels these use SSE2 or AVX2 when the compiler targets them and plain C otherwise
+ *
+ * Output pitches are in pixels */
+
+/* Upscaling filter, scale2x and scale3x scale by their factor and are then fit to the output
+ * with nearest neighbour */
+typedef enum {
+    SCALE_FILTER_NEAREST,
+    SCALE_FILTER_SCALE2X,
+    SCALE_FILTER_SCALE3X,
+    SCALE_FILTER_BILINEAR
+} SCALE_FILTER;
+
+/* Widest input the filters accept, which is a scale3x frame */
+#define FILTER_MAX_INPUT_WIDTH (160 * 3)
+/* Widest output of the bilinear filter */
+#define FILTER_MAX_OUTPUT_WIDTH 4096
+
+/* Approximates the colors of the CGB LCD, which are less saturated than the raw rgb555 values */
+void correctColors(const uint32_t* in, uint32_t* out, int count);
+
+/* LCD ghosting, blends the frame into history which holds the previous output, so older
+ * frames fade out over a few frames */
+void blendFrames(const uint32_t* frame, uint32_t* history, int count);
+
+void scaleNearest(const uint32_t* in, int inWidth, int inHeight,
+                  uint32_t* out, int outWidth, int outHeight, int outPitch);
+void scaleBilinear(const uint32_t* in, int inWidth, int inHeight,
+                   uint32_t* out, int outWidth, int outHeight, int outPitch);
+
+/* Output is exactly 2x or 3x the input */
+void scale2x(const uint32_t* in, int width, int height, uint32_t* out, int outPitch);
+void scale3x(const uint32_t* in, int width, int height, uint32_t* out, int outPitch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,6 +8,11 @@
 #include <gb/mbc.h>
 #include <gb/cpu.h>
 #include <gb/display.h>
+#include <gb/pacer.h>
+#include <gb/blockcache.h>
+#include <gb/jit.h>
+#include <gb/filter.h>
+#include <gb/save.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -99,6 +104,13 @@ typedef enum {
     R_SVBK    = 0x70
 } HREG;
 
+/* How the hardware (PPU, DMA) is kept in time with the CPU */
+typedef enum {
+    TIMING_EAGER,                       /* Synced on every M cycle */
+    TIMING_CATCH_UP                     /* Runs behind the CPU and catches up when the CPU touches
+                                           it or it is about to request an interrupt */
+} TIMING_MODE;
+
 /* User-Configurables for the emulator */
 
 typedef struct {
@@ -107,8 +119,52 @@ typedef struct {
 	uint32_t shade1_rgb;
 	uint32_t shade2_rgb;
 	uint32_t shade3_rgb;
+
+	/* Renderer tier used by the PPU */
+	PPU_RENDERER renderer;
+
+	/* What frames are synchronised to */
+	FRAME_SYNC frameSync;
+
+	/* Skip rendering up to maxFrameskip frames in a row when the host falls behind */
+	bool frameskip;
+	uint8_t maxFrameskip;
+
+	/* Post processing of frames before they are shown */
+	SCALE_FILTER scaleFilter;
+	bool integerScaling;					/* Output size is a whole multiple of the frame size */
+	bool lcdGhosting;
+	bool colorCorrection;					/* Only applies in CGB mode */
+
+	/* Compile hot ROM code to native code, x86-64 only */
+	bool jit;
+	bool jitLockstep;						/* Check every compiled block against the interpreter */
+	bool idleLoopSkip;						/* Skip polling loops to the next hardware event */
+	TIMING_MODE timing;
 } GBSettings;
 
+/* Instructions shown by the tracer, the 10 last ones, the current one and the ones after it */
+#define DEBUG_TRACE_LENGTH 20
+#define DEBUG_TRACE_CURRENT 10
+
+/* What the debugger shows, published by the core thread at the end of a frame so the GUI
+ * never touches the running emulator */
+typedef struct {
+	uint8_t GPR[GP_COUNT];					/* F is computed from the lazy flags */
+	uint16_t PC;
+	uint16_t SP;
+	uint16_t traceAddresses[DEBUG_TRACE_LENGTH];
+	char trace[DEBUG_TRACE_LENGTH][30];		/* Disassembly of the instructions */
+
+	/* Statistics */
+	double jitterMean;
+	double jitterDeviation;
+	uint64_t jitterMax;
+	uint64_t deadlinesMissed;
+	uint64_t jitBlocksCompiled;
+	uint64_t jitLockstepMismatches;
+} DebugSnapshot;
+
 struct GB {
 	/* ---------------- IMGUI --------------- */
 	void* imgui_main_context; 				/* Main IMGUI Context for MENU */
@@ -119,24 +175,47 @@ struct GB {
     /* ---------------- SDL ----------------- */
     SDL_Window* sdl_window;					/* The window */
     SDL_Renderer* sdl_renderer;             /* Renderer */
+    SDL_Texture* sdl_texture;               /* Streaming texture frames are uploaded to */
+    SDL_Thread* coreThread;                 /* Thread running the emulation, SDL and IMGUI are only
+                                               used on the presentation thread */
     unsigned long ticksAtStartup;			/* Stores the ticks at emulator startup (rom boot) */
-    unsigned long ticksAtLastRender;		/* Used to calculate how much time has passed
-                                               since last sdl frame render */
+    FramePacer pacer;                       /* Paces emulated frames to real time */
+    bool vsyncEnabled;                      /* Vsync state of the main renderer */
     uint8_t joypadDirectionBuffer;			/* Stores joypad direction button states */
     uint8_t joypadActionBuffer;				/* Stores joypad action button states */
     JOYPAD_SELECT joypadSelectedMode;
+    uint8_t pendingJoypadDirection;         /* Button states written by the presentation thread, */
+    uint8_t pendingJoypadAction;            /* copied into the buffers above by syncFrontend */
+    bool joypadUpdatePending;               /* Set by the presentation thread when the joypad buffers
+                                               change, applied by the core thread every frame */
+    bool joypadInterruptPending;
+    GBSettings pendingSettings;             /* Settings edited by the GUI, the presentation thread
+                                               reads its own options (post processing, vsync)
+                                               from here. Copied into settings by syncFrontend */
+    bool settingsChanged;
+    bool debuggerVisible;                   /* The core thread only publishes debugSnapshot while set */
+    DebugSnapshot debugSnapshot;
+    SDL_mutex* frontendLock;                /* Guards pendingSettings and debugSnapshot, which both
+                                               threads access */
     /* -------------- Emulator ------------- */
     Cartridge* cartridge;
 	GBSettings settings;
     EMULATION_MODE emuMode;                 /* Which behaviour are we emulating, dmg, cgb, ect */
-    bool run;                               /* A flag that when set to false, quits the emulator */
-    bool paused;
+    bool run;                               /* A flag that when set to false, quits the emulator,
+                                               shared by both threads so accessed atomically */
+    bool paused;                            /* Atomic as well */
     bool IME;                               /* Interrupt Master Enable Flag */
     unsigned long lastDIVSync;              /* Holds the clock's state when DIV timer was last synced
                                              * this helps in getting the cycles elapsed */
     unsigned long lastTIMASync;             /* Same but for the TIMA timer */
     unsigned long clock;                    /* Main clock of the whole emulator
                                                Counts in T-Cycles */
+    unsigned long hardwareClock;            /* Clock the PPU and DMA are synced to, behind the
+                                               CPU's clock in catch up timing */
+    unsigned long syncDeadline;             /* The hardware has to be synced once the clock gets
+                                               here, 0 in eager timing */
+    unsigned long speedSwitchClock;         /* Clock at the last speed switch, and the real time */
+    unsigned long realCyclesAtSpeedSwitch;  /* cycles counted up to it, see getRealTimeCycles */
     bool scheduleHaltBug;				    /* If set to true,the CPU recreates the halt bug */
     bool scheduleDMA;                       /* If set to true, schedules the DMA to be enabled */
     bool doingDMA;
@@ -159,21 +238,41 @@ struct GB {
 	uint8_t ghdmaIndex;
 
     /* ---------------- CPU ---------------- */
-    uint8_t GPR[GP_COUNT];
+    union {
+        uint8_t GPR[GP_COUNT];
+        uint16_t GPR16[R16_COUNT];      /* Register pairs, the halves are in GPR */
+    };
+    LazyFlags lazyFlags;                /* F is stale while this holds an ALU instruction */
+    IdleLoopState idleLoop;
     uint16_t PC;                        /* Program Counter */
     bool scheduleInterruptEnable;       /* If set to true, it enables interrupts at the
                                            dispatch of the next instruction */
     bool haltMode;						/* If set to true, the CPU enters the halt
                                            procedure */
+    bool cpuEventPending;               /* The CPU has to take its slow path before the next
+                                           instruction, set along with the flags above and
+                                           at the end of every frame to check gb->run */
 	uint16_t dispatchedAddresses[11]; 	/* Addresses of the past 10 instructions executed + current */
 	int dispatchedAddressesStart;
+    BlockCache blockCache;              /* Decoded basic blocks */
+    const CachedInstruction* nextInstruction; /* Next instruction of the block being run, used
+                                           if the PC is still at its address */
+    const uint8_t* operandCursor;       /* Decoded operands of the current instruction, NULL
+                                           if they have to be read from memory */
+    JITState jit;                       /* Compiled hot blocks */
+    uint64_t interruptsDispatched;
     /* ------------- Memory ---------------- */
     uint8_t* vram;                      /* Stores VRAM along with all banks in blocks of 0x2000 */
     uint8_t* wram;                      /* Stores WRAM along with all banks in blocks of 0x1000 */
+    uint8_t* tileCache;                 /* Decoded 8x8 color IDs of every tile in VRAM, 64 bytes
+                                           per tile and TILES_PER_VRAM_BANK tiles per bank */
+    bool dirtyTiles[TILES_PER_VRAM_BANK * 2]; /* Tiles which have to be decoded again before use */
     uint8_t OAM[0xA0];                  /* OAM memory */
     uint8_t IO[0x80];                   /* IO Memory */
     uint8_t hram[0x7F];                 /* High RAM */
     uint8_t IE;                         /* Interrupt Enable Register */
+    uint8_t* readMap[MEMORY_PAGE_COUNT];  /* Memory mapped at every page, see updateMemoryMap */
+    uint8_t* writeMap[MEMORY_PAGE_COUNT];
 
     /* Selected bank fields only account for the selected bank numbers on the switchable
      * banking spaces. On DMG, selected WRAM Bank will be always 1 and selected VRAM bank will
@@ -182,6 +281,11 @@ struct GB {
     uint8_t selectedVRAMBank;
     void* memController;                /* Memory Bank Controller */
     MBC_TYPE memControllerType;
+    const MBCInterface* memControllerInterface; /* Installed by mbc_allocate */
+    uint8_t* rom0Bank;                  /* ROM banks mapped at 0x0000-0x3FFF and 0x4000-0x7FFF */
+    uint8_t* romNNBank;
+    uint8_t* externalRAMBank;           /* NULL if external RAM accesses go through the MBC */
+    SaveRAM save;                       /* External RAM of the MBC */
     /* ---------------- PPU ---------------- */
     FIFO BackgroundFIFO;
     FIFO OAMFIFO;
@@ -191,6 +295,33 @@ struct GB {
                                                set the hblank wait cycle duration */
     bool ppuEnabled;
     bool skipFrame;							/* Skips a frame render */
+    bool skipFrameRender;                   /* Current frame is emulated without being drawn */
+    uint8_t framesSkipped;                  /* Frames skipped in a row */
+    uint32_t frameBuffers[FRAME_BUFFER_COUNT][WIDTH_PX * HEIGHT_PX]; /* ARGB8888 frames */
+    uint32_t* framebuffer;                  /* Back buffer the PPU draws into */
+    uint8_t backFrameBuffer;                /* Index of the back buffer, owned by the core thread */
+    uint8_t frontFrameBuffer;               /* Index of the frame on screen, owned by the
+                                               presentation thread */
+    uint8_t readyFrameBuffer;               /* Index of the last finished frame, only accessed
+                                               atomically by both threads */
+    uint64_t framesPublished;               /* Frames handed to the presentation thread */
+    uint64_t framesPresented;               /* Value of the above when the presentation thread
+                                               last presented, written atomically */
+    /* Post processing, only used by the presentation thread */
+    uint32_t correctedFrame[WIDTH_PX * HEIGHT_PX]; /* Color corrected front frame */
+    uint32_t ghostingFrame[WIDTH_PX * HEIGHT_PX];  /* Last output of the ghosting blend */
+    bool ghostingPrimed;                    /* Above holds a frame, reset when ghosting is off */
+    const uint32_t* filteredFrame;          /* Front frame after color correction and ghosting */
+    uint32_t* scaledFrame;                  /* scale2x/scale3x output, 3 times the frame size */
+    int outputWidth;                        /* Size of the scaled output and the texture */
+    int outputHeight;
+    bool outputStale;                       /* Output has to be scaled again, like after a resize */
+    uint64_t postProcessTime;               /* Nanoseconds the last post processing took */
+    bool scanlineRendered;                  /* Current line was drawn by the scanline renderer */
+    unsigned int scanlineMode3Duration;     /* Estimated mode 3 length of a scanline rendered line */
+    bool mode3WriteLines[HEIGHT_PX];        /* Lines where PPU state was written in mode 3 this frame */
+    bool fifoFallbackLines[HEIGHT_PX];      /* Lines which use the FIFO renderer this frame, copied
+                                               from the above at the end of every frame */
     uint8_t currentFetcherTask;
     uint16_t fetcherTileAddress;            /* Address of the current tile the fetcher is on */
     uint8_t fetcherTileAttributes;          /* Attributes of the current tile the fetcher is on */
@@ -235,6 +366,10 @@ struct GB {
     int lastSpriteOverlapX;                 /* X Coordinate of the last overlapping sprite that was pushed fully */
     uint8_t* bgColorRAM;                    /* 64 Byte long color ram which stores CGB palettes */
     uint8_t* spriteColorRAM;                /* ^^^ for sprites */
+    uint32_t dmgPaletteColors[3][4];        /* ARGB8888 shades for BGP, OBP0 and OBP1 indexed by
+                                               color ID, rebuilt on palette/shade changes */
+    uint32_t cgbPaletteColors[2][32];       /* ARGB8888 decoded color ram, [0] = BG and [1] = sprites,
+                                               indexed by palette * 4 + color ID */
     uint8_t currentBackgroundCRAMIndex;     /* Current byte value in color ram which can be
                                                addressed by BCPS */
     uint8_t currentSpriteCRAMIndex;         /* ^^^^ addressed by OCPS */
@@ -257,6 +392,34 @@ void stopGBEmulator(GB* gb);
 
 /* Increments the cycle count by 4 tcycles and syncs all hardware to act accordingly if necessary */
 void cyclesSync_4(GB* gb);
+/* Runs the hardware up to the CPU's clock */
+void syncHardware(GB* gb);
+
+static inline void syncHardwareForAccess(GB* gb, uint16_t address) {
+    /* The CPU is about to access VRAM, OAM or IO. In catch up timing the hardware is brought up
+     * to date first, and synced again on the next cycle in case the access started a DMA or
+     * changed when the next interrupt comes */
+    if (address >= VRAM_N0_8KB && (address <= VRAM_N0_8KB_END ||
+        (address >= OAM_N0_160B && address <= IO_REG_END))) {
+        if (gb->hardwareClock != gb->clock) syncHardware(gb);
+        gb->syncDeadline = 0;
+    }
+}
+static inline unsigned long getRealTimeCycles(GB* gb) {
+    /* Single speed T-Cycles since boot, which unlike the clock dont run twice as fast in double
+     * speed. Used by hardware that counts real time like the MBC3 RTC */
+    unsigned long elapsed = gb->clock - gb->speedSwitchClock;
+    return gb->realCyclesAtSpeedSwitch + (gb->isDoubleSpeedMode ? elapsed / 2 : elapsed);
+}
+/* M cycles until the hardware next has work to do or can request an interrupt, 0 while
+ * something needs every cycle. Used to fast forward while the CPU is halted */
+unsigned int getIdleCycles(GB* gb);
+/* Runs that many idle M cycles in one step */
+void skipCycles(GB* gb, unsigned int mCycles);
+
+/* Applies input and settings from the presentation thread, called by the core thread
+ * at the end of every frame. Waits here while the emulator is paused */
+void syncFrontend(GB* gb);
 
 /* Joypad */
 
@@ -0,0 +1,78 @@
+#ifndef gb_jit_h
+#define gb_jit_h
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gb/blockcache.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Forward Declare GB instead of including gb.h
+ * to avoid a circular include */
+
+struct GB;
+
+/* Dynamic recompiler which translates hot ROM blocks from the block cache to x86-64
+ *
+ * Compiled code keeps the registers and flags in host registers and calls back into the
+ * emulator once per instruction to run its cycles and handle interrupts, so timing is the
+ * same as the interpreter. Memory goes through readAddr and writeAddr. Instructions which need
+ * more than that (stack, calls, halt, EI, DAA, read-modify-write on memory) end the compiled
+ * part of a block and are left to the interpreter */
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_SUPPORTED
+#endif
+
+/* Blocks are compiled once they are entered this many times */
+#define JIT_HOT_THRESHOLD 32
+/* Executable memory for compiled blocks, everything is thrown away when it fills up */
+#define JIT_CODE_BUFFER_SIZE (4 * 1024 * 1024)
+/* Writes a block can make while being checked against the interpreter */
+#define JIT_LOCKSTEP_MAX_WRITES 32
+
+typedef struct {
+    uint16_t address;
+    uint8_t value;
+} JITWrite;
+
+typedef struct {
+    uint8_t* code;                      /* Executable buffer, NULL if the JIT isnt available.
+                                           Only writable while a block is compiled */
+    size_t codeUsed;
+    bool exitBlock;                     /* A helper needs compiled code to return (bank switch) */
+    bool busy;                          /* The interpreter is checking a block, dont recompile */
+    uint8_t flagTable[256];             /* Host flags (lahf) to Z, H and C */
+
+    /* Lockstep mode runs compiled blocks in a sandbox without side effects, then runs the
+     * interpreter over the same instructions and compares the results */
+    bool sandboxed;
+    bool uncomparable;                  /* The block touched memory which depends on timing */
+    int sandboxInstructions;
+    int sandboxLimit;
+    uint64_t sandboxCycles;             /* M cycles */
+    int sandboxWriteCount;
+    JITWrite sandboxWrites[JIT_LOCKSTEP_MAX_WRITES];
+
+    /* Statistics */
+    uint64_t blocksCompiled;
+    uint64_t blocksRun;
+    uint64_t flushes;
+    uint64_t lockstepChecks;
+    uint64_t lockstepMismatches;
+} JITState;
+
+void jit_init(struct GB* gb);
+void jit_free(struct GB* gb);
+/* Runs the block if it is compiled, compiling it first once it is hot. Returns false if
+ * the interpreter has to run it instead */
+bool jit_run(struct GB* gb, CachedBlock* block);
+void jit_printStats(struct GB* gb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,15 +30,31 @@ typedef enum {
     MBC_TYPE_7
 } MBC_TYPE;
 
+/* Implemented by every MBC, mbc_allocate installs the one of the cartridge so
+ * accesses dont have to check the MBC type */
+typedef struct {
+    void (*free)(struct GB* gb);
+    void (*writeExternalRAM)(struct GB* gb, uint16_t addr, uint8_t byte);
+    uint8_t (*readExternalRAM)(struct GB* gb, uint16_t addr);
+    void (*interceptROMWrite)(struct GB* gb, uint16_t addr, uint8_t byte); /* Switches banks
+                                                with the functions below */
+} MBCInterface;
+
 void mbc_allocate(struct GB* gb);
 void mbc_free(struct GB* gb);
-uint8_t mbc_readROM_N0(struct GB* gb, uint16_t addr);
-uint8_t mbc_readROM_NN(struct GB* gb, uint16_t addr);
 void mbc_writeExternalRAM(struct GB* gb, uint16_t addr, uint8_t byte);
 uint8_t mbc_readExternalRAM(struct GB* gb, uint16_t addr);
 void mbc_interceptROMWrite(struct GB* gb, uint16_t addr, uint8_t byte);
+/* Banks currently mapped at 0x0000-0x3FFF and 0x4000-0x7FFF */
+int mbc_getSelectedROM0Bank(struct GB* gb);
+int mbc_getSelectedROMBank(struct GB* gb);
+/* Map a bank at 0x4000-0x7FFF and 0x0000-0x3FFF, the bank number is wrapped to the size of
+ * the ROM so reads through the bank pointers need no checks */
 void switchROMBank(struct GB* gb, int bankNumber);
 void switchRestrictedROMBank(struct GB* gb, int bankNumber);
+/* Maps a bank of external RAM at 0xA000-0xBFFF, if the banks are NULL accesses go through
+ * the MBC because RAM is disabled or missing, or something else is mapped */
+void switchRAMBank(struct GB* gb, uint8_t* ramBanks, int bankNumber);
 
 #ifdef __cplusplus
 }
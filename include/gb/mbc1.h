@@ -25,13 +25,13 @@ typedef struct {
 } MBC_1;
 
 void mbc1_allocate(GB* gb, bool externalRam);
-uint8_t mbc1_readROM_N0(GB* gb, uint16_t addr);
-uint8_t mbc1_readROM_NN(GB* gb, uint16_t addr);
 void mbc1_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte);
 uint8_t mbc1_readExternalRAM(GB* gb, uint16_t addr);
 void mbc1_free(GB* gb);
 void mbc1_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte);
 
+extern const MBCInterface mbc1_interface;
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,20 @@
 extern "C" {
 #endif
 
+/* The RTC is saved after the RAM in the common 48 byte format, the current and the latched
+ * registers as 4 byte little endian values followed by the 8 byte unix time they were saved at */
+#define MBC3_RTC_FOOTER_SIZE 48
+
+typedef enum {
+    RTC_SECONDS,
+    RTC_MINUTES,
+    RTC_HOURS,
+    RTC_DAYS_LOW,
+    RTC_DAYS_HIGH,                  /* Bit 0 is the 9th bit of the days, bit 6 halts the clock
+                                       and bit 7 is the day counter carry */
+    RTC_REGISTER_COUNT
+} RTC_REGISTER;
+
 typedef struct {
     /* External RAM Bank Storage
      *
@@ -26,17 +40,27 @@ typedef struct {
     uint8_t selectedROMBank;
     uint8_t selectedRAMBank; 
     
-    /* RTC Registers */
+    /* RTC Registers
+     *
+     * The clock isnt ticked, the registers hold the time at rtcBaseCycles and are brought up
+     * to date from the real time cycles elapsed since when they are latched or written. The
+     * time only depends on the emulated cycles, so it runs faster when fast forwarding. It
+     * only goes back with the clock if this state is restored together with it, otherwise
+     * it keeps its time and counts on from there */
+    uint8_t rtc[RTC_REGISTER_COUNT];
+    uint8_t rtcLatched[RTC_REGISTER_COUNT];     /* What the game reads */
+    unsigned long rtcBaseCycles;                /* Real time cycles the registers were last
+                                                   updated at, see getRealTimeCycles */
 } MBC_3;
 
 void mbc3_allocate(GB* gb, bool externalRam, bool rtc);
-uint8_t mbc3_readROM_N0(GB* gb, uint16_t addr);
-uint8_t mbc3_readROM_NN(GB* gb, uint16_t addr);
 void mbc3_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte);
 uint8_t mbc3_readExternalRAM(GB* gb, uint16_t addr);
 void mbc3_free(GB* gb);
 void mbc3_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte);
 
+extern const MBCInterface mbc3_interface;
+
 #ifdef __cplusplus
 }
 #endif
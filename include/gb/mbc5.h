@@ -13,19 +13,19 @@ typedef struct {
     uint8_t* ramBanks;
 
 	/* Registers */
-    uint8_t selectedROMBank;
+    uint16_t selectedROMBank;           /* 9 bits */
     uint8_t selectedRAMBank; 
     bool ramEnabled; 
 } MBC_5;
 
 void mbc5_allocate(GB* gb, bool externalRam);
-uint8_t mbc5_readROM_N0(GB* gb, uint16_t addr);
-uint8_t mbc5_readROM_NN(GB* gb, uint16_t addr);
 void mbc5_writeExternalRAM(GB* gb, uint16_t addr, uint8_t byte);
 uint8_t mbc5_readExternalRAM(GB* gb, uint16_t addr);
 void mbc5_free(GB* gb);
 void mbc5_interceptROMWrite(GB* gb, uint16_t addr, uint8_t byte);
 
+extern const MBCInterface mbc5_interface;
+
 #ifdef __cplusplus
 }
 #endif
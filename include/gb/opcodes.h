@@ -0,0 +1,532 @@
+/* Opcode description table, the single source for the CPU dispatchers
+ *
+ * This file is expanded by gb/cpu.c several times with different definitions of
+ *
+ * OP(opcode, ...)          Instruction, the rest of the arguments are its body
+ * OP_NO_SYNC(opcode, ...)  Same, but the timer and interrupts are not synced after it
+ * CB_OP(opcode, ...)       Instruction prefixed by 0xCB
+ *
+ * Bodies are run with gb pointing to the GB struct, opcodes without a body are
+ * NOP (0x00) or illegal and do nothing
+ *
+ * Instruction Set : https://www.pastraiser.com/cpu/gameboy/gameboy_opcodes.html */
+
+OP(0x00, )
+OP(0x01, LOAD_RR_D16(gb, R16_BC))
+OP(0x02, LOAD_ARR_R(gb, R16_BC, R8_A))
+OP(0x03, INC_RR(gb, R16_BC))
+OP(0x04, incrementR8(gb, R8_B))
+OP(0x05, decrementR8(gb, R8_B))
+OP(0x06, LOAD_R_D8(gb, R8_B))
+OP(0x07, rotateLeftR8(gb, R8_A, false))
+OP(0x08, storeSP(gb))
+OP(0x09, addR16(gb, R16_HL, R16_BC))
+OP(0x0A, LOAD_R_ARR(gb, R8_A, R16_BC))
+OP(0x0B, DEC_RR(gb, R16_BC))
+OP(0x0C, incrementR8(gb, R8_C))
+OP(0x0D, decrementR8(gb, R8_C))
+OP(0x0E, LOAD_R_D8(gb, R8_C))
+OP(0x0F, rotateRightR8(gb, R8_A, false))
+OP_NO_SYNC(0x10, stop(gb))
+OP(0x11, LOAD_RR_D16(gb, R16_DE))
+OP(0x12, LOAD_ARR_R(gb, R16_DE, R8_A))
+OP(0x13, INC_RR(gb, R16_DE))
+OP(0x14, incrementR8(gb, R8_D))
+OP(0x15, decrementR8(gb, R8_D))
+OP(0x16, LOAD_R_D8(gb, R8_D))
+OP(0x17, rotateLeftCarryR8(gb, R8_A, false))
+OP(0x18, JUMP_RL(gb, readByte_4C(gb)))
+OP(0x19, addR16(gb, R16_HL, R16_DE))
+OP(0x1A, LOAD_R_ARR(gb, R8_A, R16_DE))
+OP(0x1B, DEC_RR(gb, R16_DE))
+OP(0x1C, incrementR8(gb, R8_E))
+OP(0x1D, decrementR8(gb, R8_E))
+OP(0x1E, LOAD_R_D8(gb, R8_E))
+OP(0x1F, rotateRightCarryR8(gb, R8_A, false))
+OP(0x20, jumpRelativeCondition(gb, CONDITION_NZ(gb)))
+OP(0x21, LOAD_RR_D16(gb, R16_HL))
+OP(0x22, LOAD_ARR_R(gb, R16_HL, R8_A); set_reg16(gb, R16_HL, get_reg16(gb, R16_HL) + 1))
+OP(0x23, INC_RR(gb, R16_HL))
+OP(0x24, incrementR8(gb, R8_H))
+OP(0x25, decrementR8(gb, R8_H))
+OP(0x26, LOAD_R_D8(gb, R8_H))
+OP(0x27, decimalAdjust(gb))
+OP(0x28, jumpRelativeCondition(gb, CONDITION_Z(gb)))
+OP(0x29, addR16(gb, R16_HL, R16_HL))
+OP(0x2A, LOAD_R_ARR(gb, R8_A, R16_HL); set_reg16(gb, R16_HL, get_reg16(gb, R16_HL) + 1))
+OP(0x2B, DEC_RR(gb, R16_HL))
+OP(0x2C, incrementR8(gb, R8_L))
+OP(0x2D, decrementR8(gb, R8_L))
+OP(0x2E, LOAD_R_D8(gb, R8_L))
+OP(0x2F, cpl(gb))
+OP(0x30, jumpRelativeCondition(gb, CONDITION_NC(gb)))
+OP(0x31, LOAD_RR_D16(gb, R16_SP))
+OP(0x32, LOAD_ARR_R(gb, R16_HL, R8_A); set_reg16(gb, R16_HL, get_reg16(gb, R16_HL) - 1))
+OP(0x33, INC_RR(gb, R16_SP))
+OP(0x34, incrementAR16(gb, R16_HL))
+OP(0x35, decrementAR16(gb, R16_HL))
+OP(0x36, LOAD_ARR_D8(gb, R16_HL))
+OP(0x37, scf(gb))
+OP(0x38, jumpRelativeCondition(gb, CONDITION_C(gb)))
+OP(0x39, addR16(gb, R16_HL, R16_SP))
+OP(0x3A, LOAD_R_ARR(gb, R8_A, R16_HL); set_reg16(gb, R16_HL, get_reg16(gb, R16_HL) - 1))
+OP(0x3B, DEC_RR(gb, R16_SP))
+OP(0x3C, incrementR8(gb, R8_A))
+OP(0x3D, decrementR8(gb, R8_A))
+OP(0x3E, LOAD_R_D8(gb, R8_A))
+OP(0x3F, CCF(gb))
+#ifdef DEBUG_LDBB_BREAKPOINT
+OP(0x40, LOAD_R_R(gb, R8_B, R8_B); exit(0))
+#else
+OP(0x40, LOAD_R_R(gb, R8_B, R8_B))
+#endif
+OP(0x41, LOAD_R_R(gb, R8_B, R8_C))
+OP(0x42, LOAD_R_R(gb, R8_B, R8_D))
+OP(0x43, LOAD_R_R(gb, R8_B, R8_E))
+OP(0x44, LOAD_R_R(gb, R8_B, R8_H))
+OP(0x45, LOAD_R_R(gb, R8_B, R8_L))
+OP(0x46, LOAD_R_ARR(gb, R8_B, R16_HL))
+OP(0x47, LOAD_R_R(gb, R8_B, R8_A))
+OP(0x48, LOAD_R_R(gb, R8_C, R8_B))
+OP(0x49, LOAD_R_R(gb, R8_C, R8_C))
+OP(0x4A, LOAD_R_R(gb, R8_C, R8_D))
+OP(0x4B, LOAD_R_R(gb, R8_C, R8_E))
+OP(0x4C, LOAD_R_R(gb, R8_C, R8_H))
+OP(0x4D, LOAD_R_R(gb, R8_C, R8_L))
+OP(0x4E, LOAD_R_ARR(gb, R8_C, R16_HL))
+OP(0x4F, LOAD_R_R(gb, R8_C, R8_A))
+OP(0x50, LOAD_R_R(gb, R8_D, R8_B))
+OP(0x51, LOAD_R_R(gb, R8_D, R8_C))
+OP(0x52, LOAD_R_R(gb, R8_D, R8_D))
+OP(0x53, LOAD_R_R(gb, R8_D, R8_E))
+OP(0x54, LOAD_R_R(gb, R8_D, R8_H))
+OP(0x55, LOAD_R_R(gb, R8_D, R8_L))
+OP(0x56, LOAD_R_ARR(gb, R8_D, R16_HL))
+OP(0x57, LOAD_R_R(gb, R8_D, R8_A))
+OP(0x58, LOAD_R_R(gb, R8_E, R8_B))
+OP(0x59, LOAD_R_R(gb, R8_E, R8_C))
+OP(0x5A, LOAD_R_R(gb, R8_E, R8_D))
+OP(0x5B, LOAD_R_R(gb, R8_E, R8_E))
+OP(0x5C, LOAD_R_R(gb, R8_E, R8_H))
+OP(0x5D, LOAD_R_R(gb, R8_E, R8_L))
+OP(0x5E, LOAD_R_ARR(gb, R8_E, R16_HL))
+OP(0x5F, LOAD_R_R(gb, R8_E, R8_A))
+OP(0x60, LOAD_R_R(gb, R8_H, R8_B))
+OP(0x61, LOAD_R_R(gb, R8_H, R8_C))
+OP(0x62, LOAD_R_R(gb, R8_H, R8_D))
+OP(0x63, LOAD_R_R(gb, R8_H, R8_E))
+OP(0x64, LOAD_R_R(gb, R8_H, R8_H))
+OP(0x65, LOAD_R_R(gb, R8_H, R8_L))
+OP(0x66, LOAD_R_ARR(gb, R8_H, R16_HL))
+OP(0x67, LOAD_R_R(gb, R8_H, R8_A))
+OP(0x68, LOAD_R_R(gb, R8_L, R8_B))
+OP(0x69, LOAD_R_R(gb, R8_L, R8_C))
+OP(0x6A, LOAD_R_R(gb, R8_L, R8_D))
+OP(0x6B, LOAD_R_R(gb, R8_L, R8_E))
+OP(0x6C, LOAD_R_R(gb, R8_L, R8_H))
+OP(0x6D, LOAD_R_R(gb, R8_L, R8_L))
+OP(0x6E, LOAD_R_ARR(gb, R8_L, R16_HL))
+OP(0x6F, LOAD_R_R(gb, R8_L, R8_A))
+OP(0x70, LOAD_ARR_R(gb, R16_HL, R8_B))
+OP(0x71, LOAD_ARR_R(gb, R16_HL, R8_C))
+OP(0x72, LOAD_ARR_R(gb, R16_HL, R8_D))
+OP(0x73, LOAD_ARR_R(gb, R16_HL, R8_E))
+OP(0x74, LOAD_ARR_R(gb, R16_HL, R8_H))
+OP(0x75, LOAD_ARR_R(gb, R16_HL, R8_L))
+OP(0x76, halt(gb))
+OP(0x77, LOAD_ARR_R(gb, R16_HL, R8_A))
+OP(0x78, LOAD_R_R(gb, R8_A, R8_B))
+OP(0x79, LOAD_R_R(gb, R8_A, R8_C))
+OP(0x7A, LOAD_R_R(gb, R8_A, R8_D))
+OP(0x7B, LOAD_R_R(gb, R8_A, R8_E))
+OP(0x7C, LOAD_R_R(gb, R8_A, R8_H))
+OP(0x7D, LOAD_R_R(gb, R8_A, R8_L))
+OP(0x7E, LOAD_R_ARR(gb, R8_A, R16_HL))
+OP(0x7F, LOAD_R_R(gb, R8_A, R8_A))
+OP(0x80, addR8(gb, R8_A, R8_B))
+OP(0x81, addR8(gb, R8_A, R8_C))
+OP(0x82, addR8(gb, R8_A, R8_D))
+OP(0x83, addR8(gb, R8_A, R8_E))
+OP(0x84, addR8(gb, R8_A, R8_H))
+OP(0x85, addR8(gb, R8_A, R8_L))
+OP(0x86, addR8_AR16(gb, R8_A, R16_HL))
+OP(0x87, addR8(gb, R8_A, R8_A))
+OP(0x88, adcR8(gb, R8_A, R8_B))
+OP(0x89, adcR8(gb, R8_A, R8_C))
+OP(0x8A, adcR8(gb, R8_A, R8_D))
+OP(0x8B, adcR8(gb, R8_A, R8_E))
+OP(0x8C, adcR8(gb, R8_A, R8_H))
+OP(0x8D, adcR8(gb, R8_A, R8_L))
+OP(0x8E, adcR8_AR16(gb, R8_A, R16_HL))
+OP(0x8F, adcR8(gb, R8_A, R8_A))
+OP(0x90, subR8(gb, R8_A, R8_B))
+OP(0x91, subR8(gb, R8_A, R8_C))
+OP(0x92, subR8(gb, R8_A, R8_D))
+OP(0x93, subR8(gb, R8_A, R8_E))
+OP(0x94, subR8(gb, R8_A, R8_H))
+OP(0x95, subR8(gb, R8_A, R8_L))
+OP(0x96, subR8_AR16(gb, R8_A, R16_HL))
+OP(0x97, subR8(gb, R8_A, R8_A))
+OP(0x98, sbcR8(gb, R8_A, R8_B))
+OP(0x99, sbcR8(gb, R8_A, R8_C))
+OP(0x9A, sbcR8(gb, R8_A, R8_D))
+OP(0x9B, sbcR8(gb, R8_A, R8_E))
+OP(0x9C, sbcR8(gb, R8_A, R8_H))
+OP(0x9D, sbcR8(gb, R8_A, R8_L))
+OP(0x9E, sbcR8_AR16(gb, R8_A, R16_HL))
+OP(0x9F, sbcR8(gb, R8_A, R8_A))
+OP(0xA0, andR8(gb, R8_A, R8_B))
+OP(0xA1, andR8(gb, R8_A, R8_C))
+OP(0xA2, andR8(gb, R8_A, R8_D))
+OP(0xA3, andR8(gb, R8_A, R8_E))
+OP(0xA4, andR8(gb, R8_A, R8_H))
+OP(0xA5, andR8(gb, R8_A, R8_L))
+OP(0xA6, andR8_AR16(gb, R8_A, R16_HL))
+OP(0xA7, andR8(gb, R8_A, R8_A))
+OP(0xA8, xorR8(gb, R8_A, R8_B))
+OP(0xA9, xorR8(gb, R8_A, R8_C))
+OP(0xAA, xorR8(gb, R8_A, R8_D))
+OP(0xAB, xorR8(gb, R8_A, R8_E))
+OP(0xAC, xorR8(gb, R8_A, R8_H))
+OP(0xAD, xorR8(gb, R8_A, R8_L))
+OP(0xAE, xorR8_AR16(gb, R8_A, R16_HL))
+OP(0xAF, xorR8(gb, R8_A, R8_A))
+OP(0xB0, orR8(gb, R8_A, R8_B))
+OP(0xB1, orR8(gb, R8_A, R8_C))
+OP(0xB2, orR8(gb, R8_A, R8_D))
+OP(0xB3, orR8(gb, R8_A, R8_E))
+OP(0xB4, orR8(gb, R8_A, R8_H))
+OP(0xB5, orR8(gb, R8_A, R8_L))
+OP(0xB6, orR8_AR16(gb, R8_A, R16_HL))
+OP(0xB7, orR8(gb, R8_A, R8_A))
+OP(0xB8, compareR8(gb, R8_A, R8_B))
+OP(0xB9, compareR8(gb, R8_A, R8_C))
+OP(0xBA, compareR8(gb, R8_A, R8_D))
+OP(0xBB, compareR8(gb, R8_A, R8_E))
+OP(0xBC, compareR8(gb, R8_A, R8_H))
+OP(0xBD, compareR8(gb, R8_A, R8_L))
+OP(0xBE, compareR8_AR16(gb, R8_A, R16_HL))
+OP(0xBF, compareR8(gb, R8_A, R8_A))
+OP(0xC0, retCondition(gb, CONDITION_NZ(gb)))
+OP(0xC1, POP_R16(gb, R16_BC))
+OP(0xC2, jumpCondition(gb, CONDITION_NZ(gb)))
+OP(0xC3, JUMP(gb, read2Bytes_8C(gb)))
+OP(0xC4, callCondition(gb, read2Bytes_8C(gb), CONDITION_NZ(gb)))
+OP(0xC5, PUSH_R16(gb, R16_BC))
+OP(0xC6, addR8D8(gb, R8_A))
+OP(0xC7, RST(gb, 0x00))
+OP(0xC8, retCondition(gb, CONDITION_Z(gb)))
+OP(0xC9, ret(gb))
+OP(0xCA, jumpCondition(gb, CONDITION_Z(gb)))
+OP(0xCB, PREFIX_CB(gb))
+OP(0xCC, callCondition(gb, read2Bytes_8C(gb), CONDITION_Z(gb)))
+OP(0xCD, call(gb, read2Bytes_8C(gb)))
+OP(0xCE, adcR8D8(gb, R8_A))
+OP(0xCF, RST(gb, 0x08))
+OP(0xD0, retCondition(gb, CONDITION_NC(gb)))
+OP(0xD1, POP_R16(gb, R16_DE))
+OP(0xD2, jumpCondition(gb, CONDITION_NC(gb)))
+OP(0xD3, )
+OP(0xD4, callCondition(gb, read2Bytes_8C(gb), CONDITION_NC(gb)))
+OP(0xD5, PUSH_R16(gb, R16_DE))
+OP(0xD6, subR8D8(gb, R8_A))
+OP(0xD7, RST(gb, 0x10))
+OP(0xD8, retCondition(gb, CONDITION_C(gb)))
+OP(0xD9, INTERRUPT_MASTER_ENABLE(gb); ret(gb))
+OP(0xDA, jumpCondition(gb, CONDITION_C(gb)))
+OP(0xDB, )
+OP(0xDC, callCondition(gb, read2Bytes_8C(gb), CONDITION_C(gb)))
+OP(0xDD, )
+OP(0xDE, sbcR8D8(gb, R8_A))
+OP(0xDF, RST(gb, 0x18))
+OP(0xE0, LOAD_D8PORT_R(gb, R8_A))
+OP(0xE1, POP_R16(gb, R16_HL))
+OP(0xE2, LOAD_RPORT_R(gb, R8_A, R8_C))
+OP(0xE3, )
+OP(0xE4, )
+OP(0xE5, PUSH_R16(gb, R16_HL))
+OP(0xE6, andR8D8(gb, R8_A))
+OP(0xE7, RST(gb, 0x20))
+OP(0xE8, addR16I8(gb, R16_SP))
+OP(0xE9, JUMP_RR(gb, R16_HL))
+OP(0xEA, LOAD_MEM_R(gb, R8_A))
+OP(0xEB, )
+OP(0xEC, )
+OP(0xED, )
+OP(0xEE, xorR8D8(gb, R8_A))
+OP(0xEF, RST(gb, 0x28))
+OP(0xF0, LOAD_R_D8PORT(gb, R8_A))
+OP(0xF1, popAF(gb))
+OP(0xF2, LOAD_R_RPORT(gb, R8_A, R8_C))
+OP(0xF3, INTERRUPT_MASTER_DISABLE(gb))
+OP(0xF4, )
+OP(0xF5, PUSH_R16(gb, R16_AF))
+OP(0xF6, orR8D8(gb, R8_A))
+OP(0xF7, RST(gb, 0x30))
+OP(0xF8, LOAD_RR_RRI8(gb, R16_HL, R16_SP))
+OP(0xF9, LOAD_RR_RR(gb, R16_SP, R16_HL))
+OP(0xFA, LOAD_R_MEM(gb, R8_A))
+OP(0xFB, INTERRUPT_MASTER_ENABLE(gb))
+OP(0xFC, )
+OP(0xFD, )
+OP(0xFE, compareR8D8(gb, R8_A))
+OP(0xFF, RST(gb, 0x38))
+
+/* 0xCB prefixed */
+
+CB_OP(0x00, rotateLeftR8(gb, R8_B, true))
+CB_OP(0x01, rotateLeftR8(gb, R8_C, true))
+CB_OP(0x02, rotateLeftR8(gb, R8_D, true))
+CB_OP(0x03, rotateLeftR8(gb, R8_E, true))
+CB_OP(0x04, rotateLeftR8(gb, R8_H, true))
+CB_OP(0x05, rotateLeftR8(gb, R8_L, true))
+CB_OP(0x06, rotateLeftAR16(gb, R16_HL, true))
+CB_OP(0x07, rotateLeftR8(gb, R8_A, true))
+CB_OP(0x08, rotateRightR8(gb, R8_B, true))
+CB_OP(0x09, rotateRightR8(gb, R8_C, true))
+CB_OP(0x0A, rotateRightR8(gb, R8_D, true))
+CB_OP(0x0B, rotateRightR8(gb, R8_E, true))
+CB_OP(0x0C, rotateRightR8(gb, R8_H, true))
+CB_OP(0x0D, rotateRightR8(gb, R8_L, true))
+CB_OP(0x0E, rotateRightAR16(gb, R16_HL, true))
+CB_OP(0x0F, rotateRightR8(gb, R8_A, true))
+CB_OP(0x10, rotateLeftCarryR8(gb, R8_B, true))
+CB_OP(0x11, rotateLeftCarryR8(gb, R8_C, true))
+CB_OP(0x12, rotateLeftCarryR8(gb, R8_D, true))
+CB_OP(0x13, rotateLeftCarryR8(gb, R8_E, true))
+CB_OP(0x14, rotateLeftCarryR8(gb, R8_H, true))
+CB_OP(0x15, rotateLeftCarryR8(gb, R8_L, true))
+CB_OP(0x16, rotateLeftCarryAR16(gb, R16_HL, true))
+CB_OP(0x17, rotateLeftCarryR8(gb, R8_A, true))
+CB_OP(0x18, rotateRightCarryR8(gb, R8_B, true))
+CB_OP(0x19, rotateRightCarryR8(gb, R8_C, true))
+CB_OP(0x1A, rotateRightCarryR8(gb, R8_D, true))
+CB_OP(0x1B, rotateRightCarryR8(gb, R8_E, true))
+CB_OP(0x1C, rotateRightCarryR8(gb, R8_H, true))
+CB_OP(0x1D, rotateRightCarryR8(gb, R8_L, true))
+CB_OP(0x1E, rotateRightCarryAR16(gb, R16_HL, true))
+CB_OP(0x1F, rotateRightCarryR8(gb, R8_A, true))
+CB_OP(0x20, shiftLeftArithmeticR8(gb, R8_B))
+CB_OP(0x21, shiftLeftArithmeticR8(gb, R8_C))
+CB_OP(0x22, shiftLeftArithmeticR8(gb, R8_D))
+CB_OP(0x23, shiftLeftArithmeticR8(gb, R8_E))
+CB_OP(0x24, shiftLeftArithmeticR8(gb, R8_H))
+CB_OP(0x25, shiftLeftArithmeticR8(gb, R8_L))
+CB_OP(0x26, shiftLeftArithmeticAR16(gb, R16_HL))
+CB_OP(0x27, shiftLeftArithmeticR8(gb, R8_A))
+CB_OP(0x28, shiftRightArithmeticR8(gb, R8_B))
+CB_OP(0x29, shiftRightArithmeticR8(gb, R8_C))
+CB_OP(0x2A, shiftRightArithmeticR8(gb, R8_D))
+CB_OP(0x2B, shiftRightArithmeticR8(gb, R8_E))
+CB_OP(0x2C, shiftRightArithmeticR8(gb, R8_H))
+CB_OP(0x2D, shiftRightArithmeticR8(gb, R8_L))
+CB_OP(0x2E, shiftRightArithmeticAR16(gb, R16_HL))
+CB_OP(0x2F, shiftRightArithmeticR8(gb, R8_A))
+CB_OP(0x30, swapR8(gb, R8_B))
+CB_OP(0x31, swapR8(gb, R8_C))
+CB_OP(0x32, swapR8(gb, R8_D))
+CB_OP(0x33, swapR8(gb, R8_E))
+CB_OP(0x34, swapR8(gb, R8_H))
+CB_OP(0x35, swapR8(gb, R8_L))
+CB_OP(0x36, swapAR16(gb, R16_HL))
+CB_OP(0x37, swapR8(gb, R8_A))
+CB_OP(0x38, shiftRightLogicalR8(gb, R8_B))
+CB_OP(0x39, shiftRightLogicalR8(gb, R8_C))
+CB_OP(0x3A, shiftRightLogicalR8(gb, R8_D))
+CB_OP(0x3B, shiftRightLogicalR8(gb, R8_E))
+CB_OP(0x3C, shiftRightLogicalR8(gb, R8_H))
+CB_OP(0x3D, shiftRightLogicalR8(gb, R8_L))
+CB_OP(0x3E, shiftRightLogicalAR16(gb, R16_HL))
+CB_OP(0x3F, shiftRightLogicalR8(gb, R8_A))
+CB_OP(0x40, testBitR8(gb, R8_B, 0))
+CB_OP(0x41, testBitR8(gb, R8_C, 0))
+CB_OP(0x42, testBitR8(gb, R8_D, 0))
+CB_OP(0x43, testBitR8(gb, R8_E, 0))
+CB_OP(0x44, testBitR8(gb, R8_H, 0))
+CB_OP(0x45, testBitR8(gb, R8_L, 0))
+CB_OP(0x46, testBitAR16(gb, R16_HL, 0))
+CB_OP(0x47, testBitR8(gb, R8_A, 0))
+CB_OP(0x48, testBitR8(gb, R8_B, 1))
+CB_OP(0x49, testBitR8(gb, R8_C, 1))
+CB_OP(0x4A, testBitR8(gb, R8_D, 1))
+CB_OP(0x4B, testBitR8(gb, R8_E, 1))
+CB_OP(0x4C, testBitR8(gb, R8_H, 1))
+CB_OP(0x4D, testBitR8(gb, R8_L, 1))
+CB_OP(0x4E, testBitAR16(gb, R16_HL, 1))
+CB_OP(0x4F, testBitR8(gb, R8_A, 1))
+CB_OP(0x50, testBitR8(gb, R8_B, 2))
+CB_OP(0x51, testBitR8(gb, R8_C, 2))
+CB_OP(0x52, testBitR8(gb, R8_D, 2))
+CB_OP(0x53, testBitR8(gb, R8_E, 2))
+CB_OP(0x54, testBitR8(gb, R8_H, 2))
+CB_OP(0x55, testBitR8(gb, R8_L, 2))
+CB_OP(0x56, testBitAR16(gb, R16_HL, 2))
+CB_OP(0x57, testBitR8(gb, R8_A, 2))
+CB_OP(0x58, testBitR8(gb, R8_B, 3))
+CB_OP(0x59, testBitR8(gb, R8_C, 3))
+CB_OP(0x5A, testBitR8(gb, R8_D, 3))
+CB_OP(0x5B, testBitR8(gb, R8_E, 3))
+CB_OP(0x5C, testBitR8(gb, R8_H, 3))
+CB_OP(0x5D, testBitR8(gb, R8_L, 3))
+CB_OP(0x5E, testBitAR16(gb, R16_HL, 3))
+CB_OP(0x5F, testBitR8(gb, R8_A, 3))
+CB_OP(0x60, testBitR8(gb, R8_B, 4))
+CB_OP(0x61, testBitR8(gb, R8_C, 4))
+CB_OP(0x62, testBitR8(gb, R8_D, 4))
+CB_OP(0x63, testBitR8(gb, R8_E, 4))
+CB_OP(0x64, testBitR8(gb, R8_H, 4))
+CB_OP(0x65, testBitR8(gb, R8_L, 4))
+CB_OP(0x66, testBitAR16(gb, R16_HL, 4))
+CB_OP(0x67, testBitR8(gb, R8_A, 4))
+CB_OP(0x68, testBitR8(gb, R8_B, 5))
+CB_OP(0x69, testBitR8(gb, R8_C, 5))
+CB_OP(0x6A, testBitR8(gb, R8_D, 5))
+CB_OP(0x6B, testBitR8(gb, R8_E, 5))
+CB_OP(0x6C, testBitR8(gb, R8_H, 5))
+CB_OP(0x6D, testBitR8(gb, R8_L, 5))
+CB_OP(0x6E, testBitAR16(gb, R16_HL, 5))
+CB_OP(0x6F, testBitR8(gb, R8_A, 5))
+CB_OP(0x70, testBitR8(gb, R8_B, 6))
+CB_OP(0x71, testBitR8(gb, R8_C, 6))
+CB_OP(0x72, testBitR8(gb, R8_D, 6))
+CB_OP(0x73, testBitR8(gb, R8_E, 6))
+CB_OP(0x74, testBitR8(gb, R8_H, 6))
+CB_OP(0x75, testBitR8(gb, R8_L, 6))
+CB_OP(0x76, testBitAR16(gb, R16_HL, 6))
+CB_OP(0x77, testBitR8(gb, R8_A, 6))
+CB_OP(0x78, testBitR8(gb, R8_B, 7))
+CB_OP(0x79, testBitR8(gb, R8_C, 7))
+CB_OP(0x7A, testBitR8(gb, R8_D, 7))
+CB_OP(0x7B, testBitR8(gb, R8_E, 7))
+CB_OP(0x7C, testBitR8(gb, R8_H, 7))
+CB_OP(0x7D, testBitR8(gb, R8_L, 7))
+CB_OP(0x7E, testBitAR16(gb, R16_HL, 7))
+CB_OP(0x7F, testBitR8(gb, R8_A, 7))
+CB_OP(0x80, resetBitR8(gb, R8_B, 0))
+CB_OP(0x81, resetBitR8(gb, R8_C, 0))
+CB_OP(0x82, resetBitR8(gb, R8_D, 0))
+CB_OP(0x83, resetBitR8(gb, R8_E, 0))
+CB_OP(0x84, resetBitR8(gb, R8_H, 0))
+CB_OP(0x85, resetBitR8(gb, R8_L, 0))
+CB_OP(0x86, resetBitAR16(gb, R16_HL, 0))
+CB_OP(0x87, resetBitR8(gb, R8_A, 0))
+CB_OP(0x88, resetBitR8(gb, R8_B, 1))
+CB_OP(0x89, resetBitR8(gb, R8_C, 1))
+CB_OP(0x8A, resetBitR8(gb, R8_D, 1))
+CB_OP(0x8B, resetBitR8(gb, R8_E, 1))
+CB_OP(0x8C, resetBitR8(gb, R8_H, 1))
+CB_OP(0x8D, resetBitR8(gb, R8_L, 1))
+CB_OP(0x8E, resetBitAR16(gb, R16_HL, 1))
+CB_OP(0x8F, resetBitR8(gb, R8_A, 1))
+CB_OP(0x90, resetBitR8(gb, R8_B, 2))
+CB_OP(0x91, resetBitR8(gb, R8_C, 2))
+CB_OP(0x92, resetBitR8(gb, R8_D, 2))
+CB_OP(0x93, resetBitR8(gb, R8_E, 2))
+CB_OP(0x94, resetBitR8(gb, R8_H, 2))
+CB_OP(0x95, resetBitR8(gb, R8_L, 2))
+CB_OP(0x96, resetBitAR16(gb, R16_HL, 2))
+CB_OP(0x97, resetBitR8(gb, R8_A, 2))
+CB_OP(0x98, resetBitR8(gb, R8_B, 3))
+CB_OP(0x99, resetBitR8(gb, R8_C, 3))
+CB_OP(0x9A, resetBitR8(gb, R8_D, 3))
+CB_OP(0x9B, resetBitR8(gb, R8_E, 3))
+CB_OP(0x9C, resetBitR8(gb, R8_H, 3))
+CB_OP(0x9D, resetBitR8(gb, R8_L, 3))
+CB_OP(0x9E, resetBitAR16(gb, R16_HL, 3))
+CB_OP(0x9F, resetBitR8(gb, R8_A, 3))
+CB_OP(0xA0, resetBitR8(gb, R8_B, 4))
+CB_OP(0xA1, resetBitR8(gb, R8_C, 4))
+CB_OP(0xA2, resetBitR8(gb, R8_D, 4))
+CB_OP(0xA3, resetBitR8(gb, R8_E, 4))
+CB_OP(0xA4, resetBitR8(gb, R8_H, 4))
+CB_OP(0xA5, resetBitR8(gb, R8_L, 4))
+CB_OP(0xA6, resetBitAR16(gb, R16_HL, 4))
+CB_OP(0xA7, resetBitR8(gb, R8_A, 4))
+CB_OP(0xA8, resetBitR8(gb, R8_B, 5))
+CB_OP(0xA9, resetBitR8(gb, R8_C, 5))
+CB_OP(0xAA, resetBitR8(gb, R8_D, 5))
+CB_OP(0xAB, resetBitR8(gb, R8_E, 5))
+CB_OP(0xAC, resetBitR8(gb, R8_H, 5))
+CB_OP(0xAD, resetBitR8(gb, R8_L, 5))
+CB_OP(0xAE, resetBitAR16(gb, R16_HL, 5))
+CB_OP(0xAF, resetBitR8(gb, R8_A, 5))
+CB_OP(0xB0, resetBitR8(gb, R8_B, 6))
+CB_OP(0xB1, resetBitR8(gb, R8_C, 6))
+CB_OP(0xB2, resetBitR8(gb, R8_D, 6))
+CB_OP(0xB3, resetBitR8(gb, R8_E, 6))
+CB_OP(0xB4, resetBitR8(gb, R8_H, 6))
+CB_OP(0xB5, resetBitR8(gb, R8_L, 6))
+CB_OP(0xB6, resetBitAR16(gb, R16_HL, 6))
+CB_OP(0xB7, resetBitR8(gb, R8_A, 6))
+CB_OP(0xB8, resetBitR8(gb, R8_B, 7))
+CB_OP(0xB9, resetBitR8(gb, R8_C, 7))
+CB_OP(0xBA, resetBitR8(gb, R8_D, 7))
+CB_OP(0xBB, resetBitR8(gb, R8_E, 7))
+CB_OP(0xBC, resetBitR8(gb, R8_H, 7))
+CB_OP(0xBD, resetBitR8(gb, R8_L, 7))
+CB_OP(0xBE, resetBitAR16(gb, R16_HL, 7))
+CB_OP(0xBF, resetBitR8(gb, R8_A, 7))
+CB_OP(0xC0, setBitR8(gb, R8_B, 0))
+CB_OP(0xC1, setBitR8(gb, R8_C, 0))
+CB_OP(0xC2, setBitR8(gb, R8_D, 0))
+CB_OP(0xC3, setBitR8(gb, R8_E, 0))
+CB_OP(0xC4, setBitR8(gb, R8_H, 0))
+CB_OP(0xC5, setBitR8(gb, R8_L, 0))
+CB_OP(0xC6, setBitAR16(gb, R16_HL, 0))
+CB_OP(0xC7, setBitR8(gb, R8_A, 0))
+CB_OP(0xC8, setBitR8(gb, R8_B, 1))
+CB_OP(0xC9, setBitR8(gb, R8_C, 1))
+CB_OP(0xCA, setBitR8(gb, R8_D, 1))
+CB_OP(0xCB, setBitR8(gb, R8_E, 1))
+CB_OP(0xCC, setBitR8(gb, R8_H, 1))
+CB_OP(0xCD, setBitR8(gb, R8_L, 1))
+CB_OP(0xCE, setBitAR16(gb, R16_HL, 1))
+CB_OP(0xCF, setBitR8(gb, R8_A, 1))
+CB_OP(0xD0, setBitR8(gb, R8_B, 2))
+CB_OP(0xD1, setBitR8(gb, R8_C, 2))
+CB_OP(0xD2, setBitR8(gb, R8_D, 2))
+CB_OP(0xD3, setBitR8(gb, R8_E, 2))
+CB_OP(0xD4, setBitR8(gb, R8_H, 2))
+CB_OP(0xD5, setBitR8(gb, R8_L, 2))
+CB_OP(0xD6, setBitAR16(gb, R16_HL, 2))
+CB_OP(0xD7, setBitR8(gb, R8_A, 2))
+CB_OP(0xD8, setBitR8(gb, R8_B, 3))
+CB_OP(0xD9, setBitR8(gb, R8_C, 3))
+CB_OP(0xDA, setBitR8(gb, R8_D, 3))
+CB_OP(0xDB, setBitR8(gb, R8_E, 3))
+CB_OP(0xDC, setBitR8(gb, R8_H, 3))
+CB_OP(0xDD, setBitR8(gb, R8_L, 3))
+CB_OP(0xDE, setBitAR16(gb, R16_HL, 3))
+CB_OP(0xDF, setBitR8(gb, R8_A, 3))
+CB_OP(0xE0, setBitR8(gb, R8_B, 4))
+CB_OP(0xE1, setBitR8(gb, R8_C, 4))
+CB_OP(0xE2, setBitR8(gb, R8_D, 4))
+CB_OP(0xE3, setBitR8(gb, R8_E, 4))
+CB_OP(0xE4, setBitR8(gb, R8_H, 4))
+CB_OP(0xE5, setBitR8(gb, R8_L, 4))
+CB_OP(0xE6, setBitAR16(gb, R16_HL, 4))
+CB_OP(0xE7, setBitR8(gb, R8_A, 4))
+CB_OP(0xE8, setBitR8(gb, R8_B, 5))
+CB_OP(0xE9, setBitR8(gb, R8_C, 5))
+CB_OP(0xEA, setBitR8(gb, R8_D, 5))
+CB_OP(0xEB, setBitR8(gb, R8_E, 5))
+CB_OP(0xEC, setBitR8(gb, R8_H, 5))
+CB_OP(0xED, setBitR8(gb, R8_L, 5))
+CB_OP(0xEE, setBitAR16(gb, R16_HL, 5))
+CB_OP(0xEF, setBitR8(gb, R8_A, 5))
+CB_OP(0xF0, setBitR8(gb, R8_B, 6))
+CB_OP(0xF1, setBitR8(gb, R8_C, 6))
+CB_OP(0xF2, setBitR8(gb, R8_D, 6))
+CB_OP(0xF3, setBitR8(gb, R8_E, 6))
+CB_OP(0xF4, setBitR8(gb, R8_H, 6))
+CB_OP(0xF5, setBitR8(gb, R8_L, 6))
+CB_OP(0xF6, setBitAR16(gb, R16_HL, 6))
+CB_OP(0xF7, setBitR8(gb, R8_A, 6))
+CB_OP(0xF8, setBitR8(gb, R8_B, 7))
+CB_OP(0xF9, setBitR8(gb, R8_C, 7))
+CB_OP(0xFA, setBitR8(gb, R8_D, 7))
+CB_OP(0xFB, setBitR8(gb, R8_E, 7))
+CB_OP(0xFC, setBitR8(gb, R8_H, 7))
+CB_OP(0xFD, setBitR8(gb, R8_L, 7))
+CB_OP(0xFE, setBitAR16(gb, R16_HL, 7))
+CB_OP(0xFF, setBitR8(gb, R8_A, 7))
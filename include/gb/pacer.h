@@ -0,0 +1,59 @@
+#ifndef gb_pacer_h
+#define gb_pacer_h
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* If the emulator falls this many frames behind (hitches, debugging, slow hosts), the pacer
+ * restarts from the current time instead of rushing through the backlog */
+#define PACER_MAX_FRAMES_BEHIND 10
+
+/* What the emulator synchronises its frames to */
+typedef enum {
+    FRAME_SYNC_TIMER,                   /* Monotonic clock deadlines at the gameboy framerate */
+    FRAME_SYNC_VSYNC,                   /* Every frame waits for its vsynced present */
+    FRAME_SYNC_FREE_RUN                 /* No waiting at all */
+} FRAME_SYNC;
+
+typedef struct {
+    uint64_t cyclesPerFrame;            /* Frame length as a fraction of a second, deadlines */
+    uint64_t cyclesPerSecond;           /* are calculated from it so they never drift */
+    uint64_t epoch;                     /* CLOCK_MONOTONIC nanoseconds the first frame started at */
+    uint64_t frameIndex;                /* Frames paced since the epoch */
+    uint64_t nextDeadline;              /* Nanoseconds at which the current frame should end */
+    uint64_t spinThreshold;             /* Sleeps overshoot, so the last part before a deadline
+                                           is spun instead. Adapts to the measured overshoot */
+
+    /* Statistics, jitter is how late the pacer woke up compared to the deadline */
+    uint64_t framesPaced;
+    uint64_t deadlinesMissed;           /* Frames which were finished after their deadline */
+    uint64_t resyncs;                   /* Times the pacer fell too far behind and restarted */
+    double jitterMean;                  /* Nanoseconds */
+    double jitterM2;                    /* Sum of squared differences from the mean */
+    uint64_t jitterMax;
+} FramePacer;
+
+/* Current CLOCK_MONOTONIC time in nanoseconds */
+uint64_t pacer_now(void);
+
+void pacer_init(FramePacer* pacer, uint64_t cyclesPerFrame, uint64_t cyclesPerSecond);
+/* Starts pacing from the current time, used after pauses and when not pacing by the timer */
+void pacer_reset(FramePacer* pacer);
+/* Nanoseconds the current frame is behind its deadline, negative if its ahead */
+int64_t pacer_getLateness(FramePacer* pacer);
+/* Waits for the deadline of the current frame and moves on to the next one */
+void pacer_waitFrame(FramePacer* pacer);
+/* Sleeps for the given number of nanoseconds */
+void pacer_sleep(uint64_t nanoseconds);
+
+double pacer_getJitterDeviation(FramePacer* pacer);
+void pacer_printStats(FramePacer* pacer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
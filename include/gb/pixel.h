@@ -0,0 +1,36 @@
+#ifndef gb_pixel_h
+#define gb_pixel_h
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pixel kernels shared by the renderers, these use SSE2 or AVX2 when the compiler
+ * targets them and plain C otherwise */
+
+/* Decodes a planar 2bpp tile row into 8 color IDs from left to right,
+ * flipped is the X flip attribute bit */
+void decodeTileRow(uint8_t low, uint8_t high, bool flipped, uint8_t* colorIDs);
+
+/* Same as above but decodes 2 tile rows into 16 color IDs at once */
+void decodeTileRows_2(const uint8_t* low, const uint8_t* high, const bool* flipped, uint8_t* colorIDs);
+
+/* Resolves sprite and BG/Window priority for count pixels and writes their colors
+ *
+ * Attributes are the raw tile map attributes (CGB) and OAM attributes of every pixel, sprite
+ * color ID 0 means there is no sprite pixel.
+ *
+ * On DMG colors points to the BGP, OBP0 and OBP1 shade tables (12 colors), on CGB it points
+ * to the BG and then sprite palette colors (64 colors). bgPriority is LCDC bit 0, which is
+ * the master priority on CGB and is already applied to the BG color IDs on DMG */
+void mixPixels(const uint8_t* bgColorIDs, const uint8_t* bgAttributes,
+               const uint8_t* spriteColorIDs, const uint8_t* spriteAttributes,
+               bool isCGB, bool bgPriority, const uint32_t* colors, uint32_t* out, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef gb_save_h
+#define gb_save_h
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Battery backed external RAM is a shared mapping of the .sav file next to the ROM. Writes
+ * mark 256 byte pages dirty and a flusher thread writes them back, so the core thread never
+ * waits on the disk. MBCs can keep more state in a footer after the RAM, like the RTC */
+#define SAVE_PAGE_SIZE 0x100
+#define SAVE_MAX_SIZE 0x20000
+#define SAVE_PAGE_COUNT (SAVE_MAX_SIZE / SAVE_PAGE_SIZE)
+/* Frames between flushes of pages written meanwhile */
+#define SAVE_FLUSH_FRAMES 60
+
+struct GB;
+
+typedef struct {
+    uint8_t* data;                      /* External RAM followed by the footer */
+    size_t size;                        /* Size of the RAM, the footer starts here */
+    size_t footerSize;
+    bool mapped;                        /* Data is mapped from the .sav file */
+    bool dirty;                         /* Written since the flusher was last woken, core thread only */
+    bool flushPending;                  /* RAM was disabled, flush at the end of the frame */
+    bool dirtyPages[SAVE_PAGE_COUNT];   /* Set by the core thread, cleared by the flusher */
+    unsigned int framesSinceFlush;
+
+    SDL_Thread* flusher;
+    SDL_mutex* lock;
+    SDL_cond* wake;
+    bool flushRequested;                /* Guarded by lock */
+    bool running;
+} SaveRAM;
+
+/* Allocates external RAM and a footer for the MBC, mapped from the .sav file if the cartridge
+ * has a battery. A new footer is zeroed */
+uint8_t* save_allocate(struct GB* gb, size_t size, size_t footerSize);
+/* Writes back everything and frees the RAM */
+void save_free(struct GB* gb);
+/* Flushes what was written at the end of the frame, called when RAM is disabled */
+void save_requestFlush(struct GB* gb);
+/* Wakes the flusher if a flush was requested or every SAVE_FLUSH_FRAMES frames, it never
+ * waits for the flusher */
+void save_endFrame(struct GB* gb);
+
+static inline void save_markDirty(SaveRAM* save, uint32_t offset) {
+    if (!save->mapped) return;
+
+    __atomic_store_n(&save->dirtyPages[offset / SAVE_PAGE_SIZE], true, __ATOMIC_RELEASE);
+    save->dirty = true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,15 +6,10 @@
 
 extern void startGBEmulator(Cartridge*);
 
-static void runGB(uint8_t* allocation, size_t size) {
-	Cartridge c;
-    bool result = initCartridge(&c, allocation, size);
-
-    if (!result) exit(3);
+static void runGB(Cartridge* c) {
+    startGBEmulator(c);
 
-    startGBEmulator(&c);
-
-	freeCartridge(&c);
+	freeCartridge(c);
 }
 
 int main(int argc, char* argv[]) {
@@ -24,29 +19,12 @@ int main(int argc, char* argv[]) {
     }
 
     char* filePath = argv[1];
-    FILE* file = fopen(filePath, "r");
-
-    if (file == NULL) {
-        printf("Error : Couldn't open input file\n");
-        exit(2);
-    }
-
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    /* Allocate enough space for the bytes */
-    uint8_t* allocation = (uint8_t*)malloc(size);
-    int ret = fread(allocation, size, 1, file);
-	if (ret != 1) {
-		printf("Error : Could not read full file\n");
-		exit(3);
-	}
-    fclose(file);
+    /* The ROM is mapped instead of read into memory, or decompressed if its an archive */
+	Cartridge c;
+    if (!loadCartridge(&c, filePath)) exit(2);
 
-	
 	/* GB/GBC */
-	runGB(allocation, size);
+	runGB(&c);
 
 	return 0;
 }